@@ -74,6 +74,10 @@
 #define JT_PATH_TOO_SHORT 21
 /** Wrong type in JSON path */
 #define JT_PATH_WRONG_TYPE 22
+/** Request took longer than allowed by jt_set_timeouts() */
+#define JT_TIMEOUT 23
+/** Request was aborted by the cancel flag (see jt_set_cancel()) */
+#define JT_CANCELLED 24
 
 /* Flags for jt_alloc(). */
 
@@ -86,6 +90,19 @@
  */
 #define JT_FLAG_NO_HOST_CHECK 2
 
+/* Default limits, see jt_set_timeouts(). */
+
+/** Maximum time in milliseconds for connecting. */
+#define JT_DEFAULT_CONNECT_TIMEOUT 15000
+/** Maximum time in milliseconds for a request. */
+#define JT_DEFAULT_TIMEOUT 60000
+/** Requests slower than this number of bytes per second ... */
+#define JT_DEFAULT_LOW_SPEED_LIMIT 100
+/** ... for this number of seconds are aborted. */
+#define JT_DEFAULT_LOW_SPEED_TIME 20
+/** Time in seconds in which identical requests share one response, 0 is disabled. */
+#define JT_DEFAULT_COALESCE_TIME 0
+
 
 /**
  * This is the handle needed to be passed to all functions.
@@ -214,11 +231,31 @@ int jt_load_token(jt_access_token_t *at);
  */
 int jt_get_my_subscriptions(jt_access_token_t *at, const char *pageToken);
 
+/**
+ * Get the subscriptions for the current user with 50 per page. Only the
+ * title and channel ID of each subscription are returned. This is used to
+ * get the full list with a few requests.
+ * The function will automatically refresh access tokens when needed.
+ *
+ * @param pageToken Must be "" for the first page. When this function is
+ *        called the next page is returned in the JSON attribute "nextPageToken".
+ *
+ * @return JT_OK On success.
+ * @return JT_TRANSFER_ERROR When an HTTPS transfer error happened. Wrong
+ *         certificate, no DNS and other errors.
+ * @return JT_AUTH_ERROR When permission denied.
+ * @return JT_ERROR_ACCESS_TOKEN When jt_get_token() or jt_load_token() wasn't
+ *         called.
+ * @return JT_PROTOCOL_ERROR Protocol error.
+ */
+int jt_get_my_subscription_list(jt_access_token_t *at, const char *pageToken);
+
 /**
  * Get the channels for the channel id.
  * The function will automatically refresh access tokens when needed.
  *
- * @param channelId The ID of the channel.
+ * @param channelId The ID of the channel. Up to 50 IDs can be requested at
+ *        once when separated by ",".
  * @param pageToken Must be "" for the first page. When this function is
  *        called the next page is returned in the JSON attribute "nextPageToken".
  *
@@ -430,6 +467,61 @@ int jt_json_get_int_by_path(jt_access_token_t *at, int *value, const char *forma
  */
 int jt_free_transfer(jt_access_token_t *at);
 
+/**
+ * Set limits for the HTTP transfers. A stalled connection is aborted with
+ * JT_TIMEOUT instead of blocking until TCP gives up. The defaults are
+ * JT_DEFAULT_CONNECT_TIMEOUT, JT_DEFAULT_TIMEOUT and JT_DEFAULT_LOW_SPEED_*.
+ * @param connecttimeout Maximum time in milliseconds for connecting, 0 for no limit.
+ * @param timeout Maximum time in milliseconds for a whole request, 0 for no limit.
+ * @param lowspeedlimit Abort when less than this number of bytes per second
+ *	are received for lowspeedtime seconds, 0 for no limit.
+ * @param lowspeedtime Time in seconds for lowspeedlimit.
+ */
+void jt_set_timeouts(jt_access_token_t *at, long connecttimeout, long timeout, long lowspeedlimit, long lowspeedtime);
+
+/**
+ * Set the flag for cancelling requests. While the flag is not 0, a running
+ * request is aborted and new requests fail with JT_CANCELLED. The flag is
+ * checked while data is transferred, so it can be set by the progress
+ * callback, a signal handler or another thread.
+ * @param cancel Pointer to the flag or NULL.
+ */
+void jt_set_cancel(jt_access_token_t *at, volatile int *cancel);
+
+/**
+ * Set a function which is called regularly while a request is running,
+ * e.g. to check whether the user wants to abort it with the cancel flag.
+ * @param progress Function or NULL.
+ * @param ctx Parameter passed to progress.
+ */
+void jt_set_progress(jt_access_token_t *at, void (*progress)(void *ctx), void *ctx);
+
+/**
+ * Use a CURL share handle, e.g. to use DNS entries and connections which
+ * the application established in advance. The share handle must stay valid
+ * until jt_free() is called.
+ * @param share Share handle or NULL.
+ */
+void jt_set_share(jt_access_token_t *at, CURLSH *share);
+
+/**
+ * Set the time in which identical requests share one response. A request
+ * for the same URL with the same account within this time gets the JSON
+ * object of the first request instead of a new transfer. This saves quota
+ * when the user scrolls back and forth. Only requests without form data are
+ * shared. The default is JT_DEFAULT_COALESCE_TIME, so that callers which
+ * need fresh data are not affected.
+ * @param seconds Time in seconds, 0 disables sharing.
+ */
+void jt_set_coalesce_time(jt_access_token_t *at, int seconds);
+
+/**
+ * Get statistics about the HTTP transfers done with the handle.
+ * @param requests Pointer to returned number of requests.
+ * @param bytes Pointer to returned number of received bytes.
+ */
+void jt_get_transfer_stats(jt_access_token_t *at, unsigned long *requests, unsigned long long *bytes);
+
 /**
  * Copy string. Works with NULL pointers. NULL is returned for NULL pointers.
  * @returns Pointer to copied string.
@@ -451,4 +543,60 @@ char *jt_get_page_token(int page);
  */
 int jt_get_page_number(const char *pageToken);
 
+/**
+ * Start writing trace events in the Chrome trace event format to a file.
+ * The file can be loaded into Perfetto or chrome://tracing. The trace
+ * functions are global and can be used by the application together with
+ * libjt.
+ * @returns 0 on success, -1 on error.
+ */
+int jt_trace_open(const char *filename);
+
+/**
+ * Finish the trace file.
+ */
+void jt_trace_close(void);
+
+/**
+ * Write a trace event, use the JT_TRACE_* macros instead.
+ * @param phase 'B' for begin, 'E' for end and 'i' for an instant event.
+ * @param cat Category, string constant.
+ * @param name Name of the event, string constant.
+ * @param detail Additional text or NULL. URLs are written without the query.
+ */
+void jt_trace_event(char phase, const char *cat, const char *name, const char *detail);
+
+/** Set while the trace file is open. */
+extern int jt_trace_enabled;
+
+#ifdef JT_NOTRACE
+#define JT_TRACE_BEGIN(cat, name, detail) do { } while(0)
+#define JT_TRACE_END(cat, name) do { } while(0)
+#define JT_TRACE_INSTANT(cat, name, detail) do { } while(0)
+#else
+/** Begin a span, the arguments are only evaluated when tracing is enabled. */
+#define JT_TRACE_BEGIN(cat, name, detail) \
+	do { \
+		if (jt_trace_enabled) { \
+			jt_trace_event('B', cat, name, detail); \
+		} \
+	} while(0)
+
+/** End the span started last. */
+#define JT_TRACE_END(cat, name) \
+	do { \
+		if (jt_trace_enabled) { \
+			jt_trace_event('E', cat, name, NULL); \
+		} \
+	} while(0)
+
+/** Mark a point in time. */
+#define JT_TRACE_INSTANT(cat, name, detail) \
+	do { \
+		if (jt_trace_enabled) { \
+			jt_trace_event('i', cat, name, detail); \
+		} \
+	} while(0)
+#endif
+
 #endif
@@ -18,11 +18,19 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <errno.h>
+#include <ctype.h>
+#include <time.h>
 #include <curl/curl.h>
 
 #include "libjt.h"
 
 #define CHUNK_SIZE 256
+/** Number of responses remembered for identical requests. */
+#define RECENT_COUNT 8
+/** Base of all YouTube Data API requests. */
+#define JT_API_URL "https://www.googleapis.com/youtube/v3/"
+/** Initial size of the URL buffer, most URLs fit into it. */
+#define URL_SIZE 512
 
 #ifdef DEBUG
 #define JT_JSON_DEBUG
@@ -61,8 +69,39 @@
 		return #code;
 
 
+/**
+ * Parameters of a request to the YouTube Data API. All parameters except
+ * resource are optional, NULL, "" and 0 are not sent. The values are
+ * percent-encoded when the URL is built.
+ */
+typedef struct {
+	/** Resource, e.g. "playlistItems". */
+	const char *resource;
+	/** Comma separated list of resource parts, e.g. "snippet,contentDetails". */
+	const char *part;
+	/** Projection of the response, e.g. "nextPageToken,items/id". */
+	const char *fields;
+	/** Comma separated list of IDs, up to 50 are loaded at once. */
+	const char *id;
+	/** Channel ID, e.g. for the playlists of a channel. */
+	const char *channelid;
+	/** Playlist ID, e.g. for the videos of a playlist. */
+	const char *playlistid;
+	/** Search term. */
+	const char *q;
+	/** Type of the search results, e.g. "video". */
+	const char *type;
+	/** Set for the resources of the logged in user. */
+	int mine;
+	/** Number of results per page, 0 for the default of the server. */
+	int maxresults;
+	/** Page token from a previous response, NULL for the first page. */
+	const char *pagetoken;
+} jt_request_t;
+
 typedef struct jt_transfer_s jt_transfer_t;
 typedef struct jt_mem_s jt_mem_t;
+typedef struct jt_recent_s jt_recent_t;
 
 struct jt_mem_s {
 	jt_access_token_t *at;
@@ -70,11 +109,43 @@ struct jt_mem_s {
 	size_t size;
 };
 
+/** Response which is shared with identical requests. */
+struct jt_recent_s {
+	/* Request URL without API key, NULL when unused. */
+	char *url;
+	/* Hash of the account of the request. */
+	unsigned long scope;
+	/* Parsed response, each user holds a reference. */
+	json_object *jobj;
+	/* Time when the response was received. */
+	time_t time;
+};
+
 struct jt_transfer_s {
 	CURL *curl;
 	CURLcode res;
 	json_object *jobj;
 	jt_mem_t chunk;
+
+	/* Cancellation */
+	volatile int *cancel;
+	void (*progress)(void *ctx);
+	void *progressctx;
+
+	/* URL of the request, the buffer is reused. */
+	char *url;
+	size_t urllen;
+	size_t urlsize;
+
+	/* Responses shared with identical requests. */
+	jt_recent_t recent[RECENT_COUNT];
+	unsigned int recentpos;
+	int coalescetime;
+
+	/* Statistics */
+	unsigned long requests;
+	unsigned long long bytes;
+	unsigned long coalesced;
 };
 
 struct jt_access_token_s {
@@ -112,6 +183,7 @@ struct jt_access_token_s {
 };
 
 static void *jt_load_file(jt_access_token_t *at, const char *filename);
+static void jt_recent_clear(jt_recent_t *recent);
 
 char *jt_strdup(const char *text)
 {
@@ -146,6 +218,29 @@ static size_t jt_mem_callback(void *contents, size_t size, size_t nmemb,
 }
 
 
+/** Called by curl while a transfer is running, returns non-zero to abort it. */
+#if LIBCURL_VERSION_NUM >= 0x072000
+static int jt_progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+#else
+static int jt_progress_callback(void *clientp, double dltotal, double dlnow, double ultotal, double ulnow)
+#endif
+{
+	jt_transfer_t *transfer = clientp;
+
+	(void) dltotal;
+	(void) dlnow;
+	(void) ultotal;
+	(void) ulnow;
+
+	if (transfer->progress != NULL) {
+		transfer->progress(transfer->progressctx);
+	}
+	if ((transfer->cancel != NULL) && *transfer->cancel) {
+		return 1;
+	}
+	return 0;
+}
+
 static jt_access_token_t *jt_alloc_internal(FILE *logfd, FILE *errfd,
 	const char *token_file,
 	const char *refresh_token_file,
@@ -184,6 +279,21 @@ static jt_access_token_t *jt_alloc_internal(FILE *logfd, FILE *errfd,
 	/* Don't include headers in response. */
 	curl_easy_setopt(at->transfer.curl, CURLOPT_HEADER, 0);
 
+	/* The progress function checks the cancel flag. */
+#if LIBCURL_VERSION_NUM >= 0x072000
+	curl_easy_setopt(at->transfer.curl, CURLOPT_XFERINFOFUNCTION, jt_progress_callback);
+	curl_easy_setopt(at->transfer.curl, CURLOPT_XFERINFODATA, (void *)&at->transfer);
+#else
+	curl_easy_setopt(at->transfer.curl, CURLOPT_PROGRESSFUNCTION, jt_progress_callback);
+	curl_easy_setopt(at->transfer.curl, CURLOPT_PROGRESSDATA, (void *)&at->transfer);
+#endif
+	curl_easy_setopt(at->transfer.curl, CURLOPT_NOPROGRESS, 0L);
+	/* Signals can't be used for timeouts in multithreaded programs. */
+	curl_easy_setopt(at->transfer.curl, CURLOPT_NOSIGNAL, 1L);
+	jt_set_timeouts(at, JT_DEFAULT_CONNECT_TIMEOUT, JT_DEFAULT_TIMEOUT,
+		JT_DEFAULT_LOW_SPEED_LIMIT, JT_DEFAULT_LOW_SPEED_TIME);
+	at->transfer.coalescetime = JT_DEFAULT_COALESCE_TIME;
+
 	if (flags & JT_FLAG_NO_CERT) {
 		curl_easy_setopt(at->transfer.curl, CURLOPT_SSL_VERIFYPEER, 0L);
 	} else {
@@ -274,6 +384,8 @@ jt_access_token_t *jt_alloc(FILE *logfd, FILE *errfd, const char *client_id,
 
 void jt_free(jt_access_token_t *at)
 {
+	int i;
+
 	LOG("%s()\n", __FUNCTION__);
 	if (at->client_id != NULL) {
 		free(at->client_id);
@@ -332,6 +444,18 @@ void jt_free(jt_access_token_t *at)
 		at->error_description = NULL;
 	}
 
+	for (i = 0; i < RECENT_COUNT; i++) {
+		jt_recent_clear(&at->transfer.recent[i]);
+	}
+	if (at->transfer.coalesced > 0) {
+		LOG("%lu requests shared the response of an identical request.\n", at->transfer.coalesced);
+	}
+
+	if (at->transfer.url != NULL) {
+		free(at->transfer.url);
+		at->transfer.url = NULL;
+	}
+
 	curl_easy_cleanup(at->transfer.curl);
 	at->transfer.curl = NULL;
 
@@ -1089,8 +1213,30 @@ static int jt_load_json(jt_access_token_t *at, const char *url, struct curl_slis
 			curl_easy_setopt(at->transfer.curl, CURLOPT_NOBODY, 0);
 		}
 
+		if ((at->transfer.cancel != NULL) && *at->transfer.cancel) {
+			LOG("Request cancelled before start.\n");
+			return JT_CANCELLED;
+		}
+
 		/* Transfer data via HTTP or HTTPS. */
+		JT_TRACE_BEGIN("libjt", "transfer", url);
 		at->transfer.res = curl_easy_perform(at->transfer.curl);
+		JT_TRACE_END("libjt", "transfer");
+		at->transfer.requests++;
+		at->transfer.bytes += at->transfer.chunk.size;
+		if ((at->transfer.res == CURLE_ABORTED_BY_CALLBACK) || (at->transfer.res == CURLE_OPERATION_TIMEDOUT)) {
+			/* Partial response, nothing to parse. */
+			if (at->transfer.chunk.memory != NULL) {
+				free(at->transfer.chunk.memory);
+				at->transfer.chunk.memory = NULL;
+			}
+			if (at->transfer.res == CURLE_ABORTED_BY_CALLBACK) {
+				LOG("Request cancelled: %s\n", url);
+				return JT_CANCELLED;
+			}
+			LOG_ERROR("Request timed out: %s\n", curl_easy_strerror(at->transfer.res));
+			return JT_TIMEOUT;
+		}
 		if (at->transfer.res != CURLE_OK) {
 			LOG_ERROR("curl_easy_perform() failed: %s\n",
 				curl_easy_strerror(at->transfer.res));
@@ -1105,7 +1251,9 @@ static int jt_load_json(jt_access_token_t *at, const char *url, struct curl_slis
 					jt_save_file(at, savefilename, at->transfer.chunk.memory, at->transfer.chunk.size);
 				}
 			}
+			JT_TRACE_BEGIN("libjt", "parse", NULL);
 			at->transfer.jobj = json_tokener_parse(at->transfer.chunk.memory);
+			JT_TRACE_END("libjt", "parse");
 			if (at->logfd != NULL) {
 				jt_print_response(at, url, at->transfer.chunk.memory, formpost);
 			}
@@ -1337,15 +1485,245 @@ int jt_get_refresh_token(jt_access_token_t *at)
 	return rv;
 }
 
+static void jt_recent_clear(jt_recent_t *recent)
+{
+	if (recent->url != NULL) {
+		free(recent->url);
+		recent->url = NULL;
+	}
+	recent->scope = 0;
+	if (recent->jobj != NULL) {
+		json_object_put(recent->jobj);
+		recent->jobj = NULL;
+	}
+}
+
+/**
+ * Responses differ between accounts, so they are only shared when the hash
+ * of the token is the same. Requests with API key only use 0. The token
+ * itself is not kept in memory.
+ */
+static unsigned long jt_recent_scope(jt_access_token_t *at)
+{
+	const unsigned char *token = NULL;
+	unsigned long hash;
+
+	if (at->refresh_token != NULL) {
+		token = (const unsigned char *) at->refresh_token;
+	} else if (at->access_token != NULL) {
+		token = (const unsigned char *) at->access_token;
+	} else {
+		return 0;
+	}
+	/* djb2 */
+	hash = 5381;
+	while (*token != 0) {
+		hash = hash * 33 + *token;
+		token++;
+	}
+	return hash;
+}
+
+/**
+ * Get the response of an identical request received within the coalesce time.
+ * @returns JSON object with a new reference or NULL.
+ */
+static json_object *jt_recent_get(jt_access_token_t *at, const char *url)
+{
+	unsigned long scope;
+	time_t now;
+	int i;
+
+	if (at->transfer.coalescetime <= 0) {
+		return NULL;
+	}
+	scope = jt_recent_scope(at);
+	now = time(NULL);
+	for (i = 0; i < RECENT_COUNT; i++) {
+		jt_recent_t *recent = &at->transfer.recent[i];
+
+		if (recent->url == NULL) {
+			continue;
+		}
+		if ((now - recent->time) > at->transfer.coalescetime) {
+			jt_recent_clear(recent);
+			continue;
+		}
+		if ((strcmp(recent->url, url) == 0) && (recent->scope == scope)) {
+			return json_object_get(recent->jobj);
+		}
+	}
+	return NULL;
+}
+
+/** Share the response with identical requests which follow. */
+static void jt_recent_put(jt_access_token_t *at, const char *url, json_object *jobj)
+{
+	jt_recent_t *recent;
+
+	if (at->transfer.coalescetime <= 0) {
+		return;
+	}
+	/* Replace the oldest response. */
+	recent = &at->transfer.recent[at->transfer.recentpos];
+	at->transfer.recentpos = (at->transfer.recentpos + 1) % RECENT_COUNT;
+	jt_recent_clear(recent);
+	recent->url = strdup(url);
+	if (recent->url == NULL) {
+		return;
+	}
+	recent->scope = jt_recent_scope(at);
+	recent->jobj = json_object_get(jobj);
+	recent->time = time(NULL);
+}
+
+/** Make room for len more characters and the terminating 0 in the URL buffer. */
+static int jt_url_reserve(jt_access_token_t *at, size_t len)
+{
+	jt_transfer_t *t = &at->transfer;
+
+	if ((t->urllen + len + 1) > t->urlsize) {
+		size_t size;
+		char *url;
+
+		size = (t->urlsize == 0) ? URL_SIZE : t->urlsize;
+		while (size < (t->urllen + len + 1)) {
+			size *= 2;
+		}
+		url = realloc(t->url, size);
+		if (url == NULL) {
+			return JT_NO_MEM;
+		}
+		t->url = url;
+		t->urlsize = size;
+	}
+	return JT_OK;
+}
+
+/** Append text to the URL as it is. */
+static int jt_url_append(jt_access_token_t *at, const char *text)
+{
+	size_t len = strlen(text);
+
+	if (jt_url_reserve(at, len) != JT_OK) {
+		return JT_NO_MEM;
+	}
+	memcpy(at->transfer.url + at->transfer.urllen, text, len + 1);
+	at->transfer.urllen += len;
+	return JT_OK;
+}
+
+/** Cut the URL back to len characters. */
+static void jt_url_truncate(jt_access_token_t *at, size_t len)
+{
+	if (at->transfer.url != NULL) {
+		at->transfer.urllen = len;
+		at->transfer.url[len] = 0;
+	}
+}
+
+/**
+ * Append a query parameter to the URL. The value is percent-encoded, so
+ * search terms and page tokens can contain any character.
+ * @param value Value of the parameter, NULL or "" skips the parameter.
+ */
+static int jt_url_param(jt_access_token_t *at, const char *name, const char *value)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const unsigned char *v;
+	char *out;
+
+	if ((value == NULL) || (*value == 0)) {
+		return JT_OK;
+	}
+	if (strchr(at->transfer.url, '?') == NULL) {
+		if (jt_url_append(at, "?") != JT_OK) {
+			return JT_NO_MEM;
+		}
+	} else {
+		if (jt_url_append(at, "&") != JT_OK) {
+			return JT_NO_MEM;
+		}
+	}
+	if ((jt_url_append(at, name) != JT_OK) || (jt_url_append(at, "=") != JT_OK)) {
+		return JT_NO_MEM;
+	}
+	/* Each character needs at most 3 characters. */
+	if (jt_url_reserve(at, 3 * strlen(value)) != JT_OK) {
+		return JT_NO_MEM;
+	}
+	out = at->transfer.url + at->transfer.urllen;
+	for (v = (const unsigned char *) value; *v != 0; v++) {
+		if (isalnum(*v) || (*v == '-') || (*v == '.') || (*v == '_') || (*v == '~')) {
+			*out++ = *v;
+		} else {
+			*out++ = '%';
+			*out++ = hex[*v >> 4];
+			*out++ = hex[*v & 15];
+		}
+	}
+	*out = 0;
+	at->transfer.urllen = out - at->transfer.url;
+	return JT_OK;
+}
+
+/** Append a numeric query parameter, 0 skips the parameter. */
+static int jt_url_param_int(jt_access_token_t *at, const char *name, int value)
+{
+	char text[16];
+
+	if (value == 0) {
+		return JT_OK;
+	}
+	snprintf(text, sizeof(text), "%d", value);
+	return jt_url_param(at, name, text);
+}
+
+/** Build the URL of a request in the URL buffer. */
+static int jt_url_build(jt_access_token_t *at, const jt_request_t *req)
+{
+	int rv = JT_OK;
+
+	if (req->resource == NULL) {
+		LOG_ERROR("Request without resource.\n");
+		return JT_ERROR;
+	}
+	at->transfer.urllen = 0;
+	if (jt_url_reserve(at, 0) != JT_OK) {
+		return JT_NO_MEM;
+	}
+	at->transfer.url[0] = 0;
+	rv |= jt_url_append(at, JT_API_URL);
+	rv |= jt_url_append(at, req->resource);
+	rv |= jt_url_param(at, "part", req->part);
+	rv |= jt_url_param(at, "fields", req->fields);
+	rv |= jt_url_param(at, "type", req->type);
+	rv |= jt_url_param(at, "q", req->q);
+	rv |= jt_url_param(at, "id", req->id);
+	rv |= jt_url_param(at, "channelId", req->channelid);
+	rv |= jt_url_param(at, "playlistId", req->playlistid);
+	rv |= jt_url_param(at, "mine", req->mine ? "true" : NULL);
+	rv |= jt_url_param_int(at, "maxResults", req->maxresults);
+	rv |= jt_url_param(at, "pageToken", req->pagetoken);
+	if (rv != JT_OK) {
+		return JT_NO_MEM;
+	}
+	return JT_OK;
+}
+
+/**
+ * Load a request of the YouTube Data API. The access token is refreshed
+ * when it expired. Without access token the API key is used.
+ * @param savefilename File for saving the response, NULL if not used.
+ */
 static int jt_load_json_refreshing(jt_access_token_t *at,
-	struct curl_httppost *formpost, const char *savefilename,
-	const char *format, ...)
+	const jt_request_t *req, const char *savefilename)
 {
 	int rv;
 	int retry;
 	int ret;
-	char *url = NULL;
-	va_list ap;
+	/* Length of the URL without API key. */
+	size_t baselen;
 
 	if (at->transfer.jobj != NULL) {
 		LOG_ERROR("jt_load_json_refreshing called with jobj.\n");
@@ -1355,12 +1733,20 @@ static int jt_load_json_refreshing(jt_access_token_t *at,
 		return JT_JOBJ_NOT_FREE;
 	}
 
-	va_start(ap, format);
-	ret = vasprintf(&url, format, ap);
-	va_end(ap);
-	if (ret == -1) {
-		url = NULL;
-		return JT_NO_MEM;
+	rv = jt_url_build(at, req);
+	if (rv != JT_OK) {
+		return rv;
+	}
+	baselen = at->transfer.urllen;
+
+	/* The same page is requested again when the user scrolls back. */
+	if (savefilename == NULL) {
+		at->transfer.jobj = jt_recent_get(at, at->transfer.url);
+		if (at->transfer.jobj != NULL) {
+			LOG("%s() URL: %s shares recent response\n", __FUNCTION__, at->transfer.url);
+			at->transfer.coalesced++;
+			return JT_OK;
+		}
 	}
 
 	retry = 0;
@@ -1373,30 +1759,23 @@ static int jt_load_json_refreshing(jt_access_token_t *at,
 			at->transfer.jobj = NULL;
 		}
 
+		/* The key of the last try is not used again. */
+		jt_url_truncate(at, baselen);
 		if ((at->access_token != NULL) && (at->token_type != NULL)) {
 			ret = asprintf(&token, "Authorization: %s %s", CHECKSTR(at->token_type), CHECKSTR(at->access_token));
 			if (ret == -1) {
 				token = NULL;
-				free(url);
-				url = NULL;
 				return JT_NO_MEM;
 			}
 			headers = curl_slist_append(headers, token);
 		} else if (at->key != NULL) {
-			char *old;
-
-			old = url;
-			ret = asprintf(&url, "%s&key=%s", url, at->key);
-			if (ret == -1) {
-				url = NULL;
-				free(old);
-				old = NULL;
+			if (jt_url_param(at, "key", at->key) != JT_OK) {
 				return JT_NO_MEM;
 			}
 		}
 
-		LOG("%s() URL: %s\n", __FUNCTION__, CHECKSTR(url));
-		rv = jt_load_json(at, url, headers, formpost, savefilename);
+		LOG("%s() URL: %s\n", __FUNCTION__, at->transfer.url);
+		rv = jt_load_json(at, at->transfer.url, headers, NULL, savefilename);
 
 		curl_slist_free_all(headers);
 		headers = NULL;
@@ -1416,7 +1795,9 @@ static int jt_load_json_refreshing(jt_access_token_t *at,
 
 					LOG("Refreshing token\n");
 
+					JT_TRACE_BEGIN("libjt", "refresh token", NULL);
 					rv = jt_get_refresh_token(at);
+					JT_TRACE_END("libjt", "refresh token");
 					if (rv == JT_OK) {
 						rv = JT_AUTH_ERROR;
 					}
@@ -1427,7 +1808,7 @@ static int jt_load_json_refreshing(jt_access_token_t *at,
 
 					rv = JT_ERROR_ACCESS_TOKEN;
 				} else {
-					LOG_ERROR("%s() URL: %s\n", __FUNCTION__, CHECKSTR(url));
+					LOG_ERROR("%s() URL: %s\n", __FUNCTION__, at->transfer.url);
 					LOG_ERROR("%s\n", error);
 					if (at->protocol_error != NULL) {
 						free(at->protocol_error);
@@ -1448,177 +1829,229 @@ static int jt_load_json_refreshing(jt_access_token_t *at,
 			json_object_put(at->transfer.jobj);
 			at->transfer.jobj = NULL;
 		}
+	} else if (savefilename == NULL) {
+		jt_url_truncate(at, baselen);
+		jt_recent_put(at, at->transfer.url, at->transfer.jobj);
 	}
-	free(url);
-	url = NULL;
 	return rv;
 }
 
 int jt_get_my_subscriptions(jt_access_token_t *at, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "subscriptions";
+	req.part = "snippet";
+	req.mine = 1;
+	req.maxresults = 1;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"subscriptions.json",
+		"subscriptions.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/subscriptions?part=snippet&mine=true&maxResults=1&pageToken=%s",
-		pageToken);
+		);
+}
 
-	return rv;
+int jt_get_my_subscription_list(jt_access_token_t *at, const char *pageToken)
+{
+	jt_request_t req;
+
+	LOG("%s()\n", __FUNCTION__);
+
+	memset(&req, 0, sizeof(req));
+	req.resource = "subscriptions";
+	req.part = "snippet";
+	req.fields = "nextPageToken,pageInfo,items/snippet(title,resourceId/channelId)";
+	req.mine = 1;
+	req.maxresults = 50;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
+#ifdef DEBUG
+		"subscriptionlist.json"
+#else
+		NULL
+#endif
+		);
 }
 
 int jt_get_channels(jt_access_token_t *at, const char *channelId, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "channels";
+	req.part = "snippet,contentDetails";
+	req.id = channelId;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"channels.json",
+		"channels.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/channels?part=snippet%%2CcontentDetails&id=%s&pageToken=%s",
-		channelId,
-		pageToken);
-
-	return rv;
+		);
 }
 
 int jt_get_my_channels(jt_access_token_t *at, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "channels";
+	req.part = "snippet,contentDetails";
+	req.mine = 1;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"mychannels.json",
+		"mychannels.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/channels?part=snippet%%2CcontentDetails&mine=true&pageToken=%s",
-		pageToken);
-
-	return rv;
+		);
 }
 
 int jt_get_playlist(jt_access_token_t *at, const char *playlistid, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "playlists";
+	req.part = "snippet";
+	req.id = playlistid;
+	req.maxresults = 50;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"playlist.json",
+		"playlist.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/playlists?part=snippet&id=%s&maxResults=50&pageToken=%s",
-		playlistid,
-		pageToken);
-
-	return rv;
+		);
 }
 
 int jt_get_my_playlist(jt_access_token_t *at, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "playlists";
+	req.part = "snippet";
+	req.mine = 1;
+	req.maxresults = 1;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"myplaylist.json",
+		"myplaylist.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/playlists?part=snippet&mine=true&maxResults=1&pageToken=%s",
-		pageToken);
-
-	return rv;
+		);
 }
 
 int jt_get_channel_playlists(jt_access_token_t *at, const char *channelid, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "playlists";
+	req.part = "snippet";
+	req.channelid = channelid;
+	req.maxresults = 2;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"channelplaylist.json",
+		"channelplaylist.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/playlists?part=snippet&channelId=%s&maxResults=2&pageToken=%s",
-		channelid,
-		pageToken);
-
-	return rv;
+		);
 }
 
 int jt_get_playlist_items(jt_access_token_t *at, const char *playlistid, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "playlistItems";
+	req.part = "snippet,contentDetails";
+	req.playlistid = playlistid;
+	req.maxresults = 5;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"playlistitem.json",
+		"playlistitem.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/playlistItems?part=snippet%%2CcontentDetails&playlistId=%s&maxResults=5&pageToken=%s",
-		playlistid,
-		pageToken);
-
-	return rv;
+		);
 }
 
 int jt_get_video(jt_access_token_t *at, const char *videoid)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "videos";
+	req.part = "snippet";
+	req.id = videoid;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"video.json",
+		"video.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/videos?part=snippet&id=%s",
-		videoid);
-
-	return rv;
+		);
 }
 
 int jt_search_video(jt_access_token_t *at, const char *searchterm, const char *pageToken)
 {
-	int rv;
+	jt_request_t req;
 
 	LOG("%s()\n", __FUNCTION__);
 
-	rv = jt_load_json_refreshing(at, NULL,
+	memset(&req, 0, sizeof(req));
+	req.resource = "search";
+	req.part = "snippet";
+	req.type = "video";
+	req.q = searchterm;
+	req.maxresults = 5;
+	req.pagetoken = pageToken;
+
+	return jt_load_json_refreshing(at, &req,
 #ifdef DEBUG
-		"videosearch.json",
+		"videosearch.json"
 #else
-		NULL,
+		NULL
 #endif
-		"https://www.googleapis.com/youtube/v3/search?part=snippet&type=video&q=%s&maxResults=5&pageToken=%s",
-		searchterm,
-		pageToken);
-
-	return rv;
+		);
 }
 
 static int jt_load_token_file(jt_access_token_t *at, const char *filename)
@@ -1759,6 +2192,8 @@ const char *jt_get_error_code(int rv)
 		CONVCASETOTEXT(JT_PATH_TOO_LONG)
 		CONVCASETOTEXT(JT_PATH_TOO_SHORT)
 		CONVCASETOTEXT(JT_PATH_WRONG_TYPE)
+		CONVCASETOTEXT(JT_TIMEOUT)
+		CONVCASETOTEXT(JT_CANCELLED)
 		default:
 			return "unknown error code";
 	}
@@ -1775,6 +2210,48 @@ int jt_free_transfer(jt_access_token_t *at)
 	}
 }
 
+void jt_set_timeouts(jt_access_token_t *at, long connecttimeout, long timeout, long lowspeedlimit, long lowspeedtime)
+{
+	curl_easy_setopt(at->transfer.curl, CURLOPT_CONNECTTIMEOUT_MS, connecttimeout);
+	curl_easy_setopt(at->transfer.curl, CURLOPT_TIMEOUT_MS, timeout);
+	curl_easy_setopt(at->transfer.curl, CURLOPT_LOW_SPEED_LIMIT, lowspeedlimit);
+	curl_easy_setopt(at->transfer.curl, CURLOPT_LOW_SPEED_TIME, lowspeedtime);
+}
+
+void jt_set_coalesce_time(jt_access_token_t *at, int seconds)
+{
+	int i;
+
+	at->transfer.coalescetime = seconds;
+	if (seconds <= 0) {
+		for (i = 0; i < RECENT_COUNT; i++) {
+			jt_recent_clear(&at->transfer.recent[i]);
+		}
+	}
+}
+
+void jt_set_cancel(jt_access_token_t *at, volatile int *cancel)
+{
+	at->transfer.cancel = cancel;
+}
+
+void jt_set_progress(jt_access_token_t *at, void (*progress)(void *ctx), void *ctx)
+{
+	at->transfer.progress = progress;
+	at->transfer.progressctx = ctx;
+}
+
+void jt_set_share(jt_access_token_t *at, CURLSH *share)
+{
+	curl_easy_setopt(at->transfer.curl, CURLOPT_SHARE, share);
+}
+
+void jt_get_transfer_stats(jt_access_token_t *at, unsigned long *requests, unsigned long long *bytes)
+{
+	*requests = at->transfer.requests;
+	*bytes = at->transfer.bytes;
+}
+
 char *jt_get_page_token(int page)
 {
 	const char d0[] = "AEIMQUYcgkosw048";
@@ -1832,3 +2309,79 @@ int jt_get_page_number(const char *pageToken)
 
 	return page;
 }
+
+int jt_trace_enabled = 0;
+
+/** Trace file, NULL when tracing is disabled. */
+static FILE *jt_trace_fout = NULL;
+
+/** Time when the trace was started. */
+static struct timespec jt_trace_start;
+
+int jt_trace_open(const char *filename)
+{
+	if (jt_trace_fout != NULL) {
+		return 0;
+	}
+	jt_trace_fout = fopen(filename, "wt");
+	if (jt_trace_fout == NULL) {
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &jt_trace_start);
+	fprintf(jt_trace_fout, "[\n");
+	jt_trace_enabled = 1;
+	return 0;
+}
+
+void jt_trace_close(void)
+{
+	if (jt_trace_fout == NULL) {
+		return;
+	}
+	jt_trace_enabled = 0;
+
+	/* The last event has no comma and terminates the array. */
+	fprintf(jt_trace_fout, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}\n]\n",
+		(int) getpid(), program_invocation_short_name);
+	fclose(jt_trace_fout);
+	jt_trace_fout = NULL;
+}
+
+void jt_trace_event(char phase, const char *cat, const char *name, const char *detail)
+{
+	struct timespec now;
+	long long ts;
+	int pid;
+
+	if (jt_trace_fout == NULL) {
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ts = (now.tv_sec - jt_trace_start.tv_sec) * 1000000LL
+		+ (now.tv_nsec - jt_trace_start.tv_nsec) / 1000;
+	pid = getpid();
+
+	fprintf(jt_trace_fout, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":%d",
+		name, cat, phase, ts, pid, pid);
+	if (phase == 'i') {
+		/* Instant event of the thread. */
+		fprintf(jt_trace_fout, ",\"s\":\"t\"");
+	}
+	if (detail != NULL) {
+		const char *d;
+
+		fprintf(jt_trace_fout, ",\"args\":{\"detail\":\"");
+		/* Don't write keys or tokens in the query to the file. */
+		for (d = detail; (*d != 0) && (*d != '?'); d++) {
+			if ((*d == '"') || (*d == '\\')) {
+				fprintf(jt_trace_fout, "\\%c", *d);
+			} else if ((unsigned char) *d < 0x20) {
+				fprintf(jt_trace_fout, "\\u%04x", (unsigned char) *d);
+			} else {
+				fputc(*d, jt_trace_fout);
+			}
+		}
+		fprintf(jt_trace_fout, "\"}");
+	}
+	fprintf(jt_trace_fout, "},\n");
+}
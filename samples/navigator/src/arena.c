@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/** Alignment of allocations. */
+#define ARENA_ALIGN 8
+
+typedef struct arena_chunk_s arena_chunk_t;
+
+/** Chunk of memory, the data follows the header. */
+struct arena_chunk_s {
+	/** Next chunk in the list. */
+	arena_chunk_t *next;
+	/** Number of usable bytes after the header. */
+	size_t size;
+	/** Number of used bytes. */
+	size_t used;
+};
+
+struct arena_s {
+	/** Chunk where new allocations are taken from, first in list. */
+	arena_chunk_t *chunk;
+	/** Size of a normal chunk. */
+	size_t chunksize;
+};
+
+/** Size of the chunk header, keeps the data aligned. */
+#define ARENA_HEADER_SIZE ((sizeof(arena_chunk_t) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+static arena_chunk_t *arena_chunk_alloc(size_t size)
+{
+	arena_chunk_t *chunk;
+
+	chunk = malloc(ARENA_HEADER_SIZE + size);
+	if (chunk == NULL) {
+		return NULL;
+	}
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+arena_t *arena_alloc(size_t chunksize)
+{
+	arena_t *arena;
+
+	arena = malloc(sizeof(*arena));
+	if (arena == NULL) {
+		return NULL;
+	}
+	memset(arena, 0, sizeof(*arena));
+	arena->chunksize = chunksize;
+	arena->chunk = arena_chunk_alloc(chunksize);
+	if (arena->chunk == NULL) {
+		free(arena);
+		return NULL;
+	}
+	return arena;
+}
+
+void arena_free(arena_t *arena)
+{
+	arena_chunk_t *chunk;
+
+	if (arena == NULL) {
+		return;
+	}
+	chunk = arena->chunk;
+	while (chunk != NULL) {
+		arena_chunk_t *next = chunk->next;
+
+		free(chunk);
+		chunk = next;
+	}
+	arena->chunk = NULL;
+	free(arena);
+}
+
+void *arena_malloc(arena_t *arena, size_t size)
+{
+	arena_chunk_t *chunk;
+	void *rv;
+
+	size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+	chunk = arena->chunk;
+	if ((chunk == NULL) || ((chunk->size - chunk->used) < size)) {
+		if (size > arena->chunksize / 4) {
+			/* Large allocation gets its own chunk, so that the
+			 * free space of the current chunk isn't lost.
+			 */
+			chunk = arena_chunk_alloc(size);
+			if (chunk == NULL) {
+				return NULL;
+			}
+			if (arena->chunk != NULL) {
+				chunk->next = arena->chunk->next;
+				arena->chunk->next = chunk;
+			} else {
+				arena->chunk = chunk;
+			}
+		} else {
+			chunk = arena_chunk_alloc(arena->chunksize);
+			if (chunk == NULL) {
+				return NULL;
+			}
+			chunk->next = arena->chunk;
+			arena->chunk = chunk;
+		}
+	}
+	rv = ((char *) chunk) + ARENA_HEADER_SIZE + chunk->used;
+	chunk->used += size;
+	memset(rv, 0, size);
+	return rv;
+}
+
+char *arena_strdup(arena_t *arena, const char *str)
+{
+	char *rv;
+	size_t len;
+
+	if (str == NULL) {
+		return NULL;
+	}
+	len = strlen(str) + 1;
+	rv = arena_malloc(arena, len);
+	if (rv != NULL) {
+		memcpy(rv, str, len);
+	}
+	return rv;
+}
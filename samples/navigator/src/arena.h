@@ -0,0 +1,35 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+struct arena_s;
+
+typedef struct arena_s arena_t;
+
+/**
+ * Allocate an arena. Memory is taken from chunks and is only released
+ * all at once by arena_free(), so many small objects with the same
+ * lifetime don't need to be freed one by one.
+ *
+ * @param chunksize Size of each chunk in bytes.
+ *
+ * @returns Arena or NULL when out of memory.
+ */
+arena_t *arena_alloc(size_t chunksize);
+
+/** Free the arena and all memory allocated from it. */
+void arena_free(arena_t *arena);
+
+/**
+ * Allocate memory from the arena. The memory is cleared and aligned for
+ * any structure.
+ *
+ * @returns Pointer to memory or NULL when out of memory.
+ */
+void *arena_malloc(arena_t *arena, size_t size);
+
+/** Copy a string into the arena. Returns NULL if str is NULL. */
+char *arena_strdup(arena_t *arena, const char *str);
+
+#endif
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "log.h"
+#include "bench.h"
+
+/** Time in milliseconds between two key presses. */
+#define BENCH_KEY_DELAY 150
+/** Maximum length of a line in the script. */
+#define BENCH_LINE_SIZE 256
+
+/** Step of the script. */
+typedef struct {
+	/** Key to press, -1 for waiting only. */
+	int key;
+	/** Time in milliseconds to wait before this step. */
+	Uint32 delay;
+} bench_step_t;
+
+/** List of measured times. */
+typedef struct {
+	Uint32 *value;
+	unsigned int count;
+	unsigned int size;
+} bench_samples_t;
+
+struct bench_s {
+	/** Steps of the script. */
+	bench_step_t *step;
+	/** Number of steps. */
+	unsigned int count;
+	/** Allocated steps. */
+	unsigned int size;
+	/** Next step to execute. */
+	unsigned int pos;
+	/** Time when the next step is due, 0 before the start. */
+	Uint32 due;
+	/** Time when the script started. */
+	Uint32 start;
+	/** Time when the script finished. */
+	Uint32 end;
+	/** Work time of each frame. */
+	bench_samples_t frames;
+	/** Time to first thumbnail for each category. */
+	bench_samples_t thumbnails;
+	/** Category currently selected. */
+	const void *cat;
+	/** Time when cat was selected. */
+	Uint32 cattime;
+	/** Set when the thumbnail of cat was shown. */
+	int catdone;
+	/** Time from the start until the first frame waiting for input. */
+	Uint32 startup;
+};
+
+static int bench_add_step(bench_t *bench, int key, Uint32 delay)
+{
+	if (bench->count >= bench->size) {
+		bench_step_t *step;
+		unsigned int size;
+
+		size = (bench->size == 0) ? 64 : 2 * bench->size;
+		step = realloc(bench->step, size * sizeof(*step));
+		if (step == NULL) {
+			return -1;
+		}
+		bench->step = step;
+		bench->size = size;
+	}
+	bench->step[bench->count].key = key;
+	bench->step[bench->count].delay = delay;
+	bench->count++;
+	return 0;
+}
+
+static void bench_add_sample(bench_samples_t *samples, Uint32 value)
+{
+	if (samples->count >= samples->size) {
+		Uint32 *mem;
+		unsigned int size;
+
+		size = (samples->size == 0) ? 1024 : 2 * samples->size;
+		mem = realloc(samples->value, size * sizeof(*mem));
+		if (mem == NULL) {
+			return;
+		}
+		samples->value = mem;
+		samples->size = size;
+	}
+	samples->value[samples->count] = value;
+	samples->count++;
+}
+
+/** Parse one line of the script. */
+static int bench_parse_line(bench_t *bench, char *line, int (*lookup)(const char *name))
+{
+	char *cmd;
+	char *arg;
+	char *end;
+
+	/* Remove line end. */
+	end = line + strlen(line);
+	while ((end > line) && isspace((unsigned char) end[-1])) {
+		end--;
+	}
+	*end = 0;
+	cmd = line;
+	while (isspace((unsigned char) *cmd)) {
+		cmd++;
+	}
+	if ((*cmd == 0) || (*cmd == '#')) {
+		return 0;
+	}
+	arg = cmd;
+	while ((*arg != 0) && !isspace((unsigned char) *arg)) {
+		arg++;
+	}
+	if (*arg != 0) {
+		*arg = 0;
+		arg++;
+		while (isspace((unsigned char) *arg)) {
+			arg++;
+		}
+	}
+
+	if (strcmp(cmd, "wait") == 0) {
+		return bench_add_step(bench, -1, strtoul(arg, NULL, 0));
+	} else if (strcmp(cmd, "text") == 0) {
+		while (*arg != 0) {
+			int c = tolower((unsigned char) *arg);
+
+			/* SDL key symbols of letters and digits are ASCII. */
+			if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+				if (bench_add_step(bench, c, BENCH_KEY_DELAY) != 0) {
+					return -1;
+				}
+			}
+			arg++;
+		}
+		return 0;
+	} else {
+		int key;
+		int count = 1;
+		int i;
+
+		key = lookup(cmd);
+		if (key < 0) {
+			LOG_ERROR("Unknown button '%s' in benchmark script.\n", cmd);
+			return -1;
+		}
+		if (*arg != 0) {
+			count = strtol(arg, NULL, 0);
+		}
+		for (i = 0; i < count; i++) {
+			if (bench_add_step(bench, key, BENCH_KEY_DELAY) != 0) {
+				return -1;
+			}
+		}
+		return 0;
+	}
+}
+
+bench_t *bench_alloc(const char *filename, int (*lookup)(const char *name))
+{
+	bench_t *bench;
+	FILE *fin;
+	char line[BENCH_LINE_SIZE];
+
+	fin = fopen(filename, "rt");
+	if (fin == NULL) {
+		LOG_ERROR("Failed to open benchmark script %s.\n", filename);
+		return NULL;
+	}
+	bench = malloc(sizeof(*bench));
+	if (bench == NULL) {
+		fclose(fin);
+		return NULL;
+	}
+	memset(bench, 0, sizeof(*bench));
+
+	while (fgets(line, sizeof(line), fin) != NULL) {
+		if (bench_parse_line(bench, line, lookup) != 0) {
+			fclose(fin);
+			bench_free(bench);
+			return NULL;
+		}
+	}
+	fclose(fin);
+
+	return bench;
+}
+
+void bench_free(bench_t *bench)
+{
+	if (bench == NULL) {
+		return;
+	}
+	if (bench->step != NULL) {
+		free(bench->step);
+		bench->step = NULL;
+	}
+	if (bench->frames.value != NULL) {
+		free(bench->frames.value);
+		bench->frames.value = NULL;
+	}
+	if (bench->thumbnails.value != NULL) {
+		free(bench->thumbnails.value);
+		bench->thumbnails.value = NULL;
+	}
+	free(bench);
+}
+
+/** Push a key press and release into the SDL event queue. */
+static void bench_push_key(int key)
+{
+	SDL_Event event;
+
+	memset(&event, 0, sizeof(event));
+	event.type = SDL_KEYDOWN;
+	event.key.type = SDL_KEYDOWN;
+	event.key.state = SDL_PRESSED;
+	event.key.keysym.sym = key;
+	SDL_PushEvent(&event);
+
+	event.type = SDL_KEYUP;
+	event.key.type = SDL_KEYUP;
+	event.key.state = SDL_RELEASED;
+	SDL_PushEvent(&event);
+}
+
+int bench_run(bench_t *bench, Uint32 now)
+{
+	if (bench->start == 0) {
+		bench->start = now;
+		bench->due = now + ((bench->count > 0) ? bench->step[0].delay : 0);
+	}
+	while ((bench->pos < bench->count) && ((Sint32) (now - bench->due) >= 0)) {
+		if (bench->step[bench->pos].key >= 0) {
+			bench_push_key(bench->step[bench->pos].key);
+		}
+		bench->pos++;
+		if (bench->pos < bench->count) {
+			bench->due = now + bench->step[bench->pos].delay;
+		}
+	}
+	if (bench->pos >= bench->count) {
+		if (bench->end == 0) {
+			bench->end = now;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+void bench_frame(bench_t *bench, Uint32 worktime)
+{
+	bench_add_sample(&bench->frames, worktime);
+}
+
+void bench_category(bench_t *bench, const void *cat, int thumbnail, Uint32 now)
+{
+	if (cat != bench->cat) {
+		bench->cat = cat;
+		bench->cattime = now;
+		bench->catdone = 0;
+	}
+	if ((cat != NULL) && thumbnail && !bench->catdone) {
+		bench_add_sample(&bench->thumbnails, now - bench->cattime);
+		bench->catdone = 1;
+	}
+}
+
+void bench_startup(bench_t *bench, Uint32 startup)
+{
+	bench->startup = startup;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+	Uint32 x = *((const Uint32 *) a);
+	Uint32 y = *((const Uint32 *) b);
+
+	return (x > y) - (x < y);
+}
+
+/** Print percentiles of samples. */
+static void bench_print_samples(FILE *fout, const char *name, bench_samples_t *samples)
+{
+	unsigned int n = samples->count;
+
+	if (n == 0) {
+		fprintf(fout, "%-24s no samples\n", name);
+		return;
+	}
+	qsort(samples->value, n, sizeof(samples->value[0]), bench_compare);
+	fprintf(fout, "%-24s n %u p50 %u p90 %u p99 %u max %u ms\n", name, n,
+		samples->value[(n - 1) * 50 / 100],
+		samples->value[(n - 1) * 90 / 100],
+		samples->value[(n - 1) * 99 / 100],
+		samples->value[n - 1]);
+}
+
+void bench_report(bench_t *bench, FILE *fout, unsigned long requests, unsigned long long bytes)
+{
+	struct rusage usage;
+
+	memset(&usage, 0, sizeof(usage));
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(fout, "Benchmark results:\n");
+	fprintf(fout, "%-24s %u ms\n", "duration", bench->end - bench->start);
+	fprintf(fout, "%-24s %u ms\n", "first interactive frame", bench->startup);
+	bench_print_samples(fout, "frame time", &bench->frames);
+	bench_print_samples(fout, "first thumbnail", &bench->thumbnails);
+	fprintf(fout, "%-24s %lu\n", "requests", requests);
+	fprintf(fout, "%-24s %llu\n", "bytes fetched", bytes);
+	fprintf(fout, "%-24s %ld KiB\n", "peak RSS", usage.ru_maxrss);
+}
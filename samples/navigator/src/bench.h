@@ -0,0 +1,59 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include <SDL/SDL.h>
+
+struct bench_s;
+
+typedef struct bench_s bench_t;
+
+/**
+ * Load a benchmark script. Each line contains one command:
+ *
+ * <button> [count]   Press a button count times, e.g. "down 10" or "cross".
+ * wait <ms>          Do nothing for the time in milliseconds.
+ * text <string>      Type letters and digits, e.g. for entering a search.
+ *
+ * Empty lines and lines starting with '#' are ignored.
+ *
+ * @param filename Script file.
+ * @param lookup Function returning the key of a button name or -1.
+ *
+ * @returns Benchmark handle or NULL on error.
+ */
+bench_t *bench_alloc(const char *filename, int (*lookup)(const char *name));
+
+/** Free benchmark. */
+void bench_free(bench_t *bench);
+
+/**
+ * Push key events of the script which are due.
+ *
+ * @returns 1 when the script is finished.
+ */
+int bench_run(bench_t *bench, Uint32 now);
+
+/** Add the time in milliseconds used for a frame, without sleeping. */
+void bench_frame(bench_t *bench, Uint32 worktime);
+
+/**
+ * Measure the time until the first thumbnail is shown for a category.
+ *
+ * @param cat Selected category, only compared.
+ * @param thumbnail Set when the thumbnail of the selected video is shown.
+ */
+void bench_category(bench_t *bench, const void *cat, int thumbnail, Uint32 now);
+
+/** Set the time in milliseconds from the start until the first frame waiting for input. */
+void bench_startup(bench_t *bench, Uint32 startup);
+
+/**
+ * Print results.
+ *
+ * @param requests Number of HTTP requests issued.
+ * @param bytes Number of bytes fetched.
+ */
+void bench_report(bench_t *bench, FILE *fout, unsigned long requests, unsigned long long bytes);
+
+#endif
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "glyphatlas.h"
+
+/** Width of an atlas page in pixels. */
+#define ATLAS_WIDTH 512
+/** Number of text lines stored in an atlas page. */
+#define ATLAS_LINES 8
+/** Number of glyphs in a glyph table page (indexed by lower byte). */
+#define GLYPH_PAGE_SIZE 256
+
+/** Position of a rendered glyph in the atlas. */
+typedef struct {
+	/** Index of atlas page, -1 when the glyph has no pixels. */
+	int page;
+	/** Position in atlas page, the width is the advance of the glyph. */
+	SDL_Rect rect;
+	/** Set when the glyph was rendered. */
+	int loaded;
+} glyph_t;
+
+struct glyphatlas_s {
+	/** Font used for rendering. */
+	TTF_Font *font;
+	/** Foreground color. */
+	SDL_Color color;
+	/** Surface defining the pixel format. */
+	SDL_Surface *screen;
+	/** Height of a text line. */
+	int height;
+	/** Glyphs of the Unicode BMP, indexed by upper byte of the code point. */
+	glyph_t *table[256];
+	/** Atlas pages storing the rendered glyphs. */
+	SDL_Surface **pages;
+	/** Number of atlas pages. */
+	int numpages;
+	/** Next free x position in last page. */
+	int x;
+	/** Next free y position in last page. */
+	int y;
+};
+
+glyphatlas_t *glyphatlas_alloc(TTF_Font *font, SDL_Color color, SDL_Surface *screen)
+{
+	glyphatlas_t *atlas;
+
+	atlas = malloc(sizeof(*atlas));
+	if (atlas == NULL) {
+		return NULL;
+	}
+	memset(atlas, 0, sizeof(*atlas));
+	atlas->font = font;
+	atlas->color = color;
+	atlas->screen = screen;
+	atlas->height = TTF_FontHeight(font);
+
+	return atlas;
+}
+
+void glyphatlas_free(glyphatlas_t *atlas)
+{
+	int i;
+
+	if (atlas == NULL) {
+		return;
+	}
+	for (i = 0; i < 256; i++) {
+		if (atlas->table[i] != NULL) {
+			free(atlas->table[i]);
+			atlas->table[i] = NULL;
+		}
+	}
+	for (i = 0; i < atlas->numpages; i++) {
+		SDL_FreeSurface(atlas->pages[i]);
+		atlas->pages[i] = NULL;
+	}
+	if (atlas->pages != NULL) {
+		free(atlas->pages);
+		atlas->pages = NULL;
+	}
+	free(atlas);
+}
+
+void glyphatlas_set_screen(glyphatlas_t *atlas, SDL_Surface *screen)
+{
+	atlas->screen = screen;
+}
+
+int glyphatlas_height(glyphatlas_t *atlas)
+{
+	return atlas->height;
+}
+
+int glyphatlas_charlen(const char *text)
+{
+	unsigned char c;
+	int len;
+	int i;
+
+	c = text[0];
+	if (c == 0) {
+		return 0;
+	} else if ((c & 0xE0) == 0xC0) {
+		len = 2;
+	} else if ((c & 0xF0) == 0xE0) {
+		len = 3;
+	} else if ((c & 0xF8) == 0xF0) {
+		len = 4;
+	} else {
+		/* ASCII or invalid byte. */
+		return 1;
+	}
+	for (i = 1; i < len; i++) {
+		if ((text[i] & 0xC0) != 0x80) {
+			/* Broken sequence. */
+			return i;
+		}
+	}
+	return len;
+}
+
+/** Get Unicode code point of a UTF-8 character with len bytes. */
+static Uint32 glyphatlas_decode(const char *text, int len)
+{
+	const unsigned char *t = (const unsigned char *) text;
+
+	switch (len) {
+		case 2:
+			return ((t[0] & 0x1F) << 6) | (t[1] & 0x3F);
+		case 3:
+			return ((t[0] & 0x0F) << 12) | ((t[1] & 0x3F) << 6) | (t[2] & 0x3F);
+		case 4:
+			return ((t[0] & 0x07) << 18) | ((t[1] & 0x3F) << 12) | ((t[2] & 0x3F) << 6) | (t[3] & 0x3F);
+		default:
+			return t[0];
+	}
+}
+
+/** Allocate a new atlas page. */
+static int glyphatlas_add_page(glyphatlas_t *atlas)
+{
+	SDL_PixelFormat *fmt = atlas->screen->format;
+	SDL_Surface **pages;
+	SDL_Surface *page;
+	Uint32 key;
+
+	page = SDL_CreateRGBSurface(SDL_SWSURFACE, ATLAS_WIDTH, ATLAS_LINES * atlas->height,
+		fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+	if (page == NULL) {
+		LOG_ERROR("Failed to allocate glyph atlas: %s\n", SDL_GetError());
+		return -1;
+	}
+	pages = realloc(atlas->pages, (atlas->numpages + 1) * sizeof(*pages));
+	if (pages == NULL) {
+		SDL_FreeSurface(page);
+		return -1;
+	}
+	atlas->pages = pages;
+
+	/* Transparent background, use a color which is different to the text. */
+	if ((atlas->color.r | atlas->color.g | atlas->color.b) == 0) {
+		key = SDL_MapRGB(page->format, 255, 255, 255);
+	} else {
+		key = SDL_MapRGB(page->format, 0, 0, 0);
+	}
+	SDL_FillRect(page, NULL, key);
+	SDL_SetColorKey(page, SDL_SRCCOLORKEY, key);
+
+	atlas->pages[atlas->numpages] = page;
+	atlas->numpages++;
+	atlas->x = 0;
+	atlas->y = 0;
+
+	return 0;
+}
+
+/** Render glyph into the atlas. */
+static void glyphatlas_render(glyphatlas_t *atlas, glyph_t *glyph, const char *text, int len)
+{
+	SDL_Surface *sText;
+	SDL_Rect dst;
+	char buffer[5];
+
+	glyph->loaded = 1;
+	glyph->page = -1;
+	memset(&glyph->rect, 0, sizeof(glyph->rect));
+
+	memcpy(buffer, text, len);
+	buffer[len] = 0;
+	sText = TTF_RenderUTF8_Solid(atlas->font, buffer, atlas->color);
+	if (sText == NULL) {
+		return;
+	}
+	glyph->rect.w = (sText->w < ATLAS_WIDTH) ? sText->w : ATLAS_WIDTH;
+	glyph->rect.h = (sText->h < atlas->height) ? sText->h : atlas->height;
+
+	if ((atlas->numpages > 0) && ((atlas->x + glyph->rect.w) > ATLAS_WIDTH)) {
+		/* Next line in atlas. */
+		atlas->x = 0;
+		atlas->y += atlas->height;
+	}
+	if ((atlas->numpages == 0) || ((atlas->y + atlas->height) > atlas->pages[atlas->numpages - 1]->h)) {
+		if (glyphatlas_add_page(atlas) != 0) {
+			/* Advance is known, but nothing will be drawn. */
+			SDL_FreeSurface(sText);
+			return;
+		}
+	}
+	glyph->page = atlas->numpages - 1;
+	glyph->rect.x = atlas->x;
+	glyph->rect.y = atlas->y;
+	dst = glyph->rect;
+	SDL_BlitSurface(sText, NULL, atlas->pages[glyph->page], &dst);
+	atlas->x += glyph->rect.w;
+
+	SDL_FreeSurface(sText);
+}
+
+/** Get glyph of the first character in text, render it when needed. */
+static glyph_t *glyphatlas_get(glyphatlas_t *atlas, const char *text, int len)
+{
+	glyph_t *glyph;
+	Uint32 ch;
+
+	ch = glyphatlas_decode(text, len);
+	if (ch > 0xFFFF) {
+		/* Not supported by SDL_ttf. */
+		ch = '?';
+		text = "?";
+		len = 1;
+	}
+	if (atlas->table[ch >> 8] == NULL) {
+		atlas->table[ch >> 8] = malloc(GLYPH_PAGE_SIZE * sizeof(glyph_t));
+		if (atlas->table[ch >> 8] == NULL) {
+			return NULL;
+		}
+		memset(atlas->table[ch >> 8], 0, GLYPH_PAGE_SIZE * sizeof(glyph_t));
+	}
+	glyph = &atlas->table[ch >> 8][ch & 0xFF];
+	if (!glyph->loaded) {
+		glyphatlas_render(atlas, glyph, text, len);
+	}
+	return glyph;
+}
+
+int glyphatlas_width(glyphatlas_t *atlas, const char *text, int len)
+{
+	int width = 0;
+	int pos = 0;
+
+	while ((len < 0) || (pos < len)) {
+		glyph_t *glyph;
+		int n;
+
+		n = glyphatlas_charlen(&text[pos]);
+		if (n == 0) {
+			break;
+		}
+		glyph = glyphatlas_get(atlas, &text[pos], n);
+		if (glyph != NULL) {
+			width += glyph->rect.w;
+		}
+		pos += n;
+	}
+	return width;
+}
+
+int glyphatlas_draw(glyphatlas_t *atlas, SDL_Surface *dst, int x, int y, const char *text, int len, SDL_Rect *clip)
+{
+	int width = 0;
+	int pos = 0;
+
+	if (clip != NULL) {
+		SDL_SetClipRect(dst, clip);
+	}
+	while ((len < 0) || (pos < len)) {
+		glyph_t *glyph;
+		int n;
+
+		n = glyphatlas_charlen(&text[pos]);
+		if (n == 0) {
+			break;
+		}
+		glyph = glyphatlas_get(atlas, &text[pos], n);
+		if (glyph != NULL) {
+			int visible = 1;
+
+			if (clip != NULL) {
+				if ((x + width + glyph->rect.w) <= clip->x) {
+					visible = 0;
+				}
+				if ((x + width) >= (clip->x + clip->w)) {
+					visible = 0;
+				}
+			}
+			if (visible && (glyph->page >= 0)) {
+				SDL_Rect src = glyph->rect;
+				SDL_Rect rect;
+
+				rect.x = x + width;
+				rect.y = y;
+				rect.w = 0;
+				rect.h = 0;
+				SDL_BlitSurface(atlas->pages[glyph->page], &src, dst, &rect);
+			}
+			width += glyph->rect.w;
+		}
+		pos += n;
+	}
+	if (clip != NULL) {
+		SDL_SetClipRect(dst, NULL);
+	}
+	return width;
+}
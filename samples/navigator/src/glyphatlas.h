@@ -0,0 +1,60 @@
+#ifndef _GLYPHATLAS_H_
+#define _GLYPHATLAS_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+struct glyphatlas_s;
+
+typedef struct glyphatlas_s glyphatlas_t;
+
+/**
+ * Allocate glyph atlas for a font. Each glyph is rendered only once into a
+ * surface of the screen format. Text is composed by blitting the glyphs.
+ *
+ * @param font Font used for rendering. Must stay valid while the atlas is used.
+ * @param color Foreground color of the text.
+ * @param screen Surface defining the pixel format of the atlas.
+ */
+glyphatlas_t *glyphatlas_alloc(TTF_Font *font, SDL_Color color, SDL_Surface *screen);
+
+/** Free atlas and all rendered glyphs. */
+void glyphatlas_free(glyphatlas_t *atlas);
+
+/**
+ * Set new screen after the video mode was set again. The pixel format must
+ * be the same.
+ */
+void glyphatlas_set_screen(glyphatlas_t *atlas, SDL_Surface *screen);
+
+/** Get height of a line of text in pixels. */
+int glyphatlas_height(glyphatlas_t *atlas);
+
+/**
+ * Get the length of the first UTF-8 character in text.
+ *
+ * @returns Number of bytes, 0 at the end of the text.
+ */
+int glyphatlas_charlen(const char *text);
+
+/**
+ * Get width of text in pixels.
+ *
+ * @param len Number of bytes of text to measure, -1 for the whole string.
+ */
+int glyphatlas_width(glyphatlas_t *atlas, const char *text, int len);
+
+/**
+ * Draw text.
+ *
+ * @param dst Destination surface.
+ * @param x Position of the left side of the text.
+ * @param y Position of the top of the text.
+ * @param len Number of bytes of text to draw, -1 for the whole string.
+ * @param clip Only draw inside this rectangle, NULL for whole surface.
+ *
+ * @returns Width of the text in pixels.
+ */
+int glyphatlas_draw(glyphatlas_t *atlas, SDL_Surface *dst, int x, int y, const char *text, int len, SDL_Rect *clip);
+
+#endif
@@ -5,12 +5,25 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
 #include <SDL/SDL_image.h>
 #include <SDL/SDL_ttf.h>
 
 #include "log.h"
 #include "gui.h"
 #include "transfer.h"
+#include "textcache.h"
+#include "glyphatlas.h"
+#include "thumbnail.h"
+#include "player.h"
+#include "snapshot.h"
+#include "arena.h"
+#include "intern.h"
+#include "quality.h"
+#include "bench.h"
+#include "metrics.h"
 #include "pictures.h"
 #include "clientid.h"
 #include "libjt.h"
@@ -21,6 +34,7 @@
 #define SECRET_FILE ".client_secret.json"
 #define TITLE_FILE ".accounttitle"
 #define MENU_STATE_FILE ".menustate"
+#define SNAPSHOT_FILE ".navigatorsnapshot"
 #ifndef __arm__
 
 /* Buttons for PS2 and normal Linux. */
@@ -50,7 +64,7 @@
 #define BTN_R2 SDLK_u
 #define BTN_UNUSED SDLK_l
 #endif
-/** Maximum images loaded while painting. */
+/** Maximum rows of thumbnails loaded while painting. */
 #define MAX_LOAD_WHILE_PAINT 1
 /** Maximum retry count for images. */
 #define IMG_LOAD_RETRY 5
@@ -62,10 +76,18 @@
 #define MAX_VIDS 5
 /** Maximum number of Youtube accounts supported. */
 #define MAX_ACCOUNTS 10
-/** Chunk size for loadinf files. */
-#define CHUNK_SIZE 256
-/** Size of cache for small text. */
-#define TITLE_CACHE_ENTRIES 30
+/** Maximum number of different button descriptions. */
+#define MAX_LEGENDS 24
+/** Number of buttons with description (cross, circle, triangle, square). */
+#define LEGEND_BUTTONS 4
+/** Memory in bytes used for caching images of text. */
+#define TEXT_CACHE_SIZE (1024 * 1024)
+/** Memory in bytes for thumbnails, smaller thumbnails are loaded above it. */
+#define THUMB_MEMORY_BUDGET (24 * 1024 * 1024)
+/** Time in milliseconds in which the thumbnails of a row should be loaded. */
+#define THUMB_ROW_TIME 250
+/** Time in milliseconds in which the thumbnail of the selected video should be loaded. */
+#define THUMB_SELECTED_TIME 150
 
 #define BUFFER_SIZE 4096
 
@@ -88,25 +110,82 @@
  */
 #define PRESERVE_ELEM 3
 
-/** Default wait time for a message to display in frames. */
-#define DEFAULT_SLEEP (4 * 50)
+/** Size of the memory chunks of a category. */
+#define CAT_ARENA_SIZE 1024
+/** Size of the memory chunks of a page, the videos of a page fit into one. */
+#define PAGE_ARENA_SIZE 4096
+
+/** Interned IDs are dropped when returning to the main menu with more than
+ * this number of IDs.
+ */
+#define MAX_INTERNED_IDS 4096
+
+/** Number of categories created from the subscription index at once. */
+#define SUBSCRIPTION_WINDOW 5
+/** Maximum number of channel IDs in one request (limit of the YouTube API). */
+#define CHANNEL_BATCH 50
+
+/** Minimum number of categories prefetched ahead of the selected category. */
+#define PREFETCH_MIN_CATS 1
+/** Maximum number of categories prefetched ahead, must be less than
+ * PRESERVE_CAT, otherwise prefetched categories are freed again.
+ */
+#define PREFETCH_MAX_CATS 5
+/** Time window in milliseconds for measuring the navigation speed. */
+#define PREFETCH_WINDOW 1000
+/** Minimum time in milliseconds between loading pages in advance. Input is
+ * handled between the page loads.
+ */
+#define PREFETCH_INTERVAL 250
+/** Number of recorded category changes for measuring the navigation speed. */
+#define NAV_HISTORY 8
+/** Hosts connected at startup: API, OAuth and thumbnails. */
+static const char *const warmup_urls[] = {
+	"https://www.googleapis.com/",
+	"https://accounts.google.com/",
+	"https://i.ytimg.com/"
+};
+
+/** Events of user input which preempt work done in advance. */
+#define INPUT_EVENT_MASK (SDL_QUITMASK | SDL_KEYDOWNMASK | SDL_JOYBUTTONDOWNMASK | SDL_JOYAXISMOTIONMASK | SDL_JOYHATMOTIONMASK)
+
+/** Default wait time for a message to display in milliseconds. */
+#define DEFAULT_SLEEP (4 * 1000)
+/** Wait time between polls for the access token in milliseconds. */
+#define TOKEN_POLL_TIME (3 * 1000)
+/** Additional wait time when the server requests to slow down polling. */
+#define TOKEN_POLL_SLOW_DOWN 500
+
+/** Number of frames painted per second while something is animated. */
+#define FRAME_RATE 25
+/** Time for one frame in milliseconds. */
+#define FRAME_TIME (1000 / FRAME_RATE)
+/** Maximum time in milliseconds to sleep when nothing is animated. The screen
+ * is repainted at least this often.
+ */
+#define IDLE_FRAME_TIME 1000
+/** Granularity in milliseconds for checking new events while sleeping. */
+#define EVENT_POLL_TIME 10
+/** Resolve the stream URL when a video is selected for this time in milliseconds. */
+#define PLAYER_HOVER_TIME 700
+/** Time in seconds in which libjt shares the response of identical requests. */
+#define COALESCE_TIME 30
+/** Time in milliseconds between two samples of the performance counters. */
+#define METRICS_INTERVAL 1000
 
 #define BORDER_X 40
 #define BORDER_Y 40
+/** Y position of the first row of thumbnails and menu entries. */
+#define THUMB_Y 90
 #define DIST_FORCED_LINE_BREAK 10
 
-/** Maximum value for scroll counter, slows down the scrolling of text. */
-#ifdef __mipsel__
-#define SCROLL_COUNT_MAX 7
-#else
-#define SCROLL_COUNT_MAX 20
-#endif
+/** Maximum value for scroll counter, slows down the scrolling of text. The
+ * counter is incremented once per frame, so the speed is the same on all
+ * platforms.
+ */
+#define SCROLL_COUNT_MAX 10
 /** Start value for counting frames until text is scrolled by one pixel. */
-#ifdef __mipsel__
-#define SCROLL_COUNT_START 6
-#else
-#define SCROLL_COUNT_START 16
-#endif
+#define SCROLL_COUNT_START 8
 /** Same as SCROLL_COUNT_START but when the end of the text is reached and it
  * should scroll into the other direction. This should be a smaller value, so
  * the scrolling shortly stops. So the user has time to read the text completely.
@@ -117,6 +196,10 @@
 #define CHECKSTR(stringptr) (((stringptr) != NULL) ? (stringptr) : "(null)")
 
 #define MENU_VERSION 1
+/** Version of the snapshot format. */
+#define SNAPSHOT_VERSION 3
+/** Ignore snapshots older than this time in seconds, page tokens expire. */
+#define SNAPSHOT_MAX_AGE (30 * 60)
 
 #define CASESTATE(state) \
 	case state: \
@@ -205,8 +288,20 @@ const char *get_state_text(enum gui_state state)
 	return "unknown";
 }
 
+typedef struct gui_page_s gui_page_t;
+
+/** Memory of the videos loaded with one page of the YouTube API. */
+struct gui_page_s {
+	/** Video nodes and their strings, the page itself is also part of it. */
+	arena_t *arena;
+	/** Number of videos of the page in the list, the arena is freed when the last one is removed. */
+	int count;
+};
+
 /** The structure describes a YouTube video (playlist item). */
 struct gui_elem_s {
+	/** Page the video and its strings are allocated from. */
+	gui_page_t *page;
 	/** Small thumbnail of video. */
 	SDL_Surface *image;
 	/** Medium size thumbnail of video. */
@@ -219,8 +314,14 @@ struct gui_elem_s {
 	char *url;
 	/** URL to medium size thumbnail. */
 	char *urlmedium;
+	/** URL to high resolution thumbnail. */
+	char *urlhigh;
+	/** Thumbnail size of the last request for image. */
+	enum quality_size sizesmall;
+	/** Thumbnail size of the last request for imagemedium. */
+	enum quality_size sizemedium;
 	/** YouTube video ID. */
-	char *videoid;
+	const char *videoid;
 	/** Pointer to next video in list. */
 	gui_elem_t *prev;
 	/** Pointer to previous video in list. */
@@ -240,11 +341,13 @@ struct gui_elem_s {
 	/** Counter to delay text scrolling. */
 	int textScrollCounter;
 	/** YouTube channel ID. */
-	char *channelid;
+	const char *channelid;
 };
 
 /** The structure describes a category (e.g. favorites or subscribed channel). */
 struct gui_cat_s {
+	/** Memory of the category and its strings. */
+	arena_t *arena;
 	/** First element of playlist items (YouTube videos). */
 	gui_elem_t *elem;
 	/** Currently selected YouTube video. */
@@ -252,9 +355,9 @@ struct gui_cat_s {
 	/** Where to add this item in gui->categories. */
 	gui_cat_t *where;
 	/** YouTube channel ID. */
-	char *channelid;
+	const char *channelid;
 	/** YouTube playlist ID. */
-	char *playlistid;
+	const char *playlistid;
 	/** YouTube searchterm. */
 	char *searchterm;
 	/** Pointer to previous category in list. */
@@ -299,6 +402,16 @@ struct gui_cat_s {
 	int scrollpos;
 };
 
+/** Entry in the list of all subscriptions of the account. */
+typedef struct {
+	/** YouTube channel ID. */
+	const char *channelid;
+	/** Subscription title. */
+	char *title;
+	/** Uploads playlist of the channel, NULL until looked up. */
+	const char *playlistid;
+} gui_sub_t;
+
 typedef struct gui_menu_entry_s gui_menu_entry_t;
 
 /** Menu entry fro main menu. */
@@ -316,9 +429,9 @@ struct gui_menu_entry_s {
 	/** Token number for account. */
 	int tokennr;
 	/** Playlist ID of this entry. */
-	char *playlistid;
+	const char *playlistid;
 	/** Channel ID of this entry. */
-	char *channelid;
+	const char *channelid;
 	/** Searchterm */
 	char *searchterm;
 	/** Scroll position. */
@@ -332,15 +445,37 @@ struct gui_menu_entry_s {
 	gui_menu_entry_t *prev;
 };
 
-/** Entry for caching images of text. */
+/** Rendered description of a button. */
 typedef struct {
-	/** Text pointer of cached title image. */
-	const char *title;
-	/** The cached title image. */
-	SDL_Surface *sText;
-	/** Hit counter. */
-	int count;
-} title_cache_t;
+	/** Text of the description, a string constant. */
+	const char *text;
+	SDL_Surface *image;
+} gui_legend_t;
+
+/**
+ * Positions which only change with the screen mode or with the shown button
+ * descriptions, so they are not computed again for each frame.
+ */
+typedef struct {
+	/** Screen size the layout was computed for. */
+	int w;
+	int h;
+	/** Area around the logo which must not be covered by thumbnails. */
+	int logox0;
+	int logoy0;
+	int logox1;
+	int logoy1;
+	/** Thumbnails and menu entries need to end above this line. */
+	int contentbottom;
+	/** Set when legendpic and legendpos match legendtext. */
+	int legendvalid;
+	/** Button descriptions the positions were computed for. */
+	SDL_Surface *legendtext[LEGEND_BUTTONS];
+	/** Positions of the button pictures. */
+	SDL_Rect legendpic[LEGEND_BUTTONS];
+	/** Positions of the button descriptions. */
+	SDL_Rect legendpos[LEGEND_BUTTONS];
+} gui_layout_t;
 
 struct gui_s {
 	/** Path to resources like images. */
@@ -348,6 +483,7 @@ struct gui_s {
 	/** YouTube logo. */
 	SDL_Surface *logo;
 	SDL_Surface *cross;
+	/** Description of cross button, owned by legends. */
 	SDL_Surface *cross_text;
 	SDL_Surface *circle;
 	SDL_Surface *circle_text;
@@ -356,6 +492,12 @@ struct gui_s {
 	SDL_Surface *square;
 	SDL_Surface *square_text;
 	int description_status;
+	/** Button descriptions rendered once and kept for all modes. */
+	gui_legend_t legends[MAX_LEGENDS];
+	/** Number of used legends. */
+	unsigned int legendcount;
+	/** Cached positions of screen elements. */
+	gui_layout_t layout;
 	/** Output screen */
 	SDL_Surface *screen;
 	/** Position of YouTube logo on screen. */
@@ -368,12 +510,32 @@ struct gui_s {
 	TTF_Font *smallfont;
 	/** Pointer to font used to write description of buttons. */
 	TTF_Font *descfont;
+	/** Glyphs of font for drawing changing text. */
+	glyphatlas_t *fontatlas;
+	/** Glyphs of smallfont for drawing changing text. */
+	glyphatlas_t *smallatlas;
 
 	/** The height of the letters in the youtube logo. */
 	int mindistance;
+	/** Maximum size of small thumbnails shown on screen. */
+	SDL_Rect smallsize;
+	/** Maximum size of medium thumbnails shown on screen. */
+	SDL_Rect mediumsize;
+	/** Set by gui_paint() when the painted frame contains scrolling text. */
+	int animating;
+	/** Set by gui_paint() when a thumbnail was loaded while painting. */
+	int loading;
 
 	/** Handle for transfering web content. */
 	transfer_t *transfer;
+	/** Selects thumbnail sizes by link speed and memory. */
+	quality_t *quality;
+	/** Time when the memory used was last given to quality. */
+	Uint32 memorytime;
+	/** Handle for resolving stream URLs and playing videos. */
+	player_t *player;
+	/** Set when the next video of the playlist can be started without delay. */
+	int gapless;
 
 	/** Categories chown in GUI. Pointer to first element.
 	 * NULL if empty. categories->prev points to last element.
@@ -384,6 +546,10 @@ struct gui_s {
 
 	/** YouTube access. */
 	jt_access_token_t *at;
+	/** Number of API requests of freed access handles. */
+	unsigned long jtrequests;
+	/** Number of API bytes of freed access handles. */
+	unsigned long long jtbytes;
 
 	/** Status */
 	char *statusmsg;
@@ -397,12 +563,42 @@ struct gui_s {
 	/** Categories where channels needs to be loaded. */
 	gui_cat_t *get_channel_cat;
 
+	/** All subscriptions of the account, categories are only created for
+	 * the part around the selected one.
+	 */
+	gui_sub_t *subs;
+	/** Number of entries in subs. */
+	int subcount;
+
 	/** True if in fullscreen mode. */
 	int fullscreenmode;
+	/** Flags used for setting the video mode. */
+	Uint32 videoflags;
+	/** Size of the video mode while the display is suspended. */
+	SDL_Rect videosize;
+	/** Bits per pixel of the video mode while the display is suspended. */
+	int videobpp;
+	/** Release the display while playing videos instead of only leaving fullscreen. */
+	int resident;
 
 	/** Used to return from channel playlist. */
 	gui_cat_t *prev_cat;
 
+	/** Direction of last category change, 1 for next and -1 for previous. */
+	int navdir;
+	/** Time of the last category changes. */
+	Uint32 navtime[NAV_HISTORY];
+	/** Next index in navtime. */
+	int navpos;
+	/** Time when the last page was loaded in advance. */
+	Uint32 prefetchtime;
+	/** Set when a thumbnail was prefetched in this frame. */
+	int prefetching;
+	/** Set while a page is loaded in advance, user input cancels it. */
+	int prefetchpage;
+	/** Cancels the running libjt request when set. */
+	volatile int cancel;
+
 	/** SDL Joystick handle. */
 	SDL_Joystick *joystick;
 
@@ -414,8 +610,45 @@ struct gui_s {
 	/** True, if account is allocated. */
 	int account_allocated[MAX_ACCOUNTS];
 
-	/** Cache for images of small text. */
-	title_cache_t title_cache_table[TITLE_CACHE_ENTRIES];
+	/** Cache for images of text. */
+	textcache_t *textcache;
+
+	/** Interned channel, playlist and video IDs, compared by pointer. */
+	intern_t *ids;
+
+	/** Mapped snapshot of the last run, contains pixels of restored thumbnails. */
+	snapshot_t *snapshot;
+	/** Set when the categories were restored from the snapshot. */
+	int resumed;
+
+	/** Time when gui_alloc() was called. */
+	struct timeval starttime;
+	/** Set when the first frame waiting for user input was shown. */
+	int interactive;
+
+	/** Benchmark script, NULL for normal operation. */
+	bench_t *bench;
+
+	/** Show performance counters on screen. */
+	int hud;
+	/** Output for performance counters, NULL if disabled. */
+	metrics_t *metrics;
+	/** Counters of the last interval, shown on screen. */
+	metrics_sample_t sample;
+	/** Counters of the running interval. */
+	metrics_sample_t next;
+	/** Sum of frame work times in the running interval. */
+	Uint32 framesum;
+	/** Sum of paint times in the running interval. */
+	Uint32 paintsum;
+	/** Time used by the last gui_paint(). */
+	Uint32 painttime;
+	/** Time when the running interval started. */
+	Uint32 sampletime;
+	/** Text cache hits at the start of the interval. */
+	unsigned int texthits;
+	/** Text cache misses at the start of the interval. */
+	unsigned int textmisses;
 };
 
 /**
@@ -442,7 +675,7 @@ static char *buf_printf(char *buffer, const char *format, ...)
 	return buffer;
 }
 
-/** Load YouTube logo. */
+/** Load a picture, e.g. the YouTube logo. */
 static SDL_Surface *gui_get_image(gui_t *gui, const char *file)
 {
 	int ret;
@@ -453,6 +686,12 @@ static SDL_Surface *gui_get_image(gui_t *gui, const char *file)
 		return NULL;
 	}
 
+	/* Converted at build time, no decoding needed. */
+	rv = pictures_get(file);
+	if (rv != NULL) {
+		return rv;
+	}
+
 	ret = asprintf(&filename, "%s/%s", gui->sharedir, file);
 	if (ret == -1) {
 		return NULL;
@@ -469,51 +708,70 @@ static SDL_Surface *gui_get_image(gui_t *gui, const char *file)
 	return rv;
 }
 
-static void add_cached_title(gui_t *gui, SDL_Surface *sText, const char *title)
+/** Compute the positions depending on the screen mode. */
+static void gui_layout_update(gui_t *gui)
 {
-	int i;
-	int min;
-	int idx = 0;
-
-	min = 100000;
-	for (i = 0; i < TITLE_CACHE_ENTRIES; i++) {
-		gui->title_cache_table[i].count--;
-		if (gui->title_cache_table[i].count < min) {
-			min = gui->title_cache_table[i].count;
-			idx = i;
-		}
-	}
-	if (gui->title_cache_table[idx].sText != NULL) {
-		SDL_FreeSurface(gui->title_cache_table[idx].sText);
-	}
-	gui->title_cache_table[idx].sText = sText;
-	gui->title_cache_table[idx].count = 1000;
-	gui->title_cache_table[idx].title = title;
+	gui_layout_t *layout = &gui->layout;
+
+	memset(layout, 0, sizeof(*layout));
+	layout->w = gui->screen->w;
+	layout->h = gui->screen->h;
+	layout->logox0 = gui->logorect.x - gui->mindistance;
+	layout->logoy0 = gui->logorect.y - gui->mindistance;
+	layout->logox1 = gui->logorect.x + gui->logo->w + gui->mindistance;
+	layout->logoy1 = gui->logorect.y + gui->logo->h + gui->mindistance;
+	layout->contentbottom = gui->description_pos - gui->mindistance;
 }
 
-static void cache_title_free(gui_t *gui)
+/**
+ * Compute the positions of the button descriptions. Descriptions which
+ * would cover the logo continue in the next line.
+ */
+static void gui_layout_legend(gui_t *gui, SDL_Surface **pic, SDL_Surface **text)
 {
+	gui_layout_t *layout = &gui->layout;
+	int x;
+	int y;
 	int i;
 
-	for (i = 0; i < TITLE_CACHE_ENTRIES; i++) {
-		if (gui->title_cache_table[i].sText != NULL) {
-			SDL_FreeSurface(gui->title_cache_table[i].sText);
-			gui->title_cache_table[i].sText = NULL;
-			gui->title_cache_table[i].title = NULL;
-			gui->title_cache_table[i].count = 0;
+	x = gui->mindistance;
+	y = gui->description_pos;
+	for (i = 0; i < LEGEND_BUTTONS; i++) {
+		layout->legendtext[i] = text[i];
+		if ((pic[i] == NULL) || (text[i] == NULL)) {
+			continue;
+		}
+		if (layout->logoy1 > y) {
+			if (layout->logox0 < (x + pic[i]->w + 10 + text[i]->w)) {
+				y += text[i]->h + 10;
+				x = gui->mindistance;
+			}
 		}
+		layout->legendpic[i].x = x;
+		layout->legendpic[i].y = y + (text[i]->h - pic[i]->h) / 2;
+		x += pic[i]->w + 10;
+		layout->legendpos[i].x = x;
+		layout->legendpos[i].y = y;
+		x += text[i]->w + gui->mindistance;
 	}
+	layout->legendvalid = 1;
 }
 
 static gui_cat_t *gui_cat_alloc(gui_t *gui, gui_cat_t **listhead, gui_cat_t *where)
 {
+	arena_t *arena;
 	gui_cat_t *rv;
 
-	rv = malloc(sizeof(*rv));
+	arena = arena_alloc(CAT_ARENA_SIZE);
+	if (arena == NULL) {
+		return NULL;
+	}
+	rv = arena_malloc(arena, sizeof(*rv));
 	if (rv == NULL) {
+		arena_free(arena);
 		return NULL;
 	}
-	memset(rv, 0, sizeof(*rv));
+	rv->arena = arena;
 	rv->scrolldir = 1;
 
 	if (listhead == &gui->categories) {
@@ -551,18 +809,50 @@ static gui_cat_t *gui_cat_alloc(gui_t *gui, gui_cat_t **listhead, gui_cat_t *whe
 	return rv;
 }
 
-static gui_elem_t *gui_elem_alloc(gui_t *gui, gui_cat_t *cat, gui_elem_t *where, const char *url)
+/** Allocate the memory for the videos of a page. */
+static gui_page_t *gui_page_alloc(void)
+{
+	arena_t *arena;
+	gui_page_t *page;
+
+	arena = arena_alloc(PAGE_ARENA_SIZE);
+	if (arena == NULL) {
+		return NULL;
+	}
+	page = arena_malloc(arena, sizeof(*page));
+	if (page == NULL) {
+		arena_free(arena);
+		return NULL;
+	}
+	page->arena = arena;
+	return page;
+}
+
+/** Free the page when none of its videos is in a list, e.g. after an empty response. */
+static void gui_page_release(gui_page_t *page)
+{
+	if ((page != NULL) && (page->count <= 0)) {
+		/* The nodes and strings of all videos of the page at once. */
+		arena_free(page->arena);
+	}
+}
+
+static gui_elem_t *gui_elem_alloc(gui_t *gui, gui_cat_t *cat, gui_page_t *page, gui_elem_t *where, const char *url)
 {
 	gui_elem_t *rv;
 
 	(void) gui;
 
-	rv = malloc(sizeof(*rv));
+	if (page == NULL) {
+		return NULL;
+	}
+	rv = arena_malloc(page->arena, sizeof(*rv));
 	if (rv == NULL) {
 		return NULL;
 	}
-	memset(rv, 0, sizeof(*rv));
-	rv->url = jt_strdup(url);
+	rv->page = page;
+	page->count++;
+	rv->url = arena_strdup(page->arena, url);
 
 	if (cat->current == NULL) {
 		cat->current = rv;
@@ -590,9 +880,15 @@ static gui_elem_t *gui_elem_alloc(gui_t *gui, gui_cat_t *cat, gui_elem_t *where,
 	return rv;
 }
 
+/**
+ * Remove video from the list of the category. Its node and strings are part
+ * of the page, which is freed with the last video of the page.
+ */
 static void gui_elem_free(gui_elem_t *elem)
 {
 	if (elem != NULL) {
+		gui_page_t *page;
+
 		/* Remove from list. */
 		if (elem->next != NULL) {
 			elem->next->prev = elem->prev;
@@ -610,36 +906,10 @@ static void gui_elem_free(gui_elem_t *elem)
 			SDL_FreeSurface(elem->imagemedium);
 			elem->imagemedium = NULL;
 		}
-		if (elem->url != NULL) {
-			free(elem->url);
-			elem->url = NULL;
-		}
-		if (elem->urlmedium != NULL) {
-			free(elem->urlmedium);
-			elem->urlmedium = NULL;
-		}
-		if (elem->videoid != NULL) {
-			free(elem->videoid);
-			elem->videoid = NULL;
-		}
-		if (elem->title != NULL) {
-			free(elem->title);
-			elem->title = NULL;
-		}
-		if (elem->nextPageToken != NULL) {
-			free(elem->nextPageToken);
-			elem->nextPageToken = NULL;
-		}
-		if (elem->prevPageToken != NULL) {
-			free(elem->prevPageToken);
-			elem->prevPageToken = NULL;
-		}
-		if (elem->channelid != NULL) {
-			free(elem->channelid);
-			elem->channelid = NULL;
-		}
-		free(elem);
+		page = elem->page;
 		elem = NULL;
+		page->count--;
+		gui_page_release(page);
 	}
 }
 
@@ -695,57 +965,18 @@ static void gui_cat_free(gui_t *gui, gui_cat_t *cat)
 				/* This is the last one, there is no next. */
 				next = NULL;
 			}
+			/* Frees the thumbnails, each page with its last video. */
 			gui_elem_free(elem);
 			elem = NULL;
 			elem = next;
 		}
 
-		if (cat->channelid != NULL) {
-			free(cat->channelid);
-			cat->channelid = NULL;
-		}
-		if (cat->playlistid != NULL) {
-			free(cat->playlistid);
-			cat->playlistid = NULL;
-		}
-		if (cat->searchterm != NULL) {
-			free(cat->searchterm);
-			cat->searchterm = NULL;
-		}
-		if (cat->title != NULL) {
-			free(cat->title);
-			cat->title = NULL;
-		}
-		if (cat->channelNextPageToken != NULL) {
-			free(cat->channelNextPageToken);
-			cat->channelNextPageToken = NULL;
-		}
-		if (cat->channelPrevPageToken != NULL) {
-			free(cat->channelPrevPageToken);
-			cat->channelPrevPageToken = NULL;
-		}
-		if (cat->favoritesNextPageToken != NULL) {
-			free(cat->favoritesNextPageToken);
-			cat->favoritesNextPageToken = NULL;
-		}
-		if (cat->favoritesPrevPageToken != NULL) {
-			free(cat->favoritesPrevPageToken);
-			cat->favoritesPrevPageToken = NULL;
-		}
-		if (cat->subscriptionNextPageToken != NULL) {
-			free(cat->subscriptionNextPageToken);
-			cat->subscriptionNextPageToken = NULL;
-		}
-		if (cat->subscriptionPrevPageToken != NULL) {
-			free(cat->subscriptionPrevPageToken);
-			cat->subscriptionPrevPageToken = NULL;
-		}
-
 		/* not allocated */
 		cat->videopagetoken = NULL;
 		cat->vidnr = 0;
 
-		free(cat);
+		/* The category and its strings are part of the arena. */
+		arena_free(cat->arena);
 		cat = NULL;
 	}
 }
@@ -861,14 +1092,9 @@ static void gui_menu_entry_free(gui_t *gui, gui_menu_entry_t *entry)
 		if ((entry->state == GUI_STATE_LOAD_ACCESS_TOKEN) || (entry->state == GUI_STATE_NEW_ACCESS_TOKEN)) {
 			gui->account_allocated[entry->tokennr] = 0;
 		}
-		if (entry->playlistid != NULL) {
-			free(entry->playlistid);
-			entry->playlistid = NULL;
-		}
-		if (entry->channelid != NULL) {
-			free(entry->channelid);
-			entry->channelid = NULL;
-		}
+		/* Interned. */
+		entry->playlistid = NULL;
+		entry->channelid = NULL;
 		if (entry->searchterm != NULL) {
 			free(entry->searchterm);
 			entry->searchterm = NULL;
@@ -898,55 +1124,58 @@ static void save_file(const char *filename, const void *mem, size_t size)
 }
 
 
+/**
+ * Load a whole file with one read and terminate it with 0.
+ *
+ * @returns Content, NULL when out of memory or (void *) -1 when the file
+ *          can't be read.
+ */
 static void *load_file(const char *filename)
 {
 	FILE *fin;
-	int pos = 0;
-	void *mem = NULL;
-	int eof = 0;
+	struct stat st;
+	char *mem;
 
 	LOG("%s() file %s\n", __FUNCTION__, filename);
 
 	fin = fopen(filename, "rb");
-	if (fin != NULL) {
-		int rv;
-
-		mem = malloc(CHUNK_SIZE);
-		if (mem == NULL) {
-			fclose(fin);
-			fin = NULL;
-			return NULL;
-		}
-		memset(mem, 0, CHUNK_SIZE);
-		do {
-			rv = fread(mem + pos, 1, CHUNK_SIZE - 1, fin);
-			if (rv < 0) {
-				LOG_ERROR("Failed to read file: %s\n", strerror(errno));
-				free(mem);
-				mem = NULL;
-				return (void *) -1;
-			} else {
-				eof = feof(fin);
-				pos += rv;
-				if (!eof) {
-					mem = realloc(mem, pos + CHUNK_SIZE);
-					if (mem == NULL) {
-						LOG_ERROR("out of memory\n");
-						break;
-					}
-					memset(mem + pos, 0, CHUNK_SIZE);
-				}
-			}
-		} while (!eof);
+	if (fin == NULL) {
+		return (void *) -1;
+	}
+	if (fstat(fileno(fin), &st) != 0) {
+		LOG_ERROR("Failed to read file: %s\n", strerror(errno));
+		fclose(fin);
+		fin = NULL;
+		return (void *) -1;
+	}
+	mem = malloc(st.st_size + 1);
+	if (mem == NULL) {
+		LOG_ERROR("out of memory\n");
+		fclose(fin);
+		fin = NULL;
+		return NULL;
+	}
+	if ((st.st_size > 0) && (fread(mem, st.st_size, 1, fin) != 1)) {
+		LOG_ERROR("Failed to read file: %s\n", strerror(errno));
+		free(mem);
+		mem = NULL;
 		fclose(fin);
 		fin = NULL;
-
-		return mem;
-	} else {
 		return (void *) -1;
 	}
+	mem[st.st_size] = 0;
+	fclose(fin);
+	fin = NULL;
+
+	return mem;
 }
 
+/**
+ * Check whether an account exists. Only the existence of the token file is
+ * checked, the credentials are loaded when the account is selected.
+ *
+ * @returns Title of the account or NULL if it doesn't exist.
+ */
 static char *check_token(int nr)
 {
 	const char *home;
@@ -955,6 +1184,7 @@ static char *check_token(int nr)
 	void *mem;
 	char *accountname = NULL;
 	char *titlefile = NULL;
+	struct stat st;
 
 	home = getenv("HOME");
 	if (home == NULL) {
@@ -968,20 +1198,14 @@ static char *check_token(int nr)
 		return NULL;
 	}
 
-	mem = load_file(tokenfile);
+	ret = stat(tokenfile, &st);
 
 	free(tokenfile);
 	tokenfile = NULL;
 
-	if (mem == NULL) {
-		/* Out of memory */
-		return strdup("Account");
-	}
-	if (mem == ((void *) -1)) {
+	if (ret != 0) {
 		return NULL;
 	}
-	free(mem);
-	mem = NULL;
 
 	ret = asprintf(&titlefile, "%s/%s%03d.txt", home, TITLE_FILE, nr);
 	if (ret == -1) {
@@ -1068,8 +1292,8 @@ static void load_menu_state(gui_t *gui)
 				int addit = 0;
 				int tokennr;
 				char *title = NULL;
-				char *playllistid = NULL;
-				char *channelid = NULL;
+				const char *playllistid = NULL;
+				const char *channelid = NULL;
 				char *searchterm = NULL;
 
 				if (menuver >= 1) {
@@ -1189,7 +1413,7 @@ static void load_menu_state(gui_t *gui)
 							error = 1;
 							break;
 						}
-						playllistid = strdup(buffer);
+						playllistid = intern_get(gui->ids, buffer);
 						LOG("playllistid %s\n", buffer);
 
 						if (fgets(buffer, BUFFER_SIZE, fin) == NULL) {
@@ -1203,7 +1427,7 @@ static void load_menu_state(gui_t *gui)
 							error = 1;
 							break;
 						}
-						channelid = strdup(buffer);
+						channelid = intern_get(gui->ids, buffer);
 						LOG("channelid %s\n", buffer);
 
 						addit = 1;
@@ -1228,14 +1452,6 @@ static void load_menu_state(gui_t *gui)
 					channelid = NULL;
 					entry->searchterm = searchterm;
 				} else {
-					if (playllistid != NULL) {
-						free(playllistid);
-						playllistid = NULL;
-					}
-					if (channelid != NULL) {
-						free(channelid);
-						channelid = NULL;
-					}
 					if (searchterm != NULL) {
 						free(searchterm);
 						searchterm = NULL;
@@ -1256,9 +1472,21 @@ static void load_menu_state(gui_t *gui)
 	}
 }
 
+/**
+ * Called while thumbnails are loaded. User input drops the queued
+ * thumbnails which are not visible, the events stay in the queue.
+ */
+static int gui_transfer_preempt(void *ctx)
+{
+	SDL_Event event;
+
+	(void) ctx;
+	SDL_PumpEvents();
+	return SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, INPUT_EVENT_MASK) > 0;
+}
 
 /** Initialize graphic. */
-gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
+gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm, int resident)
 {
 	gui_t *gui;
 	const SDL_VideoInfo *info;
@@ -1268,6 +1496,7 @@ gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
 	char *filename = NULL;
 	int ret;
 	gui_menu_entry_t *entry;
+	SDL_Color white = {255, 255, 255, 0};
 
 	flags = 0;
 	if (fullscreen) {
@@ -1280,10 +1509,23 @@ gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
 		return NULL;
 	}
 	memset(gui, 0 , sizeof(*gui));
+	gettimeofday(&gui->starttime, NULL);
 	gui->mindistance = 34;
+	gui->navdir = 1;
 	gui->sharedir = sharedir;
+	gui->resident = resident;
+
+	/* Connect to the servers while fonts and pictures are loaded. */
+	gui->transfer = transfer_alloc();
+	if (gui->transfer == NULL) {
+		LOG_ERROR("Out of memory\n");
+		gui_free(gui);
+		return NULL;
+	}
+	transfer_set_preempt(gui->transfer, gui_transfer_preempt, gui);
+	transfer_warmup(gui->transfer, warmup_urls, sizeof(warmup_urls) / sizeof(warmup_urls[0]));
 
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0) {
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_TIMER) < 0) {
 		LOG_ERROR("Couldn't initialize SDL: %s\n", SDL_GetError());
 		return NULL;
 	}
@@ -1292,6 +1534,20 @@ gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
 
 	TTF_Init();
 
+	gui->textcache = textcache_alloc(TEXT_CACHE_SIZE);
+	if (gui->textcache == NULL) {
+		LOG_ERROR("Out of memory.\n");
+		gui_free(gui);
+		return NULL;
+	}
+
+	gui->ids = intern_alloc();
+	if (gui->ids == NULL) {
+		LOG_ERROR("Out of memory.\n");
+		gui_free(gui);
+		return NULL;
+	}
+
 	gui->logo = gui_get_image(gui, "yt_powered.jpg");
 	if (gui->logo == NULL) {
 		LOG_ERROR("Failed to load youtube logo.\n");
@@ -1339,6 +1595,7 @@ gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
 		gui_free(gui);
 		return NULL;
 	}
+	transfer_poll(gui->transfer);
 
 	info = SDL_GetVideoInfo();
 	if (info != NULL)
@@ -1353,11 +1610,35 @@ gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
 		return NULL;
 	}
 	gui->fullscreenmode = 1;
+	gui->videoflags = SDL_SWSURFACE | SDL_ANYFORMAT | flags;
+
+	gui->fontatlas = glyphatlas_alloc(gui->font, white, gui->screen);
+	gui->smallatlas = glyphatlas_alloc(gui->smallfont, white, gui->screen);
+	if ((gui->fontatlas == NULL) || (gui->smallatlas == NULL)) {
+		LOG_ERROR("Out of memory\n");
+		gui_free(gui);
+		return NULL;
+	}
 
 	gui->logorect.x = gui->screen->w - gui->logo->w - gui->mindistance;
 	gui->logorect.y = gui->screen->h - gui->logo->h - gui->mindistance;
 	/* Put description of buttons to the same y position as the logo. */
 	gui->description_pos = gui->logorect.y;
+	gui_layout_update(gui);
+
+	/* Thumbnails are decoded and trimmed to the size the layout can show. */
+	gui->smallsize.w = gui->screen->w / 5;
+	gui->smallsize.h = gui->screen->h / 5;
+	/* The selected video is shown in 16:9 like the video itself, so that the
+	 * medium thumbnail (320x180 at 640x480) is not cut. It starts in the
+	 * first row and must end above the button descriptions.
+	 */
+	gui->mediumsize.w = gui->screen->w / 2;
+	gui->mediumsize.h = gui->mediumsize.w * 9 / 16;
+	if (gui->mediumsize.h > (gui->layout.contentbottom - THUMB_Y)) {
+		gui->mediumsize.h = gui->layout.contentbottom - THUMB_Y;
+		gui->mediumsize.w = gui->mediumsize.h * 16 / 9;
+	}
 
 	if (gui->screen->w > 800) {
 		gui->cross = gui_get_image(gui, "cross.jpg");
@@ -1376,9 +1657,10 @@ gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm)
 
 	atexit(SDL_Quit);
 	atexit(TTF_Quit);
+	transfer_poll(gui->transfer);
 
-	gui->transfer = transfer_alloc();
-	if (gui->transfer == NULL) {
+	gui->quality = quality_alloc(THUMB_MEMORY_BUDGET);
+	if (gui->quality == NULL) {
 		LOG_ERROR("Out of memory\n");
 		gui_free(gui);
 		return NULL;
@@ -1579,6 +1861,30 @@ static void delete_token(int nr)
 	titlefile = NULL;
 }
 
+/** Free the list of all subscriptions. */
+static void gui_free_subscription_index(gui_t *gui)
+{
+	int i;
+
+	if (gui->subs == NULL) {
+		return;
+	}
+	for (i = 0; i < gui->subcount; i++) {
+		gui_sub_t *sub = &gui->subs[i];
+
+		if (sub->title != NULL) {
+			free(sub->title);
+			sub->title = NULL;
+		}
+		/* Interned. */
+		sub->channelid = NULL;
+		sub->playlistid = NULL;
+	}
+	free(gui->subs);
+	gui->subs = NULL;
+	gui->subcount = 0;
+}
+
 void gui_free_categories(gui_t *gui)
 {
 	if (gui != NULL) {
@@ -1629,7 +1935,138 @@ void gui_free_categories(gui_t *gui)
 			cat = NULL;
 			cat = next;
 		}
+
+		gui_free_subscription_index(gui);
+	}
+}
+
+/**
+ * Replace the table of interned IDs when it holds more than MAX_INTERNED_IDS.
+ * Must be called after gui_free_categories(), the menu entries and the IDs
+ * in ids are the only references left and are moved to the new table.
+ */
+static void gui_renew_ids(gui_t *gui, const char **ids[], int count)
+{
+	intern_t *renewed;
+	gui_menu_entry_t *entry;
+	unsigned int used;
+	size_t size;
+	int pass;
+	int i;
+
+	intern_get_stats(gui->ids, &used, &size);
+	if (used <= MAX_INTERNED_IDS) {
+		return;
+	}
+	renewed = intern_alloc();
+	if (renewed == NULL) {
+		return;
+	}
+	/* The first pass copies the IDs, the second one only looks them up and
+	 * can't fail. The old table is kept when out of memory.
+	 */
+	for (pass = 0; pass < 2; pass++) {
+		entry = gui->mainmenu;
+		while (entry != NULL) {
+			if (((entry->playlistid != NULL) && (intern_get(renewed, entry->playlistid) == NULL))
+				|| ((entry->channelid != NULL) && (intern_get(renewed, entry->channelid) == NULL))) {
+				intern_free(renewed);
+				return;
+			}
+			if (pass > 0) {
+				entry->playlistid = intern_get(renewed, entry->playlistid);
+				entry->channelid = intern_get(renewed, entry->channelid);
+			}
+			entry = entry->next;
+			if (entry == gui->mainmenu) {
+				break;
+			}
+		}
+		for (i = 0; i < count; i++) {
+			if ((*ids[i] != NULL) && (intern_get(renewed, *ids[i]) == NULL)) {
+				intern_free(renewed);
+				return;
+			}
+			if (pass > 0) {
+				*ids[i] = intern_get(renewed, *ids[i]);
+			}
+		}
 	}
+	LOG("Dropped %u interned IDs with %zu bytes.\n", used, size);
+	intern_free(gui->ids);
+	gui->ids = renewed;
+}
+
+/** Free the YouTube access handle and keep its transfer statistics. */
+static void gui_free_token(gui_t *gui)
+{
+	if (gui->at != NULL) {
+		unsigned long requests = 0;
+		unsigned long long bytes = 0;
+
+		jt_get_transfer_stats(gui->at, &requests, &bytes);
+		gui->jtrequests += requests;
+		gui->jtbytes += bytes;
+		jt_free(gui->at);
+		gui->at = NULL;
+	}
+}
+
+void gui_get_transfer_stats(gui_t *gui, unsigned long *requests, unsigned long long *bytes)
+{
+	unsigned long r = 0;
+	unsigned long long b = 0;
+
+	transfer_get_stats(&r, &b);
+	*requests = gui->jtrequests + r;
+	*bytes = gui->jtbytes + b;
+	if (gui->at != NULL) {
+		jt_get_transfer_stats(gui->at, &r, &b);
+		*requests += r;
+		*bytes += b;
+	}
+}
+
+int gui_get_button(const char *name)
+{
+	static const struct {
+		const char *name;
+		int key;
+	} buttons[] = {
+		{ "up", SDLK_UP },
+		{ "down", SDLK_DOWN },
+		{ "left", SDLK_LEFT },
+		{ "right", SDLK_RIGHT },
+		{ "cross", BTN_CROSS },
+		{ "circle", BTN_CIRCLE },
+		{ "triangle", BTN_TRIANGLE },
+		{ "square", BTN_SQUARE },
+		{ "start", BTN_START },
+		{ "select", BTN_SELECT },
+		{ "l1", BTN_L1 },
+		{ "r1", BTN_R1 },
+		{ "l2", BTN_L2 },
+		{ "r2", BTN_R2 },
+	};
+	unsigned int i;
+
+	for (i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+		if (strcmp(buttons[i].name, name) == 0) {
+			return buttons[i].key;
+		}
+	}
+	return -1;
+}
+
+void gui_set_bench(gui_t *gui, bench_t *bench)
+{
+	gui->bench = bench;
+}
+
+void gui_set_metrics(gui_t *gui, int hud, metrics_t *metrics)
+{
+	gui->hud = hud;
+	gui->metrics = metrics;
 }
 
 /** Clean up of graphic libraries. */
@@ -1641,6 +2078,12 @@ void gui_free(gui_t *gui)
 
 		gui_free_categories(gui);
 
+		/* Thumbnails using the mapping are freed now. */
+		if (gui->snapshot != NULL) {
+			snapshot_close(gui->snapshot);
+			gui->snapshot = NULL;
+		}
+
 		menu = gui->mainmenu;
 		gui->mainmenu = NULL;
 		gui->selectedmenu = NULL;
@@ -1664,14 +2107,27 @@ void gui_free(gui_t *gui)
 			free(gui->statusmsg);
 			gui->statusmsg = NULL;
 		}
-		if (gui->at != NULL) {
-			jt_free(gui->at);
-			gui->at =  NULL;
-		}
+		gui_free_token(gui);
 		if (gui->transfer != NULL) {
 			transfer_free(gui->transfer);
 			gui->transfer = NULL;
 		}
+		if (gui->quality != NULL) {
+			quality_free(gui->quality);
+			gui->quality = NULL;
+		}
+		if (gui->textcache != NULL) {
+			textcache_free(gui->textcache);
+			gui->textcache = NULL;
+		}
+		if (gui->smallatlas != NULL) {
+			glyphatlas_free(gui->smallatlas);
+			gui->smallatlas = NULL;
+		}
+		if (gui->fontatlas != NULL) {
+			glyphatlas_free(gui->fontatlas);
+			gui->fontatlas = NULL;
+		}
 		gui->descfont = NULL;
 		if (gui->smallfont != NULL) {
 			TTF_CloseFont(gui->smallfont);
@@ -1705,28 +2161,32 @@ void gui_free(gui_t *gui)
 			SDL_FreeSurface(gui->screen);
 			gui->screen = NULL;
 		}
-		if (gui->cross_text != NULL) {
-			SDL_FreeSurface(gui->cross_text);
-			gui->cross_text = NULL;
-		}
-		if (gui->circle_text != NULL) {
-			SDL_FreeSurface(gui->circle_text);
-			gui->circle_text = NULL;
-		}
-		if (gui->square_text != NULL) {
-			SDL_FreeSurface(gui->square_text);
-			gui->square_text = NULL;
-		}
-		if (gui->triangle_text != NULL) {
-			SDL_FreeSurface(gui->triangle_text);
-			gui->triangle_text = NULL;
+		gui->cross_text = NULL;
+		gui->circle_text = NULL;
+		gui->square_text = NULL;
+		gui->triangle_text = NULL;
+		while (gui->legendcount > 0) {
+			gui->legendcount--;
+			if (gui->legends[gui->legendcount].image != NULL) {
+				SDL_FreeSurface(gui->legends[gui->legendcount].image);
+				gui->legends[gui->legendcount].image = NULL;
+			}
 		}
 		if (gui->screen != NULL) {
 			SDL_FreeSurface(gui->screen);
 			gui->screen = NULL;
 		}
 
-		cache_title_free(gui);
+		/* Categories and menu entries are freed, nothing refers to the IDs. */
+		if (gui->ids != NULL) {
+			unsigned int count;
+			size_t size;
+
+			intern_get_stats(gui->ids, &count, &size);
+			LOG("Interned %u IDs and page tokens with %zu bytes.\n", count, size);
+			intern_free(gui->ids);
+			gui->ids = NULL;
+		}
 
 		TTF_Quit();
 		SDL_VideoQuit();
@@ -1736,39 +2196,21 @@ void gui_free(gui_t *gui)
 	}
 }
 
-static SDL_Surface *gui_load_image(transfer_t *transfer, const char *url)
-{
-	SDL_Surface *image = NULL;
-	void *mem = NULL;
-	int size;
-
-	if (url == NULL) {
-		return NULL;
-	}
-
-	size = transfer_binary(transfer, url, &mem);
-	if ((size > 0) && (mem != NULL)) {
-		SDL_RWops *rw = SDL_RWFromMem(mem, size);
-		image = IMG_Load_RW(rw, 1);
-		rw = NULL;
-		free(mem);
-		mem = NULL;
-	}
-	return image;
-}
-
 /**
- * Print text to an SDL surface.
+ * Print text to an SDL surface. The image is taken from the text cache when
+ * the same text was already printed with the same font.
  *
  * @param image This object is freed.
  * @param format printf-like format string.
  *
- * @returns SDL surface which should replace the image.
+ * @returns SDL surface which should replace the image. Needs to be freed with
+ *          SDL_FreeSurface().
  */
-static SDL_Surface *gui_printf(TTF_Font *font, SDL_Surface *image, const char *format, ...)
+static SDL_Surface *gui_printf(gui_t *gui, TTF_Font *font, SDL_Surface *image, const char *format, ...)
 {
 	va_list ap;
 	SDL_Color clrFg = {255, 255, 255, 0}; /* White */
+	char buffer[256];
 	char *text = NULL;
 	int ret;
 	SDL_Surface *rv;
@@ -1778,39 +2220,315 @@ static SDL_Surface *gui_printf(TTF_Font *font, SDL_Surface *image, const char *f
 		image = NULL;
 	}
 
+	/* Use buffer on stack, so that nothing is allocated on a cache hit. */
 	va_start(ap, format);
-	ret = vasprintf(&text, format, ap);
+	ret = vsnprintf(buffer, sizeof(buffer), format, ap);
 	va_end(ap);
-	if (ret == -1) {
-		text = NULL;
+	if (ret < 0) {
 		return NULL;
 	}
+	if (ret >= (int) sizeof(buffer)) {
+		va_start(ap, format);
+		ret = vasprintf(&text, format, ap);
+		va_end(ap);
+		if (ret == -1) {
+			text = NULL;
+			return NULL;
+		}
+	}
 
-	rv = TTF_RenderUTF8_Solid(font, text, clrFg);
+	rv = textcache_get(gui->textcache, font, clrFg, (text != NULL) ? text : buffer);
 
-	free(text);
-	text = NULL;
+	if (text != NULL) {
+		free(text);
+		text = NULL;
+	}
 
 	return rv;
 }
 
-static SDL_Surface *cached_title(gui_t *gui, const char *title)
+/**
+ * Get the rendered description of a button. Each description is rendered
+ * only once, so switching between the modes doesn't render text.
+ *
+ * @param text String constant.
+ *
+ * @returns Surface owned by the legend cache or NULL.
+ */
+static SDL_Surface *gui_legend(gui_t *gui, const char *text)
 {
-	int i;
+	gui_legend_t *legend;
+	unsigned int i;
 
-	for (i = 0; i < TITLE_CACHE_ENTRIES; i++) {
-		if (gui->title_cache_table[i].title == title) {
-			gui->title_cache_table[i].count++;
-			return gui->title_cache_table[i].sText;
+	for (i = 0; i < gui->legendcount; i++) {
+		if (strcmp(gui->legends[i].text, text) == 0) {
+			return gui->legends[i].image;
 		}
 	}
-	//printf("Cache miss for: %s\n", title);
-	return NULL;
-}
+	if (gui->legendcount >= MAX_LEGENDS) {
+		LOG_ERROR("Too many button descriptions, increase MAX_LEGENDS.\n");
+		return NULL;
+	}
+	legend = &gui->legends[gui->legendcount];
+	legend->text = text;
+	legend->image = gui_printf(gui, gui->descfont, NULL, "%s", text);
+	gui->legendcount++;
+	return legend->image;
+}
+
+/** Thumbnail requested in a batch. */
+typedef struct {
+	gui_elem_t *elem;
+	/** Set for the medium size thumbnail. */
+	int medium;
+	/** Maximum size shown on screen. */
+	const SDL_Rect *maxsize;
+	/** Decoder running while the thumbnail is received. */
+	thumbnail_stream_t *stream;
+	/** Set when a loaded thumbnail is replaced by a larger size. */
+	int upgrade;
+	/** Size of the loaded thumbnail, restored when the request is preempted. */
+	enum quality_size oldsize;
+	/** Set when the transfer finished. */
+	int finished;
+	/** Bytes received. */
+	size_t size;
+} gui_thumb_req_t;
+
+/** Get the URL of a thumbnail size, or of the next smaller size if it is missing. */
+static const char *gui_elem_thumb_url(gui_elem_t *elem, enum quality_size size)
+{
+	if ((size >= QUALITY_HIGH) && (elem->urlhigh != NULL)) {
+		return elem->urlhigh;
+	}
+	if ((size >= QUALITY_MEDIUM) && (elem->urlmedium != NULL)) {
+		return elem->urlmedium;
+	}
+	return elem->url;
+}
+
+/**
+ * Check whether a thumbnail of a video needs to be loaded.
+ *
+ * @param medium Check imagemedium instead of image.
+ * @param size Wanted thumbnail size.
+ *
+ * @returns 0 if not needed, 1 if missing, 2 if a larger size should replace it.
+ */
+static int gui_elem_thumb_needed(gui_elem_t *elem, int medium, enum quality_size size)
+{
+	int loaded = medium ? elem->loadedmedium : elem->loaded;
+	enum quality_size last = medium ? elem->sizemedium : elem->sizesmall;
+
+	if ((medium ? elem->urlmedium : elem->url) == NULL) {
+		return 0;
+	}
+	if (loaded < IMG_LOAD_RETRY) {
+		return 1;
+	}
+	/* A failed upgrade is not retried, the loaded thumbnail is still shown. */
+	if ((loaded == IMG_LOADED) && (last < size)) {
+		return 2;
+	}
+	return 0;
+}
+
+/** Replace the small or medium thumbnail of a video. */
+static void gui_thumb_set(gui_thumb_req_t *thumb, SDL_Surface *image)
+{
+	gui_elem_t *elem = thumb->elem;
+
+	if (thumb->medium) {
+		if (elem->imagemedium != NULL) {
+			SDL_FreeSurface(elem->imagemedium);
+			elem->imagemedium = NULL;
+		}
+		elem->imagemedium = image;
+	} else {
+		if (elem->image != NULL) {
+			SDL_FreeSurface(elem->image);
+			elem->image = NULL;
+		}
+		elem->image = image;
+	}
+}
+
+/** Decode the part of a thumbnail which is already received. */
+static void gui_thumb_data(void *ctx, const void *mem, size_t size)
+{
+	gui_thumb_req_t *thumb = ctx;
+
+	if (thumb->stream == NULL) {
+		return;
+	}
+	thumb->size = size;
+	JT_TRACE_BEGIN("thumbnail", "decode", NULL);
+	thumbnail_stream_feed(thumb->stream, mem, size, 0);
+	JT_TRACE_END("thumbnail", "decode");
+}
+
+/** Finish decoding a thumbnail loaded by gui_load_row(). */
+static void gui_thumb_done(void *ctx, const void *mem, size_t size)
+{
+	gui_thumb_req_t *thumb = ctx;
+	gui_elem_t *elem = thumb->elem;
+	SDL_Surface *image = NULL;
+
+	thumb->finished = 1;
+	if (mem != NULL) {
+		thumb->size = size;
+		JT_TRACE_BEGIN("thumbnail", "decode", NULL);
+		if (thumb->stream != NULL) {
+			if (thumbnail_stream_feed(thumb->stream, mem, size, 1) == 0) {
+				image = thumbnail_stream_get_image(thumb->stream);
+			}
+		}
+		if (image == NULL) {
+			/* No JPEG or decoding failed. */
+			image = thumbnail_decode(mem, size, thumb->maxsize->w, thumb->maxsize->h);
+		}
+		JT_TRACE_END("thumbnail", "decode");
+	}
+	if (thumb->stream != NULL) {
+		thumbnail_stream_free(thumb->stream);
+		thumb->stream = NULL;
+	}
+	if (image == NULL) {
+		return;
+	}
+	if (thumb->medium) {
+		elem->loadedmedium = IMG_LOADED;
+	} else {
+		elem->loaded = IMG_LOADED;
+	}
+	gui_thumb_set(thumb, image);
+}
+
+/**
+ * Select the thumbnail sizes for the row and the selected video.
+ *
+ * @param selected Set when the medium size slot of the selected video is shown.
+ */
+static void gui_thumb_sizes(gui_t *gui, int selected, enum quality_size *rowsize, enum quality_size *selsize)
+{
+	*rowsize = quality_select(gui->quality, gui->smallsize.w, gui->smallsize.h, MAX_VIDS, THUMB_ROW_TIME);
+	*selsize = QUALITY_DEFAULT;
+	if (selected) {
+		*selsize = quality_select(gui->quality, gui->mediumsize.w, gui->mediumsize.h, 1, THUMB_SELECTED_TIME);
+	}
+}
+
+/**
+ * Load the missing thumbnails of the videos shown in the row of a category.
+ * All thumbnails are fetched concurrently, so a row needs about one round
+ * trip instead of one per video. The thumbnail sizes depend on the measured
+ * link speed: on a slow link the selected video keeps the small thumbnail,
+ * on a fast link loaded thumbnails are replaced by larger ones.
+ * Replacing thumbnails is background work which user input preempts.
+ *
+ * @param selected Load the medium size thumbnail for the selected video.
+ * @param priority Priority of the missing thumbnails.
+ *
+ * @returns Number of requested thumbnails.
+ */
+static int gui_load_row(gui_t *gui, gui_cat_t *cat, int selected, enum transfer_priority priority)
+{
+	transfer_request_t req[MAX_VIDS];
+	gui_thumb_req_t thumb[MAX_VIDS];
+	enum quality_size rowsize;
+	enum quality_size selsize;
+	gui_elem_t *elem;
+	Uint32 start;
+	size_t bytes;
+	int count = 0;
+	int i;
+	int j;
+
+	gui_thumb_sizes(gui, selected, &rowsize, &selsize);
+
+	elem = cat->current;
+	for (j = 0; (elem != NULL) && (j < MAX_VIDS); j++) {
+		enum quality_size size;
+		int medium;
+		int needed;
+
+		/* Without time for the medium size the small thumbnail is shown. */
+		medium = selected && (elem == cat->current) && (elem->urlmedium != NULL) && (selsize > QUALITY_DEFAULT);
+		size = medium ? selsize : rowsize;
+		needed = gui_elem_thumb_needed(elem, medium, size);
+		if (needed) {
+			thumb[count].oldsize = medium ? elem->sizemedium : elem->sizesmall;
+			if (medium) {
+				elem->sizemedium = size;
+				if (needed == 1) {
+					elem->loadedmedium++;
+				}
+			} else {
+				elem->sizesmall = size;
+				if (needed == 1) {
+					elem->loaded++;
+				}
+			}
+			req[count].url = gui_elem_thumb_url(elem, size);
+			thumb[count].elem = elem;
+			thumb[count].medium = medium;
+			thumb[count].upgrade = (needed == 2);
+			thumb[count].finished = 0;
+			thumb[count].size = 0;
+			thumb[count].maxsize = medium ? &gui->mediumsize : &gui->smallsize;
+			thumb[count].stream = thumbnail_stream_alloc(thumb[count].maxsize->w, thumb[count].maxsize->h);
+			req[count].ctx = &thumb[count];
+			req[count].data = gui_thumb_data;
+			req[count].priority = thumb[count].upgrade ? TRANSFER_PRIORITY_BACKGROUND : priority;
+			count++;
+		}
+		elem = elem->next;
+		if ((elem == cat->elem) || (elem == cat->current)) {
+			break;
+		}
+	}
+	if (count > 0) {
+		JT_TRACE_BEGIN("thumbnail", "fetch", cat->title);
+		start = SDL_GetTicks();
+		if (transfer_batch(gui->transfer, req, count, gui_thumb_done) > 0) {
+			/* Loaded again when the user stops. */
+			for (i = 0; i < count; i++) {
+				gui_thumb_req_t *t = &thumb[i];
+
+				if (t->finished) {
+					continue;
+				}
+				if (t->stream != NULL) {
+					thumbnail_stream_free(t->stream);
+					t->stream = NULL;
+				}
+				if (t->medium) {
+					t->elem->sizemedium = t->oldsize;
+					if (!t->upgrade) {
+						t->elem->loadedmedium--;
+					}
+				} else {
+					t->elem->sizesmall = t->oldsize;
+					if (!t->upgrade) {
+						t->elem->loaded--;
+					}
+				}
+			}
+		}
+		/* The requests share the link, so the whole batch is one measurement. */
+		bytes = 0;
+		for (i = 0; i < count; i++) {
+			bytes += thumb[i].size;
+		}
+		quality_add_sample(gui->quality, bytes, SDL_GetTicks() - start);
+		JT_TRACE_END("thumbnail", "fetch");
+	}
+	return count;
+}
 
 static void gui_paint_cat_view(gui_t *gui)
 {
-	SDL_Rect rcDest = { BORDER_X /* X pos */, 90 /* Y pos */, 0, 0 };
+	SDL_Rect rcDest = { BORDER_X /* X pos */, THUMB_Y /* Y pos */, 0, 0 };
 	gui_cat_t *cat;
 	int load_counter;
 	int i;
@@ -1820,30 +2538,25 @@ static void gui_paint_cat_view(gui_t *gui)
 	load_counter = 0;
 	cat = gui->current;
 	if (cat != NULL) {
-		SDL_Surface *sText = NULL;
-
 		if (cat->title != NULL) {
+			char header[512];
+			SDL_Rect headerSrc = { 0, 0, 0, 0};
+			SDL_Rect headerDest = {40, 40, 0, 0};
+			int width;
 			int nr;
 
 			nr = cat->subnr;
 			if (cat->subnr == 0) {
 				nr = cat->channelNr;
 			}
-			/* Convert text to an image. */
-			if (cat->title != NULL) {
-				sText = gui_printf(gui->font, sText, "%03d %s", nr + 1, cat->title);
-			} else {
-				sText = gui_printf(gui->font, sText, "%03d No Title", nr + 1);
-			}
-		}
-		if (sText != NULL) {
-			SDL_Rect headerSrc = { 0, 0, 0, 0};
-			SDL_Rect headerDest = {40, 40, 0, 0};
+			snprintf(header, sizeof(header), "%03d %s", nr + 1, cat->title);
+			width = glyphatlas_width(gui->fontatlas, header, -1);
 
-			headerSrc.w = sText->w;
-			headerSrc.h = sText->h;
-			if (sText->w > (gui->screen->w - 2 * headerDest.x)) {
+			headerSrc.w = width;
+			headerSrc.h = glyphatlas_height(gui->fontatlas);
+			if (width > (gui->screen->w - 2 * headerDest.x)) {
 				headerSrc.w = gui->screen->w - 2 * headerDest.x;
+				gui->animating = 1;
 				cat->scrollpos += cat->scrolldir;
 				headerSrc.x = cat->scrollpos;
 				if (cat->scrollpos <= -headerDest.x) {
@@ -1853,23 +2566,23 @@ static void gui_paint_cat_view(gui_t *gui)
 					/* Stop some time at position 0. */
 					headerSrc.x = 0;
 				}
-				if ((sText->w - cat->scrollpos) < (headerSrc.w - headerDest.x)) {
+				if ((width - cat->scrollpos) < (headerSrc.w - headerDest.x)) {
 					cat->scrolldir = -1;
 				}
-				if ((sText->w - cat->scrollpos) < headerSrc.w) {
+				if ((width - cat->scrollpos) < headerSrc.w) {
 					/* Stop some time at the end. */
-					headerSrc.x = sText->w - headerSrc.w;
+					headerSrc.x = width - headerSrc.w;
 				}
 			}
 
-			SDL_BlitSurface(sText, &headerSrc, gui->screen, &headerDest);
-			SDL_FreeSurface(sText);
-			sText = NULL;
+			headerDest.w = headerSrc.w;
+			headerDest.h = headerSrc.h;
+			glyphatlas_draw(gui->fontatlas, gui->screen, headerDest.x - headerSrc.x, headerDest.y, header, -1, &headerDest);
 		}
 	} else {
 		SDL_Surface *sText = NULL;
 
-		sText = gui_printf(gui->font, sText, "Nothing loaded");
+		sText = gui_printf(gui, gui->font, sText, "Nothing loaded");
 		if (sText != NULL) {
 			SDL_Rect headerDest = {40, 40, 0, 0};
 			rcDest.x = BORDER_X;
@@ -1890,9 +2603,9 @@ static void gui_paint_cat_view(gui_t *gui)
 		if (current == NULL) {
 			SDL_Surface *sText = NULL;
 
-			sText = gui_printf(gui->font, sText, "No video in playlist");
+			sText = gui_printf(gui, gui->font, sText, "No video in playlist");
 			if (sText != NULL) {
-				if ((gui->description_pos - gui->mindistance) >= (rcDest.y + sText->h)) {
+				if (gui->layout.contentbottom >= (rcDest.y + sText->h)) {
 					SDL_BlitSurface(sText, NULL, gui->screen, &rcDest);
 				}
 				if (maxHeight < sText->h) {
@@ -1902,28 +2615,27 @@ static void gui_paint_cat_view(gui_t *gui)
 				sText = NULL;
 			}
 		}
+		if ((current != NULL) && (load_counter < MAX_LOAD_WHILE_PAINT)) {
+			int n;
+
+			/* Delayed load of the whole row. */
+			n = gui_load_row(gui, cat, (cat == gui->current), TRANSFER_PRIORITY_VISIBLE);
+			if (n > 0) {
+				load_counter++;
+				gui->next.thumbmisses += n;
+			}
+		}
 		j = 0;
 		while ((current != NULL) && (j < MAX_VIDS)) {
 			SDL_Surface *image;
 
 			if ((cat == gui->current) && (current == cat->current) && (current->urlmedium != NULL)) {
 				/* Show medium image size. */
-				if ((current->loadedmedium < IMG_LOAD_RETRY) && (load_counter < MAX_LOAD_WHILE_PAINT)) {
-					load_counter++;
-					current->loadedmedium++;
-					/* Delayed load. */
-					image = gui_load_image(gui->transfer, current->urlmedium);
-					if (image != NULL) {
-						current->loadedmedium = IMG_LOADED;
-						if (current->imagemedium != NULL) {
-							SDL_FreeSurface(current->imagemedium);
-							current->imagemedium = NULL;
-						}
-						current->imagemedium = image;
-					}
+				if (current->loadedmedium == IMG_LOADED) {
+					gui->next.thumbhits++;
 				}
 				if (current->imagemedium == NULL) {
-					current->imagemedium = gui_printf(gui->font, current->imagemedium, "No Thumbnail");
+					current->imagemedium = gui_printf(gui, gui->font, current->imagemedium, "No Thumbnail");
 				}
 				if ((current->loadedmedium != IMG_LOADED) && (current->loaded == IMG_LOADED)) {
 					/* Use small image when medium image is not yet available. */
@@ -1933,23 +2645,12 @@ static void gui_paint_cat_view(gui_t *gui)
 					image = current->imagemedium;
 				}
 			} else {
-				/* Show medium image size. */
-				if ((current->loaded < IMG_LOAD_RETRY) && (load_counter < MAX_LOAD_WHILE_PAINT)) {
-					load_counter++;
-					current->loaded++;
-					/* Delayed load. */
-					image = gui_load_image(gui->transfer, current->url);
-					if (image != NULL) {
-						current->loaded = IMG_LOADED;
-						if (current->image != NULL) {
-							SDL_FreeSurface(current->image);
-							current->image = NULL;
-						}
-						current->image = image;
-					}
+				/* Show small image size. */
+				if (current->loaded == IMG_LOADED) {
+					gui->next.thumbhits++;
 				}
 				if (current->image == NULL) {
-					current->image = gui_printf(gui->font, current->image, "No Thumbnail");
+					current->image = gui_printf(gui, gui->font, current->image, "No Thumbnail");
 				}
 				image = current->image;
 			}
@@ -1960,41 +2661,32 @@ static void gui_paint_cat_view(gui_t *gui)
 				if (maxHeight < image->h) {
 					maxHeight = image->h;
 				}
-				if (((gui->logorect.x - gui->mindistance) < (rcDest.x + image->w))
-					&& ((gui->logorect.x + gui->logo->w + gui->mindistance) > rcDest.x)) {
+				if ((gui->layout.logox0 < (rcDest.x + image->w)) && (gui->layout.logox1 > rcDest.x)) {
 					overlap_x = 1;
 				}
-				if (((gui->logorect.y - gui->mindistance) < (rcDest.y + image->h))
-					&& ((gui->logorect.y + gui->logo->h + gui->mindistance) > rcDest.y)) {
+				if ((gui->layout.logoy0 < (rcDest.y + image->h)) && (gui->layout.logoy1 > rcDest.y)) {
 					overlap_y = 1;
 				}
-				if ((gui->description_pos - gui->mindistance) < (rcDest.y + image->h)) {
+				if (gui->layout.contentbottom < (rcDest.y + image->h)) {
 					overlap_y = 1;
 					overlap_x = 1;
 				}
 				if (!overlap_x || !overlap_y) {
 					/* Show video title for first/selected video. */
-					SDL_Surface *sText = NULL;
 
 					SDL_BlitSurface(image, NULL, gui->screen, &rcDest);
 
 					/* Print video title under the image. */
 					if (cat->title != NULL) {
-						sText = cached_title(gui, current->title);
-
-						if (sText == NULL) {
-							/* Convert text to an image. */
-							sText = gui_printf(gui->smallfont, sText, "[%d] %s", current->subnr + 1, current->title);
-							if (sText != NULL) {
-								add_cached_title(gui, sText, current->title);
-							}
-						}
-					}
-					if (sText != NULL) {
+						char title[512];
 						SDL_Rect headerDest = rcDest;
 						SDL_Rect headerSrc;
+						int width;
+
+						snprintf(title, sizeof(title), "[%d] %s", current->subnr + 1, current->title);
+						width = glyphatlas_width(gui->smallatlas, title, -1);
 						headerDest.y += image->h + 10;
-						if (current->textScrollPos > (sText->w - image->w + 10)) {
+						if (current->textScrollPos > (width - image->w + 10)) {
 							/* This can happen, because there are small and medium size thumbnails.
 							 * When the user navigates, the thumbnails can be larger or smaller.
 							 */
@@ -2008,14 +2700,17 @@ static void gui_paint_cat_view(gui_t *gui)
 						}
 						headerSrc.x = current->textScrollPos;
 						headerSrc.y = 0;
-						if (sText->w > image->w) {
+						if (width > image->w) {
 							/* The title is too long, we need to scroll the text. */
 							headerSrc.w = image->w;
+							if ((cat == gui->current) && (current == cat->current)) {
+								gui->animating = 1;
+							}
 							current->textScrollCounter++;
 							if (current->textScrollCounter >= SCROLL_COUNT_MAX) {
 								current->textScrollCounter = SCROLL_COUNT_START;
 								if (current->textScrollDir == 0) {
-									if (current->textScrollPos >= (sText->w - image->w)) {
+									if (current->textScrollPos >= (width - image->w)) {
 										current->textScrollDir = 1;
 										current->textScrollCounter = SCROLL_COUNT_END;
 									} else {
@@ -2033,9 +2728,10 @@ static void gui_paint_cat_view(gui_t *gui)
 						} else {
 							headerSrc.w = image->w;
 						}
-						headerSrc.h = image->h;
-						SDL_BlitSurface(sText, &headerSrc, gui->screen, &headerDest);
-						sText = NULL;
+						headerSrc.h = glyphatlas_height(gui->smallatlas);
+						headerDest.w = headerSrc.w;
+						headerDest.h = headerSrc.h;
+						glyphatlas_draw(gui->smallatlas, gui->screen, headerDest.x - headerSrc.x, headerDest.y, title, -1, &headerDest);
 					}
 				}
 
@@ -2080,11 +2776,14 @@ static void gui_paint_cat_view(gui_t *gui)
 		}
 		i++;
 	}
+	if (load_counter > 0) {
+		gui->loading = 1;
+	}
 }
 
 static void gui_paint_main_view(gui_t *gui)
 {
-	SDL_Rect rcDest = { BORDER_X /* X pos */, 90 /* Y pos */, 0, 0 };
+	SDL_Rect rcDest = { BORDER_X /* X pos */, THUMB_Y /* Y pos */, 0, 0 };
 	gui_menu_entry_t *entry;
 
 	entry = gui->selectedmenu;
@@ -2092,7 +2791,7 @@ static void gui_paint_main_view(gui_t *gui)
 		SDL_Rect headerSrc = { 0, 0, 0, 0 };
 
 		if ((entry->textimg == NULL) && (entry->title != NULL)) {
-			entry->textimg = gui_printf(gui->font, entry->textimg, entry->title);
+			entry->textimg = gui_printf(gui, gui->font, entry->textimg, entry->title);
 		}
 		if (entry->textimg != NULL) {
 			int maxHeight;
@@ -2102,7 +2801,7 @@ static void gui_paint_main_view(gui_t *gui)
 			image = entry->textimg;
 			maxHeight = image->h;
 
-			if ((gui->description_pos - gui->mindistance) >= (rcDest.y + image->h)) {
+			if (gui->layout.contentbottom >= (rcDest.y + image->h)) {
 				headerSrc.h = image->h;
 				headerSrc.w = image->w;
 				if ((headerSrc.w + BORDER_X) > (gui->screen->w - BORDER_X)) {
@@ -2111,6 +2810,8 @@ static void gui_paint_main_view(gui_t *gui)
 				}
 
 				if (entry == gui->selectedmenu) {
+					/* Selected entry is blinking or scrolling. */
+					gui->animating = 1;
 					if (scroll) {
 						headerSrc.x = entry->pos;
 						entry->pos += entry->dir;
@@ -2158,85 +2859,105 @@ static void gui_paint_main_view(gui_t *gui)
 static void gui_paint_status(gui_t *gui)
 {
 	const char *text;
-	char t[5];
-	SDL_Rect rcDest = {BORDER_X, BORDER_Y, 0, 0};
+	int x;
+	int y;
 	int maxHeight = 0;
 
 	text = gui->statusmsg;
+	x = BORDER_X;
+	y = BORDER_Y;
 
 	while(*text != 0) {
-		int i;
+		int len;
 
-		t[0] = 0;
-		t[1] = 0;
-		t[2] = 0;
-		t[3] = 0;
-		t[4] = 0;
-		for (i = 0; i < 4; i++) {
-			t[i] = *text;
-			if ((t[i] & 0x80) == 0x00) {
-				break;
-			}
-			text++;
-		}
+		len = glyphatlas_charlen(text);
 		if (*text == '\n') {
-			rcDest.x = BORDER_X;
-			rcDest.y += maxHeight + BORDER_Y;
+			x = BORDER_X;
+			y += maxHeight + BORDER_Y;
 			maxHeight = 0;
 		} else {
-			SDL_Surface *sText = NULL;
+			int width;
 
-			sText = gui_printf(gui->font, sText, t);
-			if (sText != NULL) {
-				if ((rcDest.x + sText->w) >= (gui->screen->w - BORDER_X)) {
-					rcDest.x = BORDER_X;
-					rcDest.y += maxHeight + DIST_FORCED_LINE_BREAK;
-					maxHeight = 0;
-				}
-				SDL_BlitSurface(sText, NULL, gui->screen, &rcDest);
-				rcDest.x += sText->w;
-				if (sText->h > maxHeight) {
-					maxHeight = sText->h;
-				}
-				SDL_FreeSurface(sText);
-				sText = NULL;
+			width = glyphatlas_width(gui->fontatlas, text, len);
+			if ((x + width) >= (gui->screen->w - BORDER_X)) {
+				x = BORDER_X;
+				y += maxHeight + DIST_FORCED_LINE_BREAK;
 			}
+			x += glyphatlas_draw(gui->fontatlas, gui->screen, x, y, text, len, NULL);
+			maxHeight = glyphatlas_height(gui->fontatlas);
 		}
-		text++;
+		text += len;
 	}
 }
 
-static void gui_paint_pic_text(gui_t *gui, SDL_Rect *rect, SDL_Surface *image, SDL_Surface *text)
+static void gui_paint_nav(gui_t *gui)
 {
-	if ((image != NULL) && (text != NULL)) {
-		if ((gui->logorect.y + gui->logo->h + gui->mindistance) > rect->y) {
-			if ((gui->logorect.x - gui->mindistance) < (rect->x + image->w + 10 + text->w)) {
-				rect->y += text->h + 10;
-				rect->x = gui->mindistance;
-			}
+	SDL_Surface *pic[LEGEND_BUTTONS] = { gui->cross, gui->circle, gui->triangle, gui->square };
+	SDL_Surface *text[LEGEND_BUTTONS] = { gui->cross_text, gui->circle_text, gui->triangle_text, gui->square_text };
+	int i;
+
+	/* Positions are only computed when the descriptions change. */
+	if (!gui->layout.legendvalid || (memcmp(gui->layout.legendtext, text, sizeof(text)) != 0)) {
+		gui_layout_legend(gui, pic, text);
+	}
+	for (i = 0; i < LEGEND_BUTTONS; i++) {
+		if ((pic[i] != NULL) && (text[i] != NULL)) {
+			SDL_Rect rect;
+
+			/* SDL_BlitSurface() changes the rectangle. */
+			rect = gui->layout.legendpic[i];
+			SDL_BlitSurface(pic[i], NULL, gui->screen, &rect);
+			rect = gui->layout.legendpos[i];
+			SDL_BlitSurface(text[i], NULL, gui->screen, &rect);
 		}
-		rect->y += (text->h - image->h) / 2;
-		SDL_BlitSurface(image, NULL, gui->screen, rect);
-		rect->y -= (text->h - image->h) / 2;
-		rect->x += image->w + 10;
-		SDL_BlitSurface(text, NULL, gui->screen, rect);
-		rect->x += text->w + gui->mindistance;
 	}
 }
 
-static void gui_paint_nav(gui_t *gui)
+/** Get percentage of hits, 100 when nothing was looked up. */
+static unsigned int gui_hit_rate(unsigned int hits, unsigned int misses)
 {
-	SDL_Rect rect;
-
-	memset(&rect, 0, sizeof(rect));
+	if ((hits + misses) == 0) {
+		return 100;
+	}
+	return (100 * hits) / (hits + misses);
+}
 
-	rect.x = gui->mindistance;
-	rect.y = gui->description_pos;
+/** Paint performance counters of the last interval in the upper left corner. */
+static void gui_paint_hud(gui_t *gui)
+{
+	metrics_sample_t *s = &gui->sample;
+	char line[4][128];
+	SDL_Rect rect;
+	int height;
+	int i;
 
-	gui_paint_pic_text(gui, &rect, gui->cross, gui->cross_text);
-	gui_paint_pic_text(gui, &rect, gui->circle, gui->circle_text);
-	gui_paint_pic_text(gui, &rect, gui->triangle, gui->triangle_text);
-	gui_paint_pic_text(gui, &rect, gui->square, gui->square_text);
+	snprintf(line[0], sizeof(line[0]), "%u fps, frame %u/%u ms, paint %u/%u ms",
+		s->frames, s->frameavg, s->framemax, s->paintavg, s->paintmax);
+	snprintf(line[1], sizeof(line[1]), "inflight %u, thumbnails queued %u",
+		s->inflight, s->thumbqueue);
+	snprintf(line[2], sizeof(line[2]), "hits thumbnails %u%%, text %u%%",
+		gui_hit_rate(s->thumbhits, s->thumbmisses),
+		gui_hit_rate(s->texthits, s->textmisses));
+	snprintf(line[3], sizeof(line[3]), "surfaces %lu KiB, %lu requests, %llu KiB",
+		s->surfacebytes / 1024, s->requests, s->bytes / 1024);
+
+	height = glyphatlas_height(gui->smallatlas);
+	rect.x = 0;
+	rect.y = 0;
+	rect.w = 0;
+	rect.h = 4 * height + 4;
+	for (i = 0; i < 4; i++) {
+		int width;
+
+		width = glyphatlas_width(gui->smallatlas, line[i], -1) + 4;
+		if (rect.w < width) {
+			rect.w = width;
+		}
+	}
+	SDL_FillRect(gui->screen, &rect, 0x000000);
+	for (i = 0; i < 4; i++) {
+		glyphatlas_draw(gui->smallatlas, gui->screen, 2, 2 + i * height, line[i], -1, NULL);
+	}
 }
 
 /**
@@ -2244,23 +2965,50 @@ static void gui_paint_nav(gui_t *gui)
  */
 static void gui_paint(gui_t *gui, enum gui_state state)
 {
+	Uint32 start;
+
+	start = SDL_GetTicks();
+	gui->animating = 0;
+	gui->loading = 0;
+
+	JT_TRACE_BEGIN("paint", "paint", NULL);
+	JT_TRACE_BEGIN("paint", "background", NULL);
 	SDL_FillRect(gui->screen, NULL, 0x000000);
 
+	if ((gui->layout.w != gui->screen->w) || (gui->layout.h != gui->screen->h)) {
+		/* Screen mode changed. */
+		gui_layout_update(gui);
+	}
 	SDL_BlitSurface(gui->logo, NULL, gui->screen, &gui->logorect);
 	gui_paint_nav(gui);
+	JT_TRACE_END("paint", "background");
 
 	if (gui->statusmsg != NULL) {
+		JT_TRACE_BEGIN("paint", "status", NULL);
 		gui_paint_status(gui);
+		JT_TRACE_END("paint", "status");
 	} else {
 		if (state == GUI_STATE_MAIN_MENU) {
+			JT_TRACE_BEGIN("paint", "main view", NULL);
 			gui_paint_main_view(gui);
+			JT_TRACE_END("paint", "main view");
 		} else {
+			JT_TRACE_BEGIN("paint", "category view", NULL);
 			gui_paint_cat_view(gui);
+			JT_TRACE_END("paint", "category view");
 		}
 	}
 
+	if (gui->hud) {
+		gui_paint_hud(gui);
+	}
+
 	/* Update the screen content. */
+	JT_TRACE_BEGIN("paint", "update", NULL);
 	SDL_UpdateRect(gui->screen, 0, 0, gui->screen->w, gui->screen->h);
+	JT_TRACE_END("paint", "update");
+	JT_TRACE_END("paint", "paint");
+	gui->painttime = SDL_GetTicks() - start;
 }
 
 /** Free large thumbnails to get more memory for new thumbnails. */
@@ -2321,10 +3069,10 @@ static void gui_cat_small_free(gui_cat_t *cat)
 }
 
 /** Get the token for the previous page. */
-static char *gui_get_prevPageToken(gui_cat_t *cat)
+static const char *gui_get_prevPageToken(gui_cat_t *cat)
 {
 	if (cat != NULL) {
-		char *prevPageToken;
+		const char *prevPageToken;
 
 		switch(cat->prevPageState)
 		{
@@ -2372,10 +3120,10 @@ static char *gui_get_prevPageToken(gui_cat_t *cat)
 }
 
 /** Get the token for the next page. */
-static char *gui_get_nextPageToken(gui_cat_t *cat)
+static const char *gui_get_nextPageToken(gui_cat_t *cat)
 {
 	if (cat != NULL) {
-		char *nextPageToken;
+		const char *nextPageToken;
 
 		switch(cat->nextPageState)
 		{
@@ -2422,6 +3170,14 @@ static char *gui_get_nextPageToken(gui_cat_t *cat)
 	}
 }
 
+/** Remember time and direction of a category change for the prefetcher. */
+static void gui_nav_record(gui_t *gui, int dir)
+{
+	gui->navdir = dir;
+	gui->navtime[gui->navpos] = SDL_GetTicks();
+	gui->navpos = (gui->navpos + 1) % NAV_HISTORY;
+}
+
 /** Select next category in list and free "older" stuff. */
 static int gui_inc_cat(gui_t *gui)
 {
@@ -2437,6 +3193,7 @@ static int gui_inc_cat(gui_t *gui)
 			return 1;
 		}
 		gui->current = cat->next;
+		gui_nav_record(gui, 1);
 
 		/* Free thumbnail which are currently not shown. */
 		n = 0;
@@ -2449,7 +3206,7 @@ static int gui_inc_cat(gui_t *gui)
 				gui_cat_small_free(cat);
 			} else if (n == PRESERVE_CAT) {
 				if ((cat->prevPageState == cat->next->prevPageState)) {
-					char *prevPageToken;
+					const char *prevPageToken;
 
 					prevPageToken = gui_get_prevPageToken(cat->next);
 
@@ -2491,6 +3248,7 @@ static int gui_dec_cat(gui_t *gui)
 			return 1;
 		}
 		gui->current = cat->prev;
+		gui_nav_record(gui, -1);
 
 		/* Free thumbnail which are currently not shown. */
 		n = 0;
@@ -2503,7 +3261,7 @@ static int gui_dec_cat(gui_t *gui)
 				gui_cat_small_free(cat);
 			} else if (n == PRESERVE_CAT) {
 				if ((cat->nextPageState == cat->prev->nextPageState)) {
-					char *nextPageToken;
+					const char *nextPageToken;
 
 					nextPageToken = gui_get_nextPageToken(cat->prev);
 
@@ -2550,7 +3308,7 @@ static void gui_inc_elem(gui_t *gui)
 			/* Free thumbnail which are currently not shown. */
 			n = 0;
 			while((elem != NULL) && (elem != cat->elem->prev)) {
-				char *prevPageToken;
+				const char *prevPageToken;
 
 				prevPageToken = elem->prevPageToken;
 				if (n >= PRESERVE_ELEM) {
@@ -2598,7 +3356,7 @@ static void gui_dec_elem(gui_t *gui)
 			/* Free thumbnail which are currently not shown. */
 			n = 0;
 			while((elem != NULL) && (elem != cat->elem)) {
-				char *nextPageToken;
+				const char *nextPageToken;
 
 				nextPageToken = elem->nextPageToken;
 				if (n >= PRESERVE_ELEM) {
@@ -2628,6 +3386,152 @@ static void gui_dec_elem(gui_t *gui)
 	}
 }
 
+/**
+ * Get number of categories which should be loaded ahead of the selected
+ * category. The faster the user navigates, the more are loaded.
+ */
+static int gui_prefetch_distance(gui_t *gui)
+{
+	Uint32 now;
+	int k;
+	int i;
+
+	now = SDL_GetTicks();
+	k = PREFETCH_MIN_CATS;
+	for (i = 0; i < NAV_HISTORY; i++) {
+		if ((gui->navtime[i] != 0) && ((now - gui->navtime[i]) < PREFETCH_WINDOW)) {
+			k++;
+		}
+	}
+	if (k > PREFETCH_MAX_CATS) {
+		k = PREFETCH_MAX_CATS;
+	}
+	return k;
+}
+
+/**
+ * Called by libjt while a request is running. Quitting aborts every
+ * request, user input aborts pages which are only loaded in advance, so
+ * the connection is free for what the user wants now. The events stay in
+ * the queue.
+ */
+static void gui_jt_progress(void *ctx)
+{
+	gui_t *gui = ctx;
+	SDL_Event event;
+	Uint32 mask;
+
+	mask = SDL_QUITMASK;
+	if (gui->prefetchpage) {
+		mask = INPUT_EVENT_MASK;
+	}
+	SDL_PumpEvents();
+	if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, mask) > 0) {
+		gui->cancel = 1;
+	}
+}
+
+/** Check whether the prefetcher can use the time without delaying the user. */
+static int gui_prefetch_allowed(gui_t *gui)
+{
+	SDL_Event event;
+
+	if (gui->loading) {
+		/* Thumbnails of the visible categories are still loading. */
+		return 0;
+	}
+	if (gui->statusmsg != NULL) {
+		return 0;
+	}
+	SDL_PumpEvents();
+	if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0) {
+		/* Handle user input first. */
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Find the last loaded category within k steps in navigation direction
+ * which has another page to load.
+ *
+ * @returns Category after which the next page should be loaded or NULL.
+ */
+static gui_cat_t *gui_prefetch_find_page(gui_t *gui, int k)
+{
+	gui_cat_t *cat;
+	int i;
+
+	cat = gui->current;
+	for (i = 0; (cat != NULL) && (i < k); i++) {
+		if (gui->navdir > 0) {
+			if ((cat->next == NULL) || (cat->next == gui->categories) || (cat->nextPageState != cat->next->nextPageState)) {
+				if (gui_get_nextPageToken(cat) != NULL) {
+					return cat;
+				}
+				return NULL;
+			}
+			cat = cat->next;
+		} else {
+			if ((cat == gui->categories) || (cat->prev == NULL) || (cat->prevPageState != cat->prev->prevPageState)) {
+				if (gui_get_prevPageToken(cat) != NULL) {
+					return cat;
+				}
+				return NULL;
+			}
+			cat = cat->prev;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Load the small thumbnails of one row of the categories which get visible
+ * next when navigating further in the same direction.
+ *
+ * @returns 1 when thumbnails were loaded.
+ */
+static int gui_prefetch_thumbnail(gui_t *gui, int k)
+{
+	gui_cat_t *cat;
+	int skip;
+	int i;
+
+	/* The categories below the selected one are already visible. */
+	skip = (gui->navdir > 0) ? (MAX_SHOW - 1) : 0;
+
+	cat = gui->current;
+	for (i = 0; (cat != NULL) && (i < (skip + k)); i++) {
+		if (gui->navdir > 0) {
+			if ((cat->next == NULL) || (cat->next == gui->categories)) {
+				break;
+			}
+			if ((gui->prev_cat != NULL) && (cat->nextPageState != cat->next->nextPageState)) {
+				/* Don't go outside selected playlist. */
+				break;
+			}
+			cat = cat->next;
+		} else {
+			if ((cat == gui->categories) || (cat->prev == NULL)) {
+				break;
+			}
+			if ((gui->prev_cat != NULL) && (cat->prevPageState != cat->prev->prevPageState)) {
+				/* Don't go outside selected playlist. */
+				break;
+			}
+			cat = cat->prev;
+		}
+		if (i < skip) {
+			/* Loaded by gui_paint(). */
+			continue;
+		}
+
+		if (gui_load_row(gui, cat, 0, TRANSFER_PRIORITY_PREFETCH) > 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
 
 static int update_playlist(gui_t *gui, gui_cat_t *cat, int reverse)
 {
@@ -2635,6 +3539,7 @@ static int update_playlist(gui_t *gui, gui_cat_t *cat, int reverse)
 	int subnr;
 	const char *pageToken;
 	gui_elem_t *last;
+	gui_page_t *page;
 
 	if (cat->elem != NULL) {
 		/* Get the number of the last element in the list. */
@@ -2689,6 +3594,8 @@ static int update_playlist(gui_t *gui, gui_cat_t *cat, int reverse)
 		if (reverse) {
 			subnr -= resultsPerPage;
 		}
+		/* Nodes and strings of the videos of this page. */
+		page = gui_page_alloc();
 		for (i = 0; (i < resultsPerPage) && (subnr < totalResults); i++) {
 			const char *url;
 			gui_elem_t *elem;
@@ -2704,29 +3611,29 @@ static int update_playlist(gui_t *gui, gui_cat_t *cat, int reverse)
 			
 			url = jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/default/url", i);
 
-			elem = gui_elem_alloc(gui, cat, last, url);
+			elem = gui_elem_alloc(gui, cat, page, last, url);
 			if (elem != NULL) {
 				last = elem;
 				if (i == 0) {
-					elem->prevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
+					elem->prevPageToken = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "prevPageToken"));
 					if (!reverse) {
 						cat->current = elem;
 					}
 				}
-			 	elem->title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
-				elem->urlmedium = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/medium/url", i));
-				elem->videoid = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/resourceId/videoId", i));
+			 	elem->title = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
+				elem->urlmedium = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/medium/url", i));
+				elem->urlhigh = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/high/url", i));
+				elem->videoid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/resourceId/videoId", i));
 				elem->subnr = subnr;
 			}
 			subnr++;
 		}
+		gui_page_release(page);
+		page = NULL;
 
 		if (last != NULL) {
-			if (last->nextPageToken != NULL) {
-				free(last->nextPageToken);
-				last->nextPageToken = NULL;
-			}
-			last->nextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
+			/* Can be a video of the previous page when the page was empty. */
+			last->nextPageToken = arena_strdup(last->page->arena, jt_json_get_string_by_path(gui->at, "nextPageToken"));
 			if (reverse) {
 				cat->current = last;
 			}
@@ -2758,7 +3665,7 @@ static int update_channelid_of_video(gui_t *gui, gui_elem_t *selected_video)
 		if ((selected_video->videoid != NULL) && (selected_video->channelid == NULL)) {
 			rv = jt_get_video(gui->at, selected_video->videoid);
 			if (rv == JT_OK) {
-				selected_video->channelid = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/channelId", 0));
+				selected_video->channelid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/channelId", 0));
 				jt_free_transfer(gui->at);
 			}
 		}
@@ -2827,23 +3734,19 @@ static int update_favorites(gui_t *gui, gui_cat_t *selected_cat, int reverse)
 				last = cat;
 				cat->nextPageState = GUI_STATE_GET_FAVORITES;
 				cat->prevPageState = GUI_STATE_GET_PREV_FAVORITES;
-				cat->channelid = jt_strdup(jt_json_get_string_by_path(gui->at, "/snippet[%d]/channelId", i));
-				cat->playlistid = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/id", i));
-		 		cat->title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
+				cat->channelid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/snippet[%d]/channelId", i));
+				cat->playlistid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/id", i));
+		 		cat->title = arena_strdup(cat->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
 				cat->favnr = favnr;
 				if (i == 0) {
-					cat->favoritesPrevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
+					cat->favoritesPrevPageToken = arena_strdup(cat->arena, jt_json_get_string_by_path(gui->at, "prevPageToken"));
 				}
 			}
 			favnr++;
 		}
 		if (last != NULL) {
 			if (last->nextPageState == GUI_STATE_GET_FAVORITES) {
-				if (last->favoritesNextPageToken != NULL) {
-					free(last->favoritesNextPageToken);
-					last->favoritesNextPageToken = NULL;
-				}
-				last->favoritesNextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
+				last->favoritesNextPageToken = arena_strdup(last->arena, jt_json_get_string_by_path(gui->at, "nextPageToken"));
 			}
 		}
 		jt_free_transfer(gui->at);
@@ -2851,233 +3754,311 @@ static int update_favorites(gui_t *gui, gui_cat_t *selected_cat, int reverse)
 	return rv;
 }
 
-static int update_subscriptions(gui_t *gui, gui_cat_t *selected_cat, int reverse, const char *catpagetoken, int catnr, const char *selected_playlistid, const char *videopagetoken, int vidnr)
+/**
+ * Load the list of all subscriptions with a few large pages. Only channel ID
+ * and title are stored, the categories are created by update_subscriptions().
+ */
+static int gui_load_subscription_index(gui_t *gui)
 {
+	char *pageToken = NULL;
+	int size = 0;
 	int rv;
-	int subnr;
-	const char *pageToken;
 
-	if (selected_cat != NULL) {
-		subnr = selected_cat->subnr;
-		if (reverse) {
-			pageToken = selected_cat->subscriptionPrevPageToken;
-		} else {
-			pageToken = selected_cat->subscriptionNextPageToken;
-			subnr++;
+	gui_free_subscription_index(gui);
+	do {
+		json_object *items;
+		int count;
+		int i;
+
+		rv = jt_get_my_subscription_list(gui->at, (pageToken != NULL) ? pageToken : "");
+		if (pageToken != NULL) {
+			free(pageToken);
+			pageToken = NULL;
 		}
-		if (pageToken == NULL) {
-			LOG_ERROR("%s: Bad pageToken in cat %s.\n", __FUNCTION__, selected_cat->title);
-			return JT_ERROR;
+		if (rv != JT_OK) {
+			break;
 		}
-	} else {
-		subnr = 0;
-		pageToken = "";
-	}
-	if (catpagetoken != NULL) {
-		pageToken = catpagetoken;
-		subnr = catnr;
-	}
 
-	rv = jt_get_my_subscriptions(gui->at, pageToken);
-	if (rv == JT_OK) {
-		gui_cat_t *last;
-		int totalResults = 0;
-		int resultsPerPage = 0;
-		int i;
+		items = jt_json_get_object_by_path(gui->at, "/items");
+		count = (items != NULL) ? json_object_array_length(items) : 0;
+		if ((gui->subcount + count) > size) {
+			gui_sub_t *subs;
 
-		if (reverse) {
-			if (selected_cat != NULL) {
-				last = selected_cat->prev;
+			size = gui->subcount + count;
+			subs = realloc(gui->subs, size * sizeof(*subs));
+			if (subs == NULL) {
+				jt_free_transfer(gui->at);
+				rv = JT_NO_MEM;
+				break;
 			}
-		} else {
-			last = selected_cat;
+			gui->subs = subs;
 		}
-
-		rv = jt_json_get_int_by_path(gui->at, &totalResults, "/pageInfo/totalResults");
-		if (rv != JT_OK) {
-			totalResults = 0;
-		}
-
-		rv = jt_json_get_int_by_path(gui->at, &resultsPerPage, "/pageInfo/resultsPerPage");
-		if (rv != JT_OK) {
-			resultsPerPage = 0;
-		}
-		if (reverse) {
-			subnr -= resultsPerPage;
-		}
-		for (i = 0; (i < resultsPerPage) && (subnr < totalResults); i++) {
+		for (i = 0; i < count; i++) {
 			const char *channelid;
-			
+
 			channelid = jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/resourceId/channelId", i);
 			if (channelid != NULL) {
-				gui_cat_t *cat;
+				gui_sub_t *sub = &gui->subs[gui->subcount];
 
-				cat = gui_cat_alloc(gui, &gui->get_channel_cat, last);
-				if (cat != NULL) {
-					last = cat;
-					cat->nextPageState = GUI_STATE_GET_SUBSCRIPTIONS;
-					cat->prevPageState = GUI_STATE_GET_PREV_SUBSCRIPTIONS;
-					cat->channelid = strdup(channelid);
-					cat->subnr = subnr;
-			 		cat->title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
-					/* Check if this playlist should be selected. */
-					if (selected_playlistid != NULL) {
-						/* Select same video page as selected before. */
-						cat->videopagetoken = videopagetoken;
-						cat->expected_playlistid = selected_playlistid;
-					}
-					cat->vidnr = vidnr;
-					if (i == 0) {
-						cat->subscriptionPrevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
-						if ((cat->subscriptionPrevPageToken == NULL) && (resultsPerPage != 0)) {
-							int page;
-
-							page = jt_get_page_number(pageToken);
-							page -= resultsPerPage;
-
-							if (page > 0) {
-								last->subscriptionPrevPageToken = jt_get_page_token(page);
-							}
-						}
-					}
+				sub->channelid = intern_get(gui->ids, channelid);
+				sub->title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
+				sub->playlistid = NULL;
+				if (sub->channelid != NULL) {
+					gui->subcount++;
 				}
 			}
-			subnr++;
 		}
-		if (last != NULL) {
-			if (last->nextPageState == GUI_STATE_GET_SUBSCRIPTIONS) {
-				if (last->subscriptionNextPageToken != NULL) {
-					free(last->subscriptionNextPageToken);
-					last->subscriptionNextPageToken = NULL;
-				}
+		pageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
+		jt_free_transfer(gui->at);
+	} while (pageToken != NULL);
 
-				last->subscriptionNextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
-				if ((last->subscriptionNextPageToken == NULL) && (resultsPerPage != 0)) {
-					int page;
+	LOG("Loaded %d subscriptions.\n", gui->subcount);
+	if ((rv == JT_OK) && (gui->subs == NULL)) {
+		/* Mark index as loaded when there are no subscriptions. */
+		gui->subs = malloc(sizeof(*gui->subs));
+		if (gui->subs == NULL) {
+			rv = JT_NO_MEM;
+		}
+	}
+	if (rv != JT_OK) {
+		gui_free_subscription_index(gui);
+	}
+	return rv;
+}
 
-					page = jt_get_page_number(pageToken);
-					page += resultsPerPage;
+/** Find subscription of the channel in the index, channelid must be interned. */
+static gui_sub_t *gui_find_subscription(gui_t *gui, const char *channelid)
+{
+	int i;
 
-					if (page < totalResults) {
-						last->subscriptionNextPageToken = jt_get_page_token(page);
-					}
-				}
-			}
+	for (i = 0; i < gui->subcount; i++) {
+		if (gui->subs[i].channelid == channelid) {
+			return &gui->subs[i];
 		}
-		jt_free_transfer(gui->at);
+	}
+	return NULL;
+}
+
+/** Get the page token for a position in the subscription index, stored in arena. */
+static char *gui_arena_page_token(arena_t *arena, int nr)
+{
+	char *token;
+	char *rv;
+
+	token = jt_get_page_token(nr);
+	rv = arena_strdup(arena, token);
+	if (token != NULL) {
+		free(token);
+		token = NULL;
 	}
 	return rv;
 }
 
-static int update_channels(gui_t *gui, gui_cat_t *selected_cat, gui_cat_t **l)
+/**
+ * Create the categories for the next or previous SUBSCRIPTION_WINDOW
+ * subscriptions. Categories of channels with unknown uploads playlist are
+ * added to gui->get_channel_cat, the others to gui->get_playlist_cat.
+ */
+static int update_subscriptions(gui_t *gui, gui_cat_t *selected_cat, int reverse, const char *catpagetoken, int catnr, const char *selected_playlistid, const char *videopagetoken, int vidnr)
 {
 	int rv;
-	int channelNr;
-	int channelStart;
-	const char *nextPageToken;
+	int subnr;
+	int start;
+	int end;
+	int i;
+	gui_cat_t *last;
 
-	if (selected_cat == NULL) {
-		/* Get first page. */
-		channelNr = 0;
-		nextPageToken = "";
-	} else {
-		/* Get next page. */
-		channelNr = selected_cat->channelNr;
-		nextPageToken = selected_cat->channelNextPageToken;
-		if (nextPageToken == NULL) {
-			nextPageToken = "";
+	if (selected_cat != NULL) {
+		const char *pageToken;
+
+		subnr = selected_cat->subnr;
+		if (reverse) {
+			pageToken = selected_cat->subscriptionPrevPageToken;
 		} else {
-			channelNr++;
+			pageToken = selected_cat->subscriptionNextPageToken;
+			subnr++;
+		}
+		if (pageToken == NULL) {
+			LOG_ERROR("%s: Bad pageToken in cat %s.\n", __FUNCTION__, selected_cat->title);
+			return JT_ERROR;
+		}
+	} else {
+		subnr = 0;
+	}
+	if (catpagetoken != NULL) {
+		/* The page tokens are only markers, the number selects the subscription. */
+		subnr = catnr;
+	}
+
+	if (gui->subs == NULL) {
+		rv = gui_load_subscription_index(gui);
+		if (rv != JT_OK) {
+			return rv;
 		}
 	}
-	channelStart = channelNr;
-	rv = jt_get_channels(gui->at, selected_cat->channelid, nextPageToken);
-	if (rv == JT_OK) {
-		int totalResults = 0;
-		int resultsPerPage = 0;
-		int i;
-		gui_cat_t *last;
 
+	if (reverse) {
+		end = subnr;
+		start = end - SUBSCRIPTION_WINDOW;
+		last = (selected_cat != NULL) ? selected_cat->prev : NULL;
+	} else {
+		start = subnr;
+		end = start + SUBSCRIPTION_WINDOW;
 		last = selected_cat;
+	}
+	if (start < 0) {
+		start = 0;
+	}
+	if (end > gui->subcount) {
+		end = gui->subcount;
+	}
 
-		rv = jt_json_get_int_by_path(gui->at, &totalResults, "/pageInfo/totalResults");
-		if (rv != JT_OK) {
-			totalResults = 0;
+	for (i = start; i < end; i++) {
+		gui_sub_t *sub = &gui->subs[i];
+		gui_cat_t *cat;
+
+		cat = gui_cat_alloc(gui, (sub->playlistid != NULL) ? &gui->get_playlist_cat : &gui->get_channel_cat, last);
+		if (cat == NULL) {
+			break;
 		}
+		last = cat;
+		cat->nextPageState = GUI_STATE_GET_SUBSCRIPTIONS;
+		cat->prevPageState = GUI_STATE_GET_PREV_SUBSCRIPTIONS;
+		cat->channelid = sub->channelid;
+		cat->playlistid = sub->playlistid;
+		cat->subnr = i;
+		cat->title = arena_strdup(cat->arena, sub->title);
+		/* Check if this playlist should be selected. */
+		if ((selected_playlistid != NULL) && (i == catnr)) {
+			/* Select same video page as selected before. */
+			cat->videopagetoken = videopagetoken;
+			cat->expected_playlistid = selected_playlistid;
+			cat->vidnr = vidnr;
+		}
+		if ((i == start) && (start > 0) && (reverse || (selected_cat == NULL))) {
+			cat->subscriptionPrevPageToken = gui_arena_page_token(cat->arena, start);
+		}
+	}
+	if ((last != NULL) && !reverse && (last->nextPageState == GUI_STATE_GET_SUBSCRIPTIONS) && (end < gui->subcount)) {
+		last->subscriptionNextPageToken = gui_arena_page_token(last->arena, end);
+	}
+	return JT_OK;
+}
 
-		rv = jt_json_get_int_by_path(gui->at, &resultsPerPage, "/pageInfo/resultsPerPage");
-		if (rv != JT_OK) {
-			resultsPerPage = 0;
+/**
+ * Get the uploads playlists of the categories in gui->get_channel_cat with
+ * one request and move them to gui->get_playlist_cat.
+ */
+static int update_channels(gui_t *gui)
+{
+	gui_cat_t *batch[CHANNEL_BATCH];
+	int count;
+	size_t len;
+	char *ids;
+	int rv;
+	int i;
+
+	count = 0;
+	len = 1;
+	while ((gui->get_channel_cat != NULL) && (count < CHANNEL_BATCH)) {
+		gui_cat_t *cat;
+
+		cat = gui->get_channel_cat;
+		if (cat->next != cat) {
+			/* Remove it from the gui->get_channel_cat list. */
+			gui->get_channel_cat = cat->next;
+			gui->get_channel_cat->prev = cat->prev;
+			cat->prev->next = gui->get_channel_cat;
+		} else {
+			/* List is now empty. */
+			gui->get_channel_cat = NULL;
 		}
-		for (i = 0; (i < resultsPerPage) && (channelNr < totalResults); i++) {
-			const char *playlistid;
 
-			playlistid = jt_json_get_string_by_path(gui->at, "/items[%d]/contentDetails/relatedPlaylists/uploads", i);
-			if (playlistid != NULL) {
-				gui_cat_t *cat = selected_cat;
+		/* Insert in list for GUI_STATE_GET_PLAYLIST: */
+		if (gui->get_playlist_cat == NULL) {
+			/* First element added. */
+			gui->get_playlist_cat = cat;
+			cat->next = cat;
+			cat->prev = cat;
+		} else {
+			gui_cat_t *l;
 
-				if ((cat == NULL) || (cat->playlistid != NULL)) {
-					/* Need to add new cat for playlist. */
-					cat = gui_cat_alloc(gui, &gui->get_playlist_cat, last);
-					LOG_ERROR("Call gui_cat_alloc\n");
-				}
+			/* Add at the end of the list. */
+			l = gui->get_playlist_cat->prev;
 
-				if (cat != NULL) {
-					char *title;
-					const char *channelid;
+			/* Add as new last: */
+			cat->next = gui->get_playlist_cat;
+			cat->prev = l;
 
-					last = cat;
+			gui->get_playlist_cat->prev = cat;
+			l->next = cat;
+		}
 
-					if (selected_cat != NULL) {
-						cat->nextPageState = selected_cat->nextPageState;
-						cat->prevPageState = selected_cat->prevPageState;
-					} else {
-						cat->nextPageState = GUI_STATE_GET_CHANNELS;
-						cat->prevPageState = GUI_STATE_GET_PREV_CHANNELS;
-					}
-					cat->channelNr = channelNr;
-					cat->channelStart = channelStart;
-					channelid = jt_json_get_string_by_path(gui->at, "/items[%d]/id", i);
+		if (cat->channelid != NULL) {
+			batch[count] = cat;
+			count++;
+			len += strlen(cat->channelid) + 1;
+		}
+	}
+	if (count == 0) {
+		return JT_OK;
+	}
 
-					if (channelid != NULL) {
-						if (cat->channelid != NULL) {
-							free(cat->channelid);
-							cat->channelid = NULL;
-						}
-						cat->channelid = strdup(channelid);
-					}
-					cat->playlistid = strdup(playlistid);
-			 		title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
-					if (title != NULL) {
-						if (cat->title != NULL) {
-							free(cat->title);
-							cat->title = NULL;
-						}
-						cat->title = title;
-					}
+	/* Comma separated list of channel IDs. */
+	ids = malloc(len);
+	if (ids == NULL) {
+		return JT_NO_MEM;
+	}
+	ids[0] = 0;
+	for (i = 0; i < count; i++) {
+		if (i > 0) {
+			strcat(ids, ",");
+		}
+		strcat(ids, batch[i]->channelid);
+	}
+	rv = jt_get_channels(gui->at, ids, "");
+	free(ids);
+	ids = NULL;
+
+	if (rv == JT_OK) {
+		json_object *items;
+		int n;
+
+		items = jt_json_get_object_by_path(gui->at, "/items");
+		n = (items != NULL) ? json_object_array_length(items) : 0;
+		for (i = 0; i < n; i++) {
+			const char *channelid;
+			const char *playlistid;
+			int j;
+
+			channelid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/id", i));
+			playlistid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/contentDetails/relatedPlaylists/uploads", i));
+			if ((channelid == NULL) || (playlistid == NULL)) {
+				continue;
+			}
+			for (j = 0; j < count; j++) {
+				gui_cat_t *cat = batch[j];
+
+				if ((cat->playlistid == NULL) && (cat->channelid == channelid)) {
+					gui_sub_t *sub;
+
+					cat->playlistid = playlistid;
 					if (cat->expected_playlistid != NULL) {
-						if (strcmp(playlistid, cat->expected_playlistid) != 0) {
+						if (playlistid != cat->expected_playlistid) {
 							/* Page token is not valid for current playllist. */
 							cat->videopagetoken = NULL;
 							cat->expected_playlistid = NULL;
 						}
 					}
-					if (i == 0) {
-						cat->channelPrevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
+					/* Remember it, so that it is not requested again. */
+					sub = gui_find_subscription(gui, channelid);
+					if ((sub != NULL) && (sub->playlistid == NULL)) {
+						sub->playlistid = cat->playlistid;
 					}
 				}
 			}
-			channelNr++;
-		}
-		if (last != NULL) {
-			if (last->channelNextPageToken != NULL) {
-				free(last->channelNextPageToken);
-				last->channelNextPageToken = NULL;
-			}
-			last->channelNextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
 		}
 		jt_free_transfer(gui->at);
-		*l = last;
 	}
 	return rv;
 }
@@ -3132,7 +4113,7 @@ static int update_my_channels(gui_t *gui, gui_cat_t *selected_cat, const char *s
 			jobj = jt_json_get_object_by_path(gui->at, "/items[%d]/contentDetails/relatedPlaylists", i);
 			json_object_object_foreach(jobj, key, val) {
 				if (json_object_get_type(val) == json_type_string) {
-					const char *playlistid = json_object_get_string(val);
+					const char *playlistid = intern_get(gui->ids, json_object_get_string(val));
 
 					if (playlistid != NULL) {
 						gui_cat_t *cat = selected_cat;
@@ -3153,10 +4134,10 @@ static int update_my_channels(gui_t *gui, gui_cat_t *selected_cat, const char *s
 							cat->prevPageState = GUI_STATE_GET_MY_PREV_CHANNELS;
 							cat->channelNr = channelNr;
 							cat->channelStart = channelStart;
-							cat->channelid = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/id", i));
-							cat->playlistid = strdup(playlistid);
+							cat->channelid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/id", i));
+							cat->playlistid = playlistid;
 							/* Check if this playlist should be selected. */
-							if ((selected_playlistid != NULL) && (strcmp(selected_playlistid, playlistid) == 0)) {
+							if ((selected_playlistid != NULL) && (selected_playlistid == playlistid)) {
 								/* Select same video page as selected before. */
 								cat->videopagetoken = videopagetoken;
 								cat->expected_playlistid = selected_playlistid;
@@ -3216,17 +4197,15 @@ static int update_my_channels(gui_t *gui, gui_cat_t *selected_cat, const char *s
 								}
 							}
 							if (ret != -1) {
-								if (cat->title != NULL) {
-									free(cat->title);
-									cat->title = NULL;
-								}
-								cat->title = t;
+								cat->title = arena_strdup(cat->arena, t);
+								free(t);
+								t = NULL;
 							}
 							if (cat->title == NULL) {
-								cat->title = strdup("Unknown");
+								cat->title = arena_strdup(cat->arena, "Unknown");
 							}
 							if (i == 0) {
-								cat->channelPrevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
+								cat->channelPrevPageToken = arena_strdup(cat->arena, jt_json_get_string_by_path(gui->at, "prevPageToken"));
 							}
 						}
 					}
@@ -3235,11 +4214,7 @@ static int update_my_channels(gui_t *gui, gui_cat_t *selected_cat, const char *s
 			}
 		}
 		if (last != NULL) {
-			if (last->channelNextPageToken != NULL) {
-				free(last->channelNextPageToken);
-				last->channelNextPageToken = NULL;
-			}
-			last->channelNextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
+			last->channelNextPageToken = arena_strdup(last->arena, jt_json_get_string_by_path(gui->at, "nextPageToken"));
 		}
 		jt_free_transfer(gui->at);
 	}
@@ -3319,7 +4294,7 @@ static int update_channel_playlists(gui_t *gui, gui_cat_t *selected_cat, int rev
 		for (i = 0; (i < resultsPerPage) && (channelNr < totalResults); i++) {
 			const char *playlistid;
 
-			playlistid = jt_json_get_string_by_path(gui->at, "/items[%d]/id", i);
+			playlistid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/id", i));
 			if (playlistid != NULL) {
 				gui_cat_t *cat = selected_cat;
 
@@ -3332,7 +4307,7 @@ static int update_channel_playlists(gui_t *gui, gui_cat_t *selected_cat, int rev
 				}
 
 				if (cat != NULL) {
-					char *title;
+					const char *title;
 					const char *channelid;
 
 					last = cat;
@@ -3344,30 +4319,22 @@ static int update_channel_playlists(gui_t *gui, gui_cat_t *selected_cat, int rev
 					channelid = jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/channelId", i);
 
 					if (channelid != NULL) {
-						if (cat->channelid != NULL) {
-							free(cat->channelid);
-							cat->channelid = NULL;
-						}
-						cat->channelid = strdup(channelid);
+						cat->channelid = intern_get(gui->ids, channelid);
 					}
-					cat->playlistid = strdup(playlistid);
-			 		title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
+					cat->playlistid = playlistid;
+			 		title = jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i);
 					if (title != NULL) {
-						if (cat->title != NULL) {
-							free(cat->title);
-							cat->title = NULL;
-						}
-						cat->title = title;
+						cat->title = arena_strdup(cat->arena, title);
 					}
 					/* Check if this playlist should be selected. */
-					if ((selected_playlistid != NULL) && (strcmp(selected_playlistid, playlistid) == 0)) {
+					if ((selected_playlistid != NULL) && (selected_playlistid == playlistid)) {
 						/* Select same video page as selected before. */
 						cat->videopagetoken = videopagetoken;
 						cat->expected_playlistid = selected_playlistid;
 					}
 					cat->vidnr = vidnr;
 					if (i == 0) {
-						cat->channelPrevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
+						cat->channelPrevPageToken = arena_strdup(cat->arena, jt_json_get_string_by_path(gui->at, "prevPageToken"));
 						/* If this is new, automatically select the playlist. */
 						if ((selected_cat == NULL) || (selected_cat->nextPageState != cat->nextPageState)) {
 							if (!reverse) {
@@ -3380,11 +4347,7 @@ static int update_channel_playlists(gui_t *gui, gui_cat_t *selected_cat, int rev
 			channelNr++;
 		}
 		if (last != NULL) {
-			if (last->channelNextPageToken != NULL) {
-				free(last->channelNextPageToken);
-				last->channelNextPageToken = NULL;
-			}
-			last->channelNextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
+			last->channelNextPageToken = arena_strdup(last->arena, jt_json_get_string_by_path(gui->at, "nextPageToken"));
 		}
 		jt_free_transfer(gui->at);
 	}
@@ -3397,6 +4360,7 @@ static int update_search_playlists(gui_t *gui, gui_cat_t *cat, int reverse)
 	int subnr;
 	const char *pageToken;
 	gui_elem_t *last;
+	gui_page_t *page;
 
 	if (cat->elem != NULL) {
 		/* Get the number of the last element in the list. */
@@ -3451,6 +4415,8 @@ static int update_search_playlists(gui_t *gui, gui_cat_t *cat, int reverse)
 		if (reverse) {
 			subnr -= resultsPerPage;
 		}
+		/* Nodes and strings of the videos of this page. */
+		page = gui_page_alloc();
 		for (i = 0; (i < resultsPerPage) && (subnr < totalResults); i++) {
 			const char *url;
 			gui_elem_t *elem;
@@ -3466,30 +4432,30 @@ static int update_search_playlists(gui_t *gui, gui_cat_t *cat, int reverse)
 			
 			url = jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/default/url", i);
 
-			elem = gui_elem_alloc(gui, cat, last, url);
+			elem = gui_elem_alloc(gui, cat, page, last, url);
 			if (elem != NULL) {
 				last = elem;
 				if (i == 0) {
-					elem->prevPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "prevPageToken"));
+					elem->prevPageToken = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "prevPageToken"));
 					if (!reverse) {
 						cat->current = elem;
 					}
 				}
-			 	elem->title = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
-				elem->urlmedium = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/medium/url", i));
-				elem->videoid = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/id/videoId", i));
-				elem->channelid = jt_strdup(jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/channelId", i));
+			 	elem->title = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/title", i));
+				elem->urlmedium = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/medium/url", i));
+				elem->urlhigh = arena_strdup(page->arena, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/thumbnails/high/url", i));
+				elem->videoid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/id/videoId", i));
+				elem->channelid = intern_get(gui->ids, jt_json_get_string_by_path(gui->at, "/items[%d]/snippet/channelId", i));
 				elem->subnr = subnr;
 			}
 			subnr++;
 		}
+		gui_page_release(page);
+		page = NULL;
 
 		if (last != NULL) {
-			if (last->nextPageToken != NULL) {
-				free(last->nextPageToken);
-				last->nextPageToken = NULL;
-			}
-			last->nextPageToken = jt_strdup(jt_json_get_string_by_path(gui->at, "nextPageToken"));
+			/* Can be a video of the previous page when the page was empty. */
+			last->nextPageToken = arena_strdup(last->page->arena, jt_json_get_string_by_path(gui->at, "nextPageToken"));
 			if (reverse) {
 				cat->current = last;
 			}
@@ -3533,16 +4499,75 @@ static const char *find_cat_page_token(gui_t *gui, gui_cat_t *cat)
 	return NULL;
 }
 
-static int playVideo(gui_t *gui, const char *videofile, gui_cat_t *cat, gui_elem_t *elem, int format, int buffersize, const char *lastcatpagetoken)
+/** Shut down the video subsystem while another program uses the display. */
+static void gui_suspend_display(gui_t *gui)
 {
-	if (videofile == NULL) {
-		char *cmd = NULL;
-		int ret;
+	/* Keep fullscreen mode changed by the user. */
+	gui->videoflags = (gui->videoflags & ~SDL_FULLSCREEN) | (gui->screen->flags & SDL_FULLSCREEN);
+	gui->videosize.w = gui->screen->w;
+	gui->videosize.h = gui->screen->h;
+	gui->videobpp = gui->screen->format->BitsPerPixel;
+	gui->screen = NULL;
+	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
 
-		if (gui->fullscreenmode) {
-			/* Disable fullscreen, so that mplayer can get it for playing the video. */
-			SDL_WM_ToggleFullScreen(gui->screen);
+/**
+ * Set the video mode again after gui_suspend_display(). Surfaces, fonts and
+ * caches survive, because only software surfaces are used.
+ *
+ * @returns 0 on success.
+ */
+static int gui_resume_display(gui_t *gui)
+{
+	if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
+		LOG_ERROR("Couldn't initialize SDL video: %s\n", SDL_GetError());
+		return -1;
+	}
+	/* Same mode as before, so that the images still have the screen format. */
+	gui->screen = SDL_SetVideoMode(gui->videosize.w, gui->videosize.h, gui->videobpp, gui->videoflags);
+	if (gui->screen == NULL) {
+		LOG_ERROR("Couldn't set %dx%d video mode: %s\n", gui->videosize.w, gui->videosize.h, SDL_GetError());
+		return -1;
+	}
+	SDL_ShowCursor(SDL_DISABLE);
+	glyphatlas_set_screen(gui->fontatlas, gui->screen);
+	glyphatlas_set_screen(gui->smallatlas, gui->screen);
+
+	return 0;
+}
+
+/**
+ * Get video which is played after elem in playlist mode.
+ *
+ * @param direction 1 for playing forward, -1 for backward and 0 for no playlist.
+ *
+ * @returns NULL when there is no next video or it is on another page.
+ */
+static gui_elem_t *gui_playlist_next(gui_cat_t *cat, gui_elem_t *elem, int direction)
+{
+	gui_elem_t *next = NULL;
+
+	if (direction > 0) {
+		if (elem->next != cat->elem) {
+			next = elem->next;
+		}
+	} else if (direction < 0) {
+		if (elem != cat->elem) {
+			next = elem->prev;
 		}
+	}
+	if ((next == elem) || ((next != NULL) && (next->videoid == NULL))) {
+		next = NULL;
+	}
+	return next;
+}
+
+static int playVideo(gui_t *gui, const char *videofile, gui_cat_t *cat, gui_elem_t *elem, int direction, int buffersize, const char *lastcatpagetoken)
+{
+	gui->gapless = 0;
+	if (videofile == NULL) {
+		gui_elem_t *next;
+		int ret;
 
 		printf("Playing %s (%s)\n", CHECKSTR(elem->title), CHECKSTR(elem->videoid));
 		if (elem->videoid == NULL) {
@@ -3550,26 +4575,31 @@ static int playVideo(gui_t *gui, const char *videofile, gui_cat_t *cat, gui_elem
 			return 1;
 		}
 
-		if (format == 0) {
-			ret = asprintf(&cmd, "wget --user-agent=\"$(youtube-dl --dump-user-agent)\" -o /dev/null -O - --load-cookies /tmp/ytcookie-%s.txt - \"$(youtube-dl -g --cookies=/tmp/ytcookie-%s.txt 'http://www.youtube.com/watch?v=%s')\" | mplayer -cache %d -fs -", elem->videoid, elem->videoid, elem->videoid, buffersize);
-		} else {
-			ret = asprintf(&cmd, "wget --user-agent=\"$(youtube-dl --dump-user-agent)\" -o /dev/null -O - --load-cookies /tmp/ytcookie-%s.txt - \"$(youtube-dl -g -f %d --cookies=/tmp/ytcookie-%s.txt 'http://www.youtube.com/watch?v=%s')\" | mplayer -cache %d -", elem->videoid, format, elem->videoid, elem->videoid, buffersize);
-		}
-		if (ret != -1) {
-			printf("%s\n", cmd);
-			system(cmd);
-			free(cmd);
-			cmd = NULL;
-			ret = asprintf(&cmd, "/tmp/ytcookie-%s.txt", elem->videoid);
-			if (ret != -1) {
-				unlink(cmd);
-				free(cmd);
-				cmd = NULL;
-			}
-		} else {
-			cmd = NULL;
+		if (gui->resident) {
+			/* Release the display, so that mplayer can use it for playing the video. */
+			gui_suspend_display(gui);
+		} else if (gui->fullscreenmode) {
+			/* Disable fullscreen, so that mplayer can get it for playing the video. */
+			SDL_WM_ToggleFullScreen(gui->screen);
+		}
+
+		/* Uses the stream URL resolved while the video was selected. The next
+		 * video of the playlist is pre-buffered while playing.
+		 */
+		next = gui_playlist_next(cat, elem, direction);
+		ret = player_play(gui->player, elem->videoid, buffersize, 1, (next != NULL) ? next->videoid : NULL);
+		if (ret == 1) {
+			LOG_ERROR("Failed to play %s.\n", elem->videoid);
+		}
+		if ((ret == 0) && (next != NULL) && player_ready(gui->player, next->videoid)) {
+			/* Video ended and wasn't stopped by the user. */
+			gui->gapless = 1;
 		}
-		if (gui->fullscreenmode) {
+
+		if (gui->resident) {
+			/* All images and caches are still loaded. */
+			gui_resume_display(gui);
+		} else if (gui->fullscreenmode) {
 			/* Enable fullscreen again after video playback. */
 			SDL_WM_ToggleFullScreen(gui->screen);
 		}
@@ -3584,6 +4614,7 @@ static int playVideo(gui_t *gui, const char *videofile, gui_cat_t *cat, gui_elem
 			gui_elem_t *p;
 			int vidnr = 0;
 			const char *catPageToken;
+			const char *streamurl;
 
 			if (gui->selectedmenu != NULL) {
 				fprintf(fout, "SELECTEDMENU=\"%d\"\n", gui->selectedmenu->nr);
@@ -3663,6 +4694,14 @@ static int playVideo(gui_t *gui, const char *videofile, gui_cat_t *cat, gui_elem
 			/* Number of the first video when using VIDPAGETOKEN. */
 			fprintf(fout, "VIDNR=\"%d\"\n", vidnr);
 			fprintf(fout, "STATE=\"%d\"\n", cat->nextPageState);
+			streamurl = player_get_url(gui->player, elem->videoid);
+			if ((streamurl != NULL) && (strchr(streamurl, '\'') == NULL)) {
+				/* Already resolved while the video was selected. */
+				fprintf(fout, "STREAMURL='%s'\n", streamurl);
+				player_handover(gui->player, elem->videoid);
+			} else {
+				fprintf(fout, "STREAMURL=''\n");
+			}
 			if (elem->title != NULL) {
 				char *title;
 
@@ -3749,10 +4788,10 @@ void print_debug_cat(gui_t *gui, gui_cat_t *cat)
 static void set_description_for_subscriptions(gui_t *gui)
 {
 	if (gui->description_status != 1) {
-		gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Play playlist");
-		gui->circle_text = gui_printf(gui->descfont, gui->circle_text, "Main menu");
-		gui->square_text = gui_printf(gui->descfont, gui->square_text, "Show playlist");
-		gui->triangle_text = gui_printf(gui->descfont, gui->triangle_text, "Play playlist backwards");
+		gui->cross_text = gui_legend(gui, "Play playlist");
+		gui->circle_text = gui_legend(gui, "Main menu");
+		gui->square_text = gui_legend(gui, "Show playlist");
+		gui->triangle_text = gui_legend(gui, "Play playlist backwards");
 
 		gui->description_status = 1;
 	}
@@ -3761,121 +4800,450 @@ static void set_description_for_subscriptions(gui_t *gui)
 static void set_description_for_playlist(gui_t *gui)
 {
 	if (gui->description_status != 2) {
-		gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Play playlist");
-		gui->circle_text = gui_printf(gui->descfont, gui->circle_text, "Back");
-		gui->triangle_text = gui_printf(gui->descfont, gui->triangle_text, "Play playlist backwards");
+		gui->cross_text = gui_legend(gui, "Play playlist");
+		gui->circle_text = gui_legend(gui, "Back");
+		gui->triangle_text = gui_legend(gui, "Play playlist backwards");
 		gui->description_status = 2;
 	}
 }
 
 static void set_no_description(gui_t *gui)
 {
-	if (gui->cross_text != NULL) {
-		SDL_FreeSurface(gui->cross_text);
-		gui->cross_text = NULL;
-	}
-	if (gui->circle_text != NULL) {
-		SDL_FreeSurface(gui->circle_text);
-		gui->circle_text = NULL;
+	/* The descriptions stay in the legend cache. */
+	gui->cross_text = NULL;
+	gui->circle_text = NULL;
+	gui->square_text = NULL;
+	gui->triangle_text = NULL;
+	gui->description_status = 0;
+}
+
+static void set_description_continue(gui_t *gui)
+{
+	if (gui->description_status != 3) {
+		set_no_description(gui);
+		gui->cross_text = gui_legend(gui, "Continue");
+		gui->circle_text = gui_legend(gui, "Power Off");
+		gui->description_status = 3;
 	}
-	if (gui->square_text != NULL) {
-		SDL_FreeSurface(gui->square_text);
-		gui->square_text = NULL;
+}
+
+static void set_description_select(gui_t *gui)
+{
+	gui_menu_entry_t *entry;
+
+	if (gui->description_status != 3) {
+		set_no_description(gui);
+		gui->square_text = gui_legend(gui, "Power Off");
 	}
-	if (gui->triangle_text != NULL) {
-		SDL_FreeSurface(gui->triangle_text);
-		gui->triangle_text = NULL;
+	entry = gui->selectedmenu;
+	if (entry != NULL) {
+		switch (entry->state) {
+			case GUI_STATE_NEW_ACCESS_TOKEN:
+				gui->cross_text = gui_legend(gui, "New account");
+				break;
+
+			case GUI_STATE_LOAD_ACCESS_TOKEN:
+				gui->cross_text = gui_legend(gui, "Show account");
+				break;
+
+			case GUI_STATE_POWER_OFF:
+				gui->cross_text = gui_legend(gui, "Power Off");
+				break;
+
+			case GUI_STATE_QUIT:
+				gui->cross_text = gui_legend(gui, "Quit");
+				break;
+
+			case GUI_STATE_MENU_PLAYLIST:
+				gui->cross_text = gui_legend(gui, "Show playlist");
+				break;
+
+			case GUI_STATE_SEARCH:
+				gui->cross_text = gui_legend(gui, "Search");
+				break;
+
+			case GUI_STATE_UPDATE:
+				gui->cross_text = gui_legend(gui, "Update youtube-dl");
+				break;
+
+			default:
+				gui->cross_text = gui_legend(gui, "Select");
+				break;
+		}
+		switch (entry->state) {
+			case GUI_STATE_LOAD_ACCESS_TOKEN:
+				gui->triangle_text = gui_legend(gui, "Remove account");
+				break;
+
+			case GUI_STATE_MENU_PLAYLIST:
+				gui->triangle_text = gui_legend(gui, "Remove playlist");
+				break;
+
+			case GUI_STATE_SEARCH:
+				gui->triangle_text = gui_legend(gui, "Remove search");
+				break;
+
+			default:
+				gui->triangle_text = NULL;
+				break;
+		}
+	} else {
+		set_no_description(gui);
+		gui->square_text = gui_legend(gui, "Power Off");
 	}
-	gui->description_status = 0;
+	gui->description_status = 3;
 }
 
-static void set_description_continue(gui_t *gui)
+static void set_description_cancel(gui_t *gui)
 {
 	if (gui->description_status != 3) {
 		set_no_description(gui);
-		gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Continue");
-		gui->circle_text = gui_printf(gui->descfont, gui->circle_text, "Power Off");
+		gui->circle_text = gui_legend(gui, "Cancel");
 		gui->description_status = 3;
 	}
 }
 
-static void set_description_select(gui_t *gui)
+/** Get file name of the snapshot. */
+static char *gui_snapshot_filename(void)
+{
+	const char *home;
+	char *filename;
+	int ret;
+
+	home = getenv("HOME");
+	if (home == NULL) {
+		LOG_ERROR("Environment variable HOME is not set.\n");
+		return NULL;
+	}
+	ret = asprintf(&filename, "%s/%s.bin", home, SNAPSHOT_FILE);
+	if (ret == -1) {
+		LOG_ERROR("Out of memory\n");
+		return NULL;
+	}
+	return filename;
+}
+
+/** Check whether the thumbnail can be used directly as surface with the screen format. */
+static int gui_snapshot_image_ok(gui_t *gui, SDL_Surface *image)
+{
+	SDL_PixelFormat *fmt = gui->screen->format;
+
+	if ((image == NULL) || (image->flags & SDL_RLEACCEL)) {
+		return 0;
+	}
+	return (image->format->BitsPerPixel == fmt->BitsPerPixel)
+		&& (image->format->Rmask == fmt->Rmask)
+		&& (image->format->Gmask == fmt->Gmask)
+		&& (image->format->Bmask == fmt->Bmask);
+}
+
+static void gui_snapshot_put_elem(gui_t *gui, snapshot_t *snap, gui_elem_t *elem)
+{
+	snapshot_put_string(snap, elem->url);
+	snapshot_put_string(snap, elem->urlmedium);
+	snapshot_put_string(snap, elem->urlhigh);
+	snapshot_put_string(snap, elem->videoid);
+	snapshot_put_string(snap, elem->title);
+	snapshot_put_string(snap, elem->nextPageToken);
+	snapshot_put_string(snap, elem->prevPageToken);
+	snapshot_put_string(snap, elem->channelid);
+	snapshot_put_int(snap, elem->subnr);
+
+	/* Small thumbnail in screen format, so that it can be used without decoding. */
+	if (gui_snapshot_image_ok(gui, elem->image) && (SDL_LockSurface(elem->image) == 0)) {
+		snapshot_put_int(snap, elem->sizesmall);
+		snapshot_put_int(snap, elem->image->w);
+		snapshot_put_int(snap, elem->image->h);
+		snapshot_put_int(snap, elem->image->pitch);
+		snapshot_put_data(snap, elem->image->pixels, elem->image->pitch * elem->image->h);
+		SDL_UnlockSurface(elem->image);
+	} else {
+		snapshot_put_int(snap, QUALITY_DEFAULT);
+		snapshot_put_int(snap, 0);
+		snapshot_put_int(snap, 0);
+		snapshot_put_int(snap, 0);
+		snapshot_put_data(snap, NULL, 0);
+	}
+}
+
+static void gui_snapshot_put_cat(gui_t *gui, snapshot_t *snap, gui_cat_t *cat)
+{
+	gui_elem_t *elem;
+	int count = 0;
+	int current = 0;
+
+	snapshot_put_string(snap, cat->channelid);
+	snapshot_put_string(snap, cat->playlistid);
+	snapshot_put_string(snap, cat->searchterm);
+	snapshot_put_string(snap, cat->title);
+	snapshot_put_string(snap, cat->channelNextPageToken);
+	snapshot_put_string(snap, cat->channelPrevPageToken);
+	snapshot_put_string(snap, cat->favoritesNextPageToken);
+	snapshot_put_string(snap, cat->favoritesPrevPageToken);
+	snapshot_put_string(snap, cat->subscriptionNextPageToken);
+	snapshot_put_string(snap, cat->subscriptionPrevPageToken);
+	snapshot_put_int(snap, cat->channelNr);
+	snapshot_put_int(snap, cat->channelStart);
+	snapshot_put_int(snap, cat->favnr);
+	snapshot_put_int(snap, cat->subnr);
+	snapshot_put_int(snap, cat->nextPageState);
+	snapshot_put_int(snap, cat->prevPageState);
+
+	elem = cat->elem;
+	while (elem != NULL) {
+		if (elem == cat->current) {
+			current = count;
+		}
+		count++;
+		elem = elem->next;
+		if (elem == cat->elem) {
+			break;
+		}
+	}
+	snapshot_put_int(snap, count);
+	snapshot_put_int(snap, current);
+
+	elem = cat->elem;
+	while (elem != NULL) {
+		gui_snapshot_put_elem(gui, snap, elem);
+		elem = elem->next;
+		if (elem == cat->elem) {
+			break;
+		}
+	}
+}
+
+/**
+ * Save the loaded categories, videos and the selection, so that the next
+ * start of the navigator (after playing a video) can continue without
+ * loading everything again.
+ */
+static void gui_save_snapshot(gui_t *gui)
+{
+	snapshot_t *snap;
+	char *filename;
+	gui_cat_t *cat;
+	int count = 0;
+	int current = 0;
+	int prevcat = -1;
+
+	if ((gui->screen == NULL) || (gui->categories == NULL) || (gui->current == NULL) || (gui->selectedmenu == NULL)) {
+		return;
+	}
+	if ((gui->get_playlist_cat != NULL) || (gui->get_channel_cat != NULL)) {
+		/* Still loading, state is not complete. */
+		return;
+	}
+
+	filename = gui_snapshot_filename();
+	if (filename == NULL) {
+		return;
+	}
+	snap = snapshot_create(filename, SNAPSHOT_VERSION);
+	free(filename);
+	filename = NULL;
+	if (snap == NULL) {
+		return;
+	}
+
+	cat = gui->categories;
+	do {
+		if (cat == gui->current) {
+			current = count;
+		}
+		if (cat == gui->prev_cat) {
+			prevcat = count;
+		}
+		count++;
+		cat = cat->next;
+	} while ((cat != NULL) && (cat != gui->categories));
+
+	snapshot_put_int(snap, time(NULL));
+	snapshot_put_int(snap, gui->selectedmenu->nr);
+	snapshot_put_int(snap, gui->screen->format->BitsPerPixel);
+	snapshot_put_int(snap, count);
+	snapshot_put_int(snap, current);
+	/* Category to return to from the playlist view, -1 if not shown. */
+	snapshot_put_int(snap, prevcat);
+
+	cat = gui->categories;
+	do {
+		gui_snapshot_put_cat(gui, snap, cat);
+		cat = cat->next;
+	} while ((cat != NULL) && (cat != gui->categories));
+
+	if (snapshot_close(snap) != 0) {
+		LOG_ERROR("Failed to save snapshot.\n");
+	}
+}
+
+static void gui_snapshot_get_elem(gui_t *gui, snapshot_t *snap, gui_cat_t *cat, gui_page_t *page)
+{
+	SDL_PixelFormat *fmt = gui->screen->format;
+	gui_elem_t *elem;
+	void *pixels;
+	size_t len;
+	int size;
+	int w;
+	int h;
+	int pitch;
+
+	/* Append at end of list. */
+	elem = gui_elem_alloc(gui, cat, page, (cat->elem != NULL) ? cat->elem->prev : NULL, snapshot_get_string(snap));
+	if (elem == NULL) {
+		return;
+	}
+	elem->urlmedium = arena_strdup(page->arena, snapshot_get_string(snap));
+	elem->urlhigh = arena_strdup(page->arena, snapshot_get_string(snap));
+	elem->videoid = intern_get(gui->ids, snapshot_get_string(snap));
+	elem->title = arena_strdup(page->arena, snapshot_get_string(snap));
+	elem->nextPageToken = arena_strdup(page->arena, snapshot_get_string(snap));
+	elem->prevPageToken = arena_strdup(page->arena, snapshot_get_string(snap));
+	elem->channelid = intern_get(gui->ids, snapshot_get_string(snap));
+	elem->subnr = snapshot_get_int(snap);
+
+	size = snapshot_get_int(snap);
+	w = snapshot_get_int(snap);
+	h = snapshot_get_int(snap);
+	pitch = snapshot_get_int(snap);
+	pixels = snapshot_get_data(snap, &len);
+	if ((pixels != NULL) && (w > 0) && (h > 0) && (len >= (size_t) (pitch * h))) {
+		/* Pixels stay in the mapped file. */
+		elem->image = SDL_CreateRGBSurfaceFrom(pixels, w, h, fmt->BitsPerPixel, pitch,
+			fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+		if (elem->image != NULL) {
+			elem->loaded = IMG_LOADED;
+			if ((size >= QUALITY_DEFAULT) && (size <= QUALITY_HIGH)) {
+				elem->sizesmall = size;
+			}
+		}
+	}
+}
+
+static void gui_snapshot_get_cat(gui_t *gui, snapshot_t *snap)
+{
+	gui_cat_t *cat;
+	gui_elem_t *elem;
+	gui_page_t *page;
+	int count;
+	int current;
+	int i;
+
+	cat = gui_cat_alloc(gui, &gui->categories, NULL);
+	if (cat == NULL) {
+		return;
+	}
+	cat->channelid = intern_get(gui->ids, snapshot_get_string(snap));
+	cat->playlistid = intern_get(gui->ids, snapshot_get_string(snap));
+	cat->searchterm = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->title = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->channelNextPageToken = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->channelPrevPageToken = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->favoritesNextPageToken = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->favoritesPrevPageToken = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->subscriptionNextPageToken = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->subscriptionPrevPageToken = arena_strdup(cat->arena, snapshot_get_string(snap));
+	cat->channelNr = snapshot_get_int(snap);
+	cat->channelStart = snapshot_get_int(snap);
+	cat->favnr = snapshot_get_int(snap);
+	cat->subnr = snapshot_get_int(snap);
+	cat->nextPageState = snapshot_get_int(snap);
+	cat->prevPageState = snapshot_get_int(snap);
+
+	count = snapshot_get_int(snap);
+	current = snapshot_get_int(snap);
+	/* All restored videos of the category share one page. */
+	page = gui_page_alloc();
+	for (i = 0; (i < count) && !snapshot_error(snap); i++) {
+		gui_snapshot_get_elem(gui, snap, cat, page);
+	}
+	gui_page_release(page);
+	page = NULL;
+
+	elem = cat->elem;
+	for (i = 0; (i < current) && (elem != NULL); i++) {
+		elem = elem->next;
+	}
+	if (elem != NULL) {
+		cat->current = elem;
+	}
+}
+
+/**
+ * Restore the categories saved by gui_save_snapshot(). The snapshot is only
+ * used when it is recent and the selected video is the one which was played.
+ *
+ * @param menunr Number of the selected main menu entry.
+ * @param videoid Video which was played, NULL if unknown.
+ *
+ * @returns 1 when the categories were restored.
+ */
+static int gui_load_snapshot(gui_t *gui, int menunr, const char *videoid)
 {
-	gui_menu_entry_t *entry;
+	snapshot_t *snap;
+	char *filename;
+	time_t now;
+	time_t saved;
+	int count;
+	int current;
+	int prevcat;
+	int i;
 
-	if (gui->description_status != 3) {
-		set_no_description(gui);
-		gui->square_text = gui_printf(gui->descfont, gui->square_text, "Power Off");
+	filename = gui_snapshot_filename();
+	if (filename == NULL) {
+		return 0;
+	}
+	snap = snapshot_open(filename, SNAPSHOT_VERSION);
+	free(filename);
+	filename = NULL;
+	if (snap == NULL) {
+		return 0;
 	}
-	entry = gui->selectedmenu;
-	if (entry != NULL) {
-		switch (entry->state) {
-			case GUI_STATE_NEW_ACCESS_TOKEN:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "New account");
-				break;
-
-			case GUI_STATE_LOAD_ACCESS_TOKEN:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Show account");
-				break;
-
-			case GUI_STATE_POWER_OFF:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Power Off");
-				break;
-
-			case GUI_STATE_QUIT:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Quit");
-				break;
-
-			case GUI_STATE_MENU_PLAYLIST:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Show playlist");
-				break;
-
-			case GUI_STATE_SEARCH:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Search");
-				break;
-
-			case GUI_STATE_UPDATE:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Update youtube-dl");
-				break;
 
-			default:
-				gui->cross_text = gui_printf(gui->descfont, gui->cross_text, "Select");
-				break;
-		}
-		switch (entry->state) {
-			case GUI_STATE_LOAD_ACCESS_TOKEN:
-				gui->triangle_text = gui_printf(gui->descfont, gui->triangle_text, "Remove account");
-				break;
+	now = time(NULL);
+	saved = snapshot_get_int(snap);
+	if ((saved > now) || ((now - saved) > SNAPSHOT_MAX_AGE)) {
+		LOG("Snapshot is too old.\n");
+		snapshot_close(snap);
+		return 0;
+	}
+	if ((snapshot_get_int(snap) != menunr) || (snapshot_get_int(snap) != gui->screen->format->BitsPerPixel)) {
+		LOG("Snapshot is for another menu or screen.\n");
+		snapshot_close(snap);
+		return 0;
+	}
 
-			case GUI_STATE_MENU_PLAYLIST:
-				gui->triangle_text = gui_printf(gui->descfont, gui->triangle_text, "Remove playlist");
-				break;
+	count = snapshot_get_int(snap);
+	current = snapshot_get_int(snap);
+	prevcat = snapshot_get_int(snap);
+	for (i = 0; (i < count) && !snapshot_error(snap); i++) {
+		gui_snapshot_get_cat(gui, snap);
+	}
 
-			case GUI_STATE_SEARCH:
-				gui->triangle_text = gui_printf(gui->descfont, gui->triangle_text, "Remove search");
-				break;
+	gui->current = gui->categories;
+	for (i = 0; (i < current) && (gui->current != NULL); i++) {
+		gui->current = gui->current->next;
+	}
+	if (snapshot_error(snap) || (gui->current == NULL) || (gui->current->current == NULL)
+		|| ((videoid != NULL) && ((gui->current->current->videoid == NULL) || (gui->current->current->videoid != videoid)))) {
+		LOG("Snapshot doesn't match the last state.\n");
+		/* Free thumbnails before unmapping the pixels. */
+		gui_free_categories(gui);
+		snapshot_close(snap);
+		return 0;
+	}
 
-			default:
-				if (gui->triangle_text != NULL) {
-					SDL_FreeSurface(gui->triangle_text);
-					gui->triangle_text = NULL;
-				}
-				break;
+	gui->prev_cat = NULL;
+	if (prevcat >= 0) {
+		gui->prev_cat = gui->categories;
+		for (i = 0; (i < prevcat) && (gui->prev_cat != NULL); i++) {
+			gui->prev_cat = gui->prev_cat->next;
 		}
-	} else {
-		set_no_description(gui);
-		gui->square_text = gui_printf(gui->descfont, gui->square_text, "Power Off");
 	}
-	gui->description_status = 3;
-}
 
-static void set_description_cancel(gui_t *gui)
-{
-	if (gui->description_status != 3) {
-		set_no_description(gui);
-		gui->circle_text = gui_printf(gui->descfont, gui->circle_text, "Cancel");
-		gui->description_status = 3;
-	}
+	LOG("Restored %d categories from snapshot.\n", count);
+	gui->snapshot = snap;
+	return 1;
 }
 
 static void save_menu_state(gui_t *gui)
@@ -4010,10 +5378,224 @@ static void save_menu_state(gui_t *gui)
 	}
 }
 
+/**
+ * Check whether a point in time returned by SDL_GetTicks() is reached.
+ * Handles wrap around of the 32 bit millisecond counter.
+ */
+static int gui_ticks_passed(Uint32 now, Uint32 deadline)
+{
+	return ((Sint32) (now - deadline)) >= 0;
+}
+
+/** Count thumbnails of the visible categories which still need to be loaded. */
+static unsigned int gui_count_thumbnail_queue(gui_t *gui)
+{
+	unsigned int count = 0;
+	gui_cat_t *cat;
+	int i;
+
+	cat = gui->current;
+	for (i = 0; (cat != NULL) && (i < MAX_SHOW); i++) {
+		enum quality_size rowsize;
+		enum quality_size selsize;
+		gui_elem_t *elem;
+		int j;
+
+		gui_thumb_sizes(gui, (cat == gui->current), &rowsize, &selsize);
+		elem = cat->current;
+		for (j = 0; (elem != NULL) && (j < MAX_VIDS); j++) {
+			int medium;
+
+			medium = (cat == gui->current) && (elem == cat->current) && (elem->urlmedium != NULL) && (selsize > QUALITY_DEFAULT);
+			if (gui_elem_thumb_needed(elem, medium, medium ? selsize : rowsize)) {
+				count++;
+			}
+			elem = elem->next;
+			if ((elem == cat->elem) || (elem == cat->current)) {
+				break;
+			}
+		}
+		cat = cat->next;
+		if ((cat == gui->categories) || (cat == gui->current)) {
+			break;
+		}
+	}
+	return count;
+}
+
+/**
+ * Check whether the selected video of the category shows its loaded
+ * thumbnail, not "No Thumbnail" or the small one while the medium one loads.
+ */
+static int gui_current_thumb_loaded(gui_cat_t *cat)
+{
+	gui_elem_t *elem;
+
+	if ((cat == NULL) || (cat->current == NULL)) {
+		return 0;
+	}
+	elem = cat->current;
+	if (elem->urlmedium != NULL) {
+		/* Selected video is shown with the medium size. */
+		return (elem->imagemedium != NULL) && (elem->loadedmedium == IMG_LOADED);
+	}
+	return (elem->image != NULL) && (elem->loaded == IMG_LOADED);
+}
+
+/** Get memory used by the pixels of all loaded thumbnails. */
+static unsigned long gui_count_surface_bytes(gui_t *gui)
+{
+	unsigned long bytes = 0;
+	gui_cat_t *cat;
+
+	cat = gui->categories;
+	while (cat != NULL) {
+		gui_elem_t *elem;
+
+		elem = cat->elem;
+		while (elem != NULL) {
+			/* Other images are "No Thumbnail" texts from the text cache. */
+			if ((elem->image != NULL) && (elem->loaded == IMG_LOADED)) {
+				bytes += elem->image->pitch * elem->image->h;
+			}
+			if ((elem->imagemedium != NULL) && (elem->loadedmedium == IMG_LOADED)) {
+				bytes += elem->imagemedium->pitch * elem->imagemedium->h;
+			}
+			elem = elem->next;
+			if (elem == cat->elem) {
+				break;
+			}
+		}
+		cat = cat->next;
+		if (cat == gui->categories) {
+			break;
+		}
+	}
+	return bytes;
+}
+
+/** Give the memory used by thumbnails and texts to the quality policy once per interval. */
+static void gui_update_memory(gui_t *gui, Uint32 now)
+{
+	unsigned int hits;
+	unsigned int misses;
+	size_t size;
+
+	if ((gui->memorytime != 0) && !gui_ticks_passed(now, gui->memorytime + METRICS_INTERVAL)) {
+		return;
+	}
+	textcache_get_stats(gui->textcache, &hits, &misses, &size);
+	quality_set_memory(gui->quality, gui_count_surface_bytes(gui) + size);
+	gui->memorytime = now;
+}
+
+/**
+ * Add the times of a frame to the performance counters. The counters are
+ * shown and written once per interval.
+ *
+ * @param worktime Time in milliseconds used by the frame without sleeping.
+ */
+static void gui_sample_frame(gui_t *gui, Uint32 worktime, Uint32 now)
+{
+	metrics_sample_t *next = &gui->next;
+	unsigned int hits;
+	unsigned int misses;
+	size_t size;
+
+	next->frames++;
+	gui->framesum += worktime;
+	if (next->framemax < worktime) {
+		next->framemax = worktime;
+	}
+	gui->paintsum += gui->painttime;
+	if (next->paintmax < gui->painttime) {
+		next->paintmax = gui->painttime;
+	}
+	if (gui->sampletime == 0) {
+		gui->sampletime = now;
+	}
+	if (!gui_ticks_passed(now, gui->sampletime + METRICS_INTERVAL)) {
+		return;
+	}
+
+	next->frameavg = gui->framesum / next->frames;
+	next->paintavg = gui->paintsum / next->frames;
+	next->inflight = player_pending(gui->player);
+	next->thumbqueue = gui_count_thumbnail_queue(gui);
+	textcache_get_stats(gui->textcache, &hits, &misses, &size);
+	next->texthits = hits - gui->texthits;
+	next->textmisses = misses - gui->textmisses;
+	gui->texthits = hits;
+	gui->textmisses = misses;
+	next->surfacebytes = gui_count_surface_bytes(gui) + size;
+	gui_get_transfer_stats(gui, &next->requests, &next->bytes);
+
+	gui->sample = *next;
+	if (gui->metrics != NULL) {
+		metrics_write(gui->metrics, &gui->sample, now);
+	}
+
+	memset(next, 0, sizeof(*next));
+	gui->framesum = 0;
+	gui->paintsum = 0;
+	gui->sampletime = now;
+}
+
+/**
+ * Show each state of the state machine as span in the trace.
+ *
+ * @param tracedstate State of the open span, -1 if none.
+ */
+static void gui_trace_state(int *tracedstate, enum gui_state state)
+{
+	if (*tracedstate != (int) state) {
+		if (*tracedstate >= 0) {
+			JT_TRACE_END("state", get_state_text(*tracedstate));
+		}
+		JT_TRACE_BEGIN("state", get_state_text(state), NULL);
+		*tracedstate = state;
+	}
+}
+
+/**
+ * Sleep until an event is pending or the timeout expired. The event is not
+ * removed from the event queue.
+ *
+ * @param timeout Maximum time to sleep in milliseconds.
+ */
+static void gui_wait_event(Uint32 timeout)
+{
+	Uint32 start;
+
+	start = SDL_GetTicks();
+	while(1) {
+		SDL_Event event;
+		Uint32 elapsed;
+
+		SDL_PumpEvents();
+		if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0) {
+			break;
+		}
+		elapsed = SDL_GetTicks() - start;
+		if (elapsed >= timeout) {
+			break;
+		}
+		if ((timeout - elapsed) < EVENT_POLL_TIME) {
+			SDL_Delay(timeout - elapsed);
+		} else {
+			SDL_Delay(EVENT_POLL_TIME);
+		}
+	}
+}
+
 /**
  * Main loop for GUI.
+ *
+ * @param timer Power off after this time in milliseconds without user input.
+ *              0 disables the timeout.
+ * @param videoformat youtube-dl video format used for resolving stream URLs.
  */
-int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, const char *channelid, const char *searchterm, const char *playlistid, const char *catpagetoken, const char *videoid, int catnr, int channelnr, const char *videopagetoken, int vidnr, int menunr, int timer)
+int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, const char *channelid, const char *searchterm, const char *playlistid, const char *catpagetoken, const char *videoid, int catnr, int channelnr, const char *videopagetoken, int vidnr, int menunr, int timer, int videoformat)
 {
 	int done;
 	SDL_Event event;
@@ -4024,15 +5606,20 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 	enum gui_state nextstate;
 	enum gui_state afterplayliststate;
 	enum gui_state aftersearchplayliststate;
-	unsigned int wakeupcount;
-	unsigned int sleeptime = 50 * 3;
+	Uint32 wakeuptime;
+	Uint32 sleeptime = TOKEN_POLL_TIME;
+	Uint32 frametime;
+	Uint32 lastinput;
 	int rv;
 	int foundvid = 0;
 	const char *lastcatpagetoken;
-	int timeoutcounter = 0;
 	char *oldstatusmsg = NULL;
 	char searchstring[80];
 	unsigned int searchpos;
+	gui_elem_t *hoverelem = NULL;
+	Uint32 hovertime = 0;
+	int prefetchurl;
+	int tracedstate = -1;
 
 	searchstring[0] = 0;
 	searchpos = 0;
@@ -4045,9 +5632,25 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 	getstate = origgetstate;
 	LOG("videopagetoken %s at startup\n", videopagetoken);
 
+	/* IDs of the categories and videos are interned and compared by pointer. */
+	channelid = intern_get(gui->ids, channelid);
+	playlistid = intern_get(gui->ids, playlistid);
+	videoid = intern_get(gui->ids, videoid);
+
+	/* The user agent is only needed when playing here, otherwise youtubeplayer.sh plays. */
+	gui->player = player_alloc(videoformat, (videofile == NULL));
+	if (gui->player == NULL) {
+		LOG_ERROR("Out of memory.\n");
+		return retval;
+	}
+	/* youtubeplayer.sh only uses STREAMURL when it gets the URL with youtube-dl itself. */
+	prefetchurl = (videofile == NULL) || (getenv("NAVIGATOR_STREAMURL") != NULL);
+
 	lastcatpagetoken = catpagetoken;
 	done = 0;
-	wakeupcount = 5;
+	frametime = SDL_GetTicks();
+	lastinput = frametime;
+	wakeuptime = frametime + 5 * FRAME_TIME;
 	rv = JT_OK;
 	state = GUI_STATE_STARTUP;
 	afterplayliststate = GUI_STATE_RUNNING;
@@ -4055,17 +5658,27 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 	prevstate = state;
 	if (getstate == 0) {
 		gui->statusmsg = buf_printf(gui->statusmsg, "Juhutube\n© Jürgen Urban");
-		wakeupcount = DEFAULT_SLEEP / 2;
+		wakeuptime = frametime + DEFAULT_SLEEP / 2;
 	}
 	while(!done) {
 		enum gui_state curstate;
+		int idle;
 
 		if (state != prevstate) {
 			LOG("Enter new state %d %s\n", state, get_state_text(state));
 			prevstate = state;
 		}
+		gui_trace_state(&tracedstate, state);
 
-		curstate = (wakeupcount <= 0) ? state : GUI_STATE_SLEEP;
+		frametime = SDL_GetTicks();
+		gui->prefetching = 0;
+		player_poll(gui->player);
+		transfer_poll(gui->transfer);
+		if ((gui->bench != NULL) && bench_run(gui->bench, frametime)) {
+			/* Benchmark script finished. */
+			done = 1;
+		}
+		curstate = gui_ticks_passed(frametime, wakeuptime) ? state : GUI_STATE_SLEEP;
 
 		if (curstate == GUI_STATE_RUNNING) {
 			/* No operation is pending. */
@@ -4154,7 +5767,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				case SDL_KEYDOWN:
 					retval = 0;
 					/* Reset timeout on key press. */
-					timeoutcounter = 0;
+					lastinput = SDL_GetTicks();
 					if (state == GUI_STATE_TIMEOUT) {
 						/* restore previous state. */
 						state = restorestate;
@@ -4163,11 +5776,11 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 							gui->statusmsg = NULL;
 						}
 						gui->statusmsg = oldstatusmsg;
-						wakeupcount = 0;
+						wakeuptime = SDL_GetTicks();
 					}
 
 					/* Don't wait when a key is pressed. */
-					wakeupcount = 0;
+					wakeuptime = SDL_GetTicks();
 					/* Key pressed on keyboard. */
 					switch(key) {
 						case BTN_SELECT:
@@ -4180,8 +5793,8 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 										gui_menu_entry_t *entry;
 
 										entry = gui_menu_entry_alloc(gui, &gui->mainmenu, NULL, cat->title, GUI_STATE_MENU_PLAYLIST, GUI_STATE_GET_PLAYLIST);
-										entry->playlistid = jt_strdup(cat->playlistid);
-										entry->channelid = jt_strdup(cat->channelid);
+										entry->playlistid = cat->playlistid;
+										entry->channelid = cat->channelid;
 										entry->tokennr = gui->selectedmenu->tokennr;
 									}
 									if (cat->searchterm != NULL) {
@@ -4254,10 +5867,21 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 									if (elem != NULL) {
 										if (elem->videoid != NULL) {
 											int ret = 1;
+											int direction;
 
 											set_no_description(gui);
 
-											ret = playVideo(gui, videofile, cat, elem, 0, 4096, lastcatpagetoken);
+											if (key == BTN_START) {
+												/* Play current video only. */
+												direction = 0;
+											} else if (key == BTN_CROSS) {
+												direction = 1;
+											} else {
+												direction = -1;
+											}
+											ret = playVideo(gui, videofile, cat, elem, direction, 4096, lastcatpagetoken);
+											/* Watching a video counts as activity for the power off timer. */
+											lastinput = SDL_GetTicks();
 											if ((videofile != NULL) && (ret == 0)) {
 												/* Terminate program, another program needs to use the videofile
 												 * to play the video.
@@ -4378,7 +6002,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 									/* Back to main menu. */
 									nextstate = GUI_STATE_MAIN_MENU;
 									state = GUI_RESET_STATE;
-									wakeupcount = 0;
+									wakeuptime = SDL_GetTicks();
 									gui_free_categories(gui);
 								}
 								break;
@@ -4502,7 +6126,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 									cat = gui->current;
 									if (cat != NULL) {
 										if ((cat == gui->categories) || (cat->prev == NULL) || (cat->prevPageState != cat->prev->prevPageState)) {
-											char *prevPageToken;
+											const char *prevPageToken;
 
 											prevPageToken = gui_get_prevPageToken(cat);
 
@@ -4540,7 +6164,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 									cat = gui->current;
 									if (cat != NULL) {
 										if ((cat->next == NULL) || (cat->next == gui->categories) || (cat->nextPageState != cat->next->nextPageState)) {
-											char *nextPageToken;
+											const char *nextPageToken;
 	
 											nextPageToken = gui_get_nextPageToken(cat);
 
@@ -4562,7 +6186,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 										cat = gui->current;
 										/* Check if next page can be preloaded: */
 										if ((state == GUI_STATE_RUNNING) && (cat != NULL) && ((cat->next == NULL) || (cat->next == gui->categories) || (cat->nextPageState != cat->next->nextPageState))) {
-											char *nextPageToken;
+											const char *nextPageToken;
 	
 											nextPageToken = gui_get_nextPageToken(cat);
 
@@ -4577,7 +6201,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 										cat = gui->current;
 										/* Check if previous page can be preloaded: */
 										if ((state == GUI_STATE_RUNNING) && (cat != NULL) && ((cat == gui->categories) || (cat->prev == NULL) || (cat->prevPageState != cat->prev->prevPageState))) {
-											char *prevPageToken;
+											const char *prevPageToken;
 
 											prevPageToken = gui_get_prevPageToken(cat);
 
@@ -4810,13 +6434,10 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 			LOG("Enter new state %d %s (triggered by user).\n", state, get_state_text(state));
 			prevstate = state;
 		}
-
-		if (wakeupcount > 0) {
-			wakeupcount--;
-		}
+		gui_trace_state(&tracedstate, state);
 
 		/* GUI state machine. */
-		curstate = (wakeupcount <= 0) ? state : GUI_STATE_SLEEP;
+		curstate = gui_ticks_passed(SDL_GetTicks(), wakeuptime) ? state : GUI_STATE_SLEEP;
 		switch(curstate) {
 			case GUI_STATE_SLEEP:
 				if (state != GUI_STATE_GET_TOKEN) {
@@ -4847,6 +6468,11 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 							if (state == GUI_STATE_SEARCH_ENTER) {
 								state = GUI_STATE_SEARCH;
 							}
+							if ((getstate != 0) && gui_load_snapshot(gui, menunr, videoid)) {
+								/* Categories are restored, only the access token is needed. */
+								gui->resumed = 1;
+								state = GUI_STATE_LOAD_ACCESS_TOKEN;
+							}
 						}
 						menunr = 0;
 					}
@@ -4860,9 +6486,11 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				}
 				set_description_select(gui);
 				if (gui->at != NULL) {
-					jt_free(gui->at);
-					gui->at = NULL;
+					const char **ids[] = { &channelid, &playlistid, &videoid };
+
+					gui_free_token(gui);
 					gui_free_categories(gui);
+					gui_renew_ids(gui, ids, sizeof(ids) / sizeof(ids[0]));
 				}
 				break;
 
@@ -4876,7 +6504,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				if (nr < 0) {
 					gui->statusmsg = buf_printf(gui->statusmsg, "Too many YouTube accounts. Please remove one first.");
 					/* Retry */
-					wakeupcount = DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 					state = GUI_STATE_MAIN_MENU;
 					break;
 				}
@@ -4910,7 +6538,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				if (entry == NULL) {
 					gui->statusmsg = buf_printf(gui->statusmsg, "Failed to allocate menu entry.");
 					/* Retry */
-					wakeupcount = DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 					nextstate = GUI_STATE_MAIN_MENU;
 					state = GUI_RESET_STATE;
 					break;
@@ -4922,19 +6550,24 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 
 			case GUI_STATE_LOAD_ACCESS_TOKEN:
 				if (gui->at != NULL) {
-					jt_free(gui->at);
-					gui->at = NULL;
+					gui_free_token(gui);
 					gui_free_categories(gui);
 				}
 				gui->at = alloc_token(gui->selectedmenu->tokennr);
 				if (gui->at == NULL) {
 					gui->statusmsg = buf_printf(gui->statusmsg, "Failed to allocate token.");
 					/* Retry */
-					wakeupcount = DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 					nextstate = GUI_STATE_MAIN_MENU;
 					state = GUI_RESET_STATE;
 					break;
 				}
+				jt_set_cancel(gui->at, &gui->cancel);
+				jt_set_progress(gui->at, gui_jt_progress, gui);
+				/* Scrolling back to a page shouldn't cost quota again. */
+				jt_set_coalesce_time(gui->at, COALESCE_TIME);
+				/* Use the connections made at startup. */
+				jt_set_share(gui->at, transfer_get_share(gui->transfer));
 				/* Try to load existing access for YouTube user account. */
 				rv = jt_load_token(gui->at);
 				if (rv == JT_OK) {
@@ -4962,7 +6595,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 						jt_get_user_code(gui->at),
 						jt_get_verification_url(gui->at));
 					state = GUI_STATE_GET_TOKEN;
-					wakeupcount = sleeptime;
+					wakeuptime = SDL_GetTicks() + sleeptime;
 				} else {
 					state = GUI_STATE_ERROR;
 					nextstate = GUI_STATE_GET_USER_CODE;
@@ -4988,19 +6621,19 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 
 					case JT_AUTH_PENDING:
 						/* Need to wait longer. */
-						wakeupcount = sleeptime;
+						wakeuptime = SDL_GetTicks() + sleeptime;
 						break;
 	
 					case JT_SLOW_DOWN:
 						/* Need to poll slower. */
-						sleeptime += 25;
-						wakeupcount = sleeptime;
+						sleeptime += TOKEN_POLL_SLOW_DOWN;
+						wakeuptime = SDL_GetTicks() + sleeptime;
 						break;
 
 					case JT_CODE_EXPIRED:
 						gui->statusmsg = buf_printf(gui->statusmsg, "Expired");
 						/* Retry */
-						wakeupcount = DEFAULT_SLEEP;
+						wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 						state = GUI_STATE_GET_USER_CODE;
 						break;
 	
@@ -5031,7 +6664,12 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 #if 0 /* GUI_STATE_GET_FAVORITES is already included in GUI_STATE_GET_MY_CHANNELS. */
 				state = GUI_STATE_GET_FAVORITES;
 #else
-				if ((gui->selectedmenu != NULL)) {
+				if (gui->resumed) {
+					/* Continue with the state restored from the snapshot. */
+					gui->resumed = 0;
+					foundvid = 1;
+					state = GUI_STATE_RUNNING;
+				} else if ((gui->selectedmenu != NULL)) {
 					state = gui->selectedmenu->initstate;
 				} else {
 					state = GUI_STATE_GET_MY_CHANNELS;
@@ -5156,7 +6794,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 								while(cat != NULL) {
 									LOG("in playlist %s %s\n", cat->playlistid, cat->title);
 									if ((cat->nextPageState == ((enum gui_state) getstate)) && (cat->playlistid != NULL)
-										&& (playlistid != NULL) && (strcmp(cat->playlistid, playlistid) == 0)) {
+										&& (playlistid != NULL) && (cat->playlistid == playlistid)) {
 										/* Select current category which was specified by the parameter catnr. */
 										gui->current = cat;
 										LOG("Found playlist %s %s\n", cat->playlistid, cat->title);
@@ -5168,7 +6806,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 									}
 								}
 								if ((cat != NULL) && (cat->nextPageState == ((enum gui_state) getstate)) && (cat->playlistid != NULL)
-									&& (playlistid != NULL) && (strcmp(cat->playlistid, playlistid) == 0)) {
+									&& (playlistid != NULL) && (cat->playlistid == playlistid)) {
 									/* Try to find video selected by parameter videoid. */
 									gui_elem_t *elem;
 
@@ -5177,7 +6815,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 									elem = cat->elem;
 									while(elem != NULL) {
 										LOG("in video id %s\n", elem->videoid);
-										if ((elem->videoid != NULL) && (strcmp(elem->videoid, videoid) == 0)) {
+										if ((elem->videoid != NULL) && (elem->videoid == videoid)) {
 											/* Found video, so select it. */
 											cat->current = elem;
 											/* Next video can be selected if user selected to play playlist. */
@@ -5214,7 +6852,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 					} else {
 						gui->statusmsg = buf_printf(gui->statusmsg, "No playlist id");
 						LOG_ERROR("GUI_STATE_GET_PLAYLIST: No playlist id in cat %s.\n", CHECKSTR(gui->cur_cat->title));
-						wakeupcount = DEFAULT_SLEEP;
+						wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 						if (gui->get_playlist_cat == NULL) {
 							state = afterplayliststate;
 						}
@@ -5222,7 +6860,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				} else {
 					LOG_ERROR("GUI_STATE_GET_PLAYLIST: No categories allocated.\n");
 					gui->statusmsg = buf_printf(gui->statusmsg, "No categories allocated");
-					wakeupcount = DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 					state = afterplayliststate;
 				}
 				gui->cur_cat = NULL;
@@ -5235,12 +6873,12 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 					} else {
 						gui->statusmsg = buf_printf(gui->statusmsg, "No playlist id");
 						LOG_ERROR("GUI_STATE_GET_PREV_PLAYLIST: No playlist id in cat %s.\n", gui->cur_cat->title);
-						wakeupcount = DEFAULT_SLEEP;
+						wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 					}
 				} else {
 					LOG_ERROR("GUI_STATE_GET_PREV_PLAYLIST: No categories allocated.\n");
 					gui->statusmsg = buf_printf(gui->statusmsg, "No categories allocated");
-					wakeupcount = DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 				}
 				state = afterplayliststate;
 				gui->cur_cat = NULL;
@@ -5276,80 +6914,35 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 			}
 
 			case GUI_STATE_GET_CHANNELS:
-				if ((gui->cur_cat != NULL) || (gui->get_channel_cat != NULL)) {
-					gui_cat_t *last = NULL;
-					if (gui->cur_cat == NULL) {
-						gui->cur_cat = gui->get_channel_cat;
-						if (gui->get_channel_cat->next != gui->get_channel_cat) {
-							/* Remove it from the gui->get_channel_cat list. */
-							gui->get_channel_cat = gui->get_channel_cat->next;
-							gui->get_channel_cat->prev = gui->get_channel_cat->prev->prev;
-							gui->get_channel_cat->prev->next = gui->get_channel_cat;
-						} else {
-							/* List is now empty. */
-							gui->get_channel_cat = NULL;
-						}
-
-						/* Insert in list for GUI_STATE_GET_PLAYLIST: */
-						if (gui->get_playlist_cat == NULL) {
-							/* First element added. */
-							gui->get_playlist_cat = gui->cur_cat;
-							gui->cur_cat->next = gui->cur_cat;
-							gui->cur_cat->prev = gui->cur_cat;
-						} else {
-							gui_cat_t *l;
-
-							/* Add at the end of the list. */
-							l = gui->get_playlist_cat->prev;
-
-							/* Add as new last: */
-							gui->cur_cat->next = gui->get_playlist_cat;
-							gui->cur_cat->prev = l;
-
-							gui->get_playlist_cat->prev = gui->cur_cat;
-							l->next = gui->cur_cat;
-						}
-					}
-					rv = update_channels(gui, gui->cur_cat, &last);
-					if (rv == JT_OK) {
-						if ((last == NULL) || (last->channelNextPageToken == NULL)) {
-							if (gui->get_channel_cat == NULL) {
-								if (gui->get_playlist_cat == NULL) {
-									state = GUI_STATE_RUNNING;
-									wakeupcount = DEFAULT_SLEEP;
-									gui->statusmsg = buf_printf(gui->statusmsg, "Failed update_channels() for cat %s.", (gui->cur_cat != NULL) ? CHECKSTR(gui->cur_cat->title) : "(null)");
-									LOG_ERROR("Failed update_channels() for cat %s.\n", (gui->cur_cat != NULL) ? gui->cur_cat->title : "(null)");
-								} else {
-									state = GUI_STATE_GET_PLAYLIST;
-									if (catpagetoken != NULL) {
-										switch(getstate) {
-											case GUI_STATE_GET_CHANNEL_PLAYLIST:
-												/* Load selected category (was selected before restart). */
-												afterplayliststate = getstate;
-												/* Use current to return from playlist. */
-												gui->prev_cat = gui->current;
-												break;
-											default:
-												afterplayliststate = GUI_STATE_RUNNING;
-												break;
-										}
-									} else {
-										afterplayliststate = GUI_STATE_RUNNING;
-									}
-								}
-							}
-						}
-					} else {
+				if (gui->get_channel_cat != NULL) {
+					/* Stay in this state until all channels are looked up. */
+					rv = update_channels(gui);
+					if (rv != JT_OK) {
+						/* The failed categories are shown without videos. */
 						nextstate = state;
 						state = GUI_STATE_ERROR;
-						if (gui->get_channel_cat == NULL) {
-							nextstate = GUI_STATE_RUNNING;
+					}
+				} else if (gui->get_playlist_cat != NULL) {
+					state = GUI_STATE_GET_PLAYLIST;
+					if (catpagetoken != NULL) {
+						switch(getstate) {
+							case GUI_STATE_GET_CHANNEL_PLAYLIST:
+								/* Load selected category (was selected before restart). */
+								afterplayliststate = getstate;
+								/* Use current to return from playlist. */
+								gui->prev_cat = gui->current;
+								break;
+							default:
+								afterplayliststate = GUI_STATE_RUNNING;
+								break;
 						}
+					} else {
+						afterplayliststate = GUI_STATE_RUNNING;
 					}
 				} else {
 					gui->statusmsg = buf_printf(gui->statusmsg, "No category allocated for channels");
 					LOG_ERROR("GUI_STATE_GET_CHANNELS: No category allocated for channels.\n");
-					wakeupcount = DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 					state = GUI_STATE_RUNNING;
 				}
 				gui->cur_cat = NULL;
@@ -5384,7 +6977,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				if (rv == JT_OK) {
 					if (gui->get_playlist_cat == NULL) {
 						state = GUI_STATE_RUNNING;
-						wakeupcount = DEFAULT_SLEEP;
+						wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 						gui->statusmsg = buf_printf(gui->statusmsg, "No playlists for cat %s.", (gui->cur_cat != NULL) ? CHECKSTR(gui->cur_cat->title) : "(null)");
 						LOG_ERROR("No playlists for %s.\n", (gui->cur_cat != NULL) ? CHECKSTR(gui->cur_cat->title) : "(null)");
 					} else {
@@ -5437,7 +7030,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 							elem = cat->elem;
 							while(elem != NULL) {
 								LOG("in video id %s\n", elem->videoid);
-								if ((elem->videoid != NULL) && (strcmp(elem->videoid, videoid) == 0)) {
+								if ((elem->videoid != NULL) && (elem->videoid == videoid)) {
 									/* Found video, so select it. */
 									cat->current = elem;
 									/* Next video can be selected if user selected to play playlist. */
@@ -5491,6 +7084,8 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 
 				/* No operation is pending. */
 				gui->cur_cat = NULL;
+				gui->prefetchpage = 0;
+				gui->cancel = 0;
 				if (gui->statusmsg != NULL) {
 					free(gui->statusmsg);
 					gui->statusmsg = NULL;
@@ -5502,7 +7097,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 
 					/* Check if previous page can be preloaded when nothing is to do. */
 					if ((state == GUI_STATE_RUNNING) && (cat != NULL) && ((cat == gui->categories) || (cat->prev == NULL) || (cat->prevPageState != cat->prev->prevPageState))) {
-						char *prevPageToken;
+						const char *prevPageToken;
 
 						prevPageToken = gui_get_prevPageToken(cat);
 
@@ -5515,7 +7110,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 					cat = gui->current;
 					/* Check if next page can be preloaded when nothing is to do: */
 					if ((state == GUI_STATE_RUNNING) && (cat != NULL) && ((cat->next == NULL) || (cat->next == gui->categories) || (cat->nextPageState != cat->next->nextPageState))) {
-						char *nextPageToken;
+						const char *nextPageToken;
 	
 						nextPageToken = gui_get_nextPageToken(cat);
 
@@ -5552,7 +7147,8 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 								gui_inc_elem(gui);
 							}
 							if (elem != cat->current) {
-								wakeupcount = DEFAULT_SLEEP;
+								/* Pause to let the user stop the playlist, unless the next video is already buffered. */
+								wakeuptime = SDL_GetTicks() + (gui->gapless ? 0 : DEFAULT_SLEEP);
 								state = GUI_STATE_PLAY_VIDEO;
 							}
 						}
@@ -5585,11 +7181,50 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 								gui_dec_elem(gui);
 							}
 							if (elem != cat->current) {
-								wakeupcount = DEFAULT_SLEEP;
+								wakeuptime = SDL_GetTicks() + (gui->gapless ? 0 : DEFAULT_SLEEP);
 								state = GUI_STATE_PLAY_PREV_VIDEO;
 							}
 						}
 					}
+
+					/* Resolve stream URL of the selected video, so that playing starts without delay. */
+					cat = gui->current;
+					if ((state == GUI_STATE_RUNNING) && (cat != NULL) && (cat->current != NULL)) {
+						if (cat->current != hoverelem) {
+							hoverelem = cat->current;
+							hovertime = SDL_GetTicks();
+						} else if ((hovertime != 0) && gui_ticks_passed(SDL_GetTicks(), hovertime + PLAYER_HOVER_TIME)) {
+							if (prefetchurl && (hoverelem->videoid != NULL)) {
+								player_prefetch(gui->player, hoverelem->videoid);
+							}
+							hovertime = 0;
+						}
+					}
+
+					/* Load categories and thumbnails ahead in navigation direction when nothing is to do. */
+					if ((state == GUI_STATE_RUNNING) && (retval == 0) && gui_prefetch_allowed(gui)) {
+						int k;
+
+						k = gui_prefetch_distance(gui);
+						if (gui_ticks_passed(SDL_GetTicks(), gui->prefetchtime + PREFETCH_INTERVAL)) {
+							cat = gui_prefetch_find_page(gui, k);
+							if (cat != NULL) {
+								LOG("Prefetch page after %s (distance %d).\n", CHECKSTR(cat->title), k);
+								gui->prefetchtime = SDL_GetTicks();
+								if (gui->navdir > 0) {
+									state = cat->nextPageState;
+								} else {
+									state = cat->prevPageState;
+								}
+								gui->cur_cat = cat;
+								gui->prefetchpage = 1;
+								lastcatpagetoken = NULL;
+							}
+						}
+						if (state == GUI_STATE_RUNNING) {
+							gui->prefetching = gui_prefetch_thumbnail(gui, k);
+						}
+					}
 				}
 				break;
 
@@ -5606,7 +7241,9 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 						int ret;
 
 						/* Play next video. */
-						ret = playVideo(gui, videofile, cat, elem, 0, 4096, lastcatpagetoken);
+						ret = playVideo(gui, videofile, cat, elem, (state == GUI_STATE_PLAY_PREV_VIDEO) ? -1 : 1, 4096, lastcatpagetoken);
+						/* Watching a video counts as activity for the power off timer. */
+						lastinput = SDL_GetTicks();
 						if ((videofile != NULL) && (ret == 0)) {
 							/* Terminate program, another program needs to use the videofile
 							 * to play the video.
@@ -5637,7 +7274,18 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 
 				/* Some error happened, the error code is stored in rv. */
 
+				if (rv == JT_CANCELLED) {
+					/* The user did something else, nothing to report. */
+					LOG("Request cancelled.\n");
+					state = GUI_STATE_RUNNING;
+					break;
+				}
 				switch(rv) {
+					case JT_TIMEOUT:
+						gui->statusmsg = buf_printf(gui->statusmsg, "Server doesn't respond.");
+						LOG_ERROR("Server doesn't respond.\n");
+						break;
+
 					case JT_PROTOCOL_ERROR:
 						error = jt_get_error_description(gui->at);
 						if (error != NULL) {
@@ -5702,14 +7350,14 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 			case GUI_STATE_GET_MY_PREV_CHANNELS:
 				gui->statusmsg = buf_printf(gui->statusmsg, "GUI_STATE_GET_MY_PREV_CHANNELS shouldn't be entered.");
 				/* Just go on: */
-				wakeupcount = DEFAULT_SLEEP;
+				wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 				state = GUI_STATE_RUNNING;
 				break;
 
 			case GUI_STATE_GET_PREV_CHANNELS:
 				gui->statusmsg = buf_printf(gui->statusmsg, "GUI_STATE_GET_PREV_CHANNELS shouldn't be entered.");
 				/* Just go on: */
-				wakeupcount = DEFAULT_SLEEP;
+				wakeuptime = SDL_GetTicks() + DEFAULT_SLEEP;
 				state = GUI_STATE_RUNNING;
 				break;
 
@@ -5736,9 +7384,9 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				cat = gui_cat_alloc(gui, &gui->categories, NULL);
 				cat->nextPageState = GUI_STATE_MENU_PLAYLIST;
 				cat->prevPageState = GUI_STATE_MENU_PLAYLIST;
-				cat->playlistid = jt_strdup(gui->selectedmenu->playlistid);
-				cat->channelid = jt_strdup(gui->selectedmenu->channelid);
-		 		cat->title = jt_strdup(gui->selectedmenu->title);
+				cat->playlistid = gui->selectedmenu->playlistid;
+				cat->channelid = gui->selectedmenu->channelid;
+		 		cat->title = arena_strdup(cat->arena, gui->selectedmenu->title);
 				if (((enum gui_state) getstate) == state) {
 					cat->videopagetoken = videopagetoken;
 					videopagetoken = NULL;
@@ -5774,8 +7422,8 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				cat = gui_cat_alloc(gui, &gui->categories, NULL);
 				cat->nextPageState = GUI_STATE_SEARCH;
 				cat->prevPageState = GUI_STATE_SEARCH;
-				cat->searchterm = jt_strdup(gui->selectedmenu->searchterm);
-		 		cat->title = jt_strdup(gui->selectedmenu->searchterm);
+				cat->searchterm = arena_strdup(cat->arena, gui->selectedmenu->searchterm);
+		 		cat->title = arena_strdup(cat->arena, gui->selectedmenu->searchterm);
 				if (((enum gui_state) getstate) == state) {
 					cat->videopagetoken = videopagetoken;
 					videopagetoken = NULL;
@@ -5813,13 +7461,34 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 			}
 		}
 
+		if (gui->screen == NULL) {
+			/* Display couldn't be resumed after playing a video. */
+			done = 1;
+			retval = 0;
+			break;
+		}
+
 		/* Paint GUI elements. */
 		gui_paint(gui, state);
+		if (!gui->interactive && ((state == GUI_STATE_RUNNING) || (state == GUI_STATE_MAIN_MENU))) {
+			struct timeval now;
+			Uint32 startup;
+
+			gettimeofday(&now, NULL);
+			startup = (now.tv_sec - gui->starttime.tv_sec) * 1000 + (now.tv_usec - gui->starttime.tv_usec) / 1000;
+			LOG("Time to first interactive frame: %u ms\n", startup);
+			if (gui->bench != NULL) {
+				bench_startup(gui->bench, startup);
+			}
+			gui->interactive = 1;
+		}
+		if (gui->bench != NULL) {
+			bench_category(gui->bench, gui->current, gui_current_thumb_loaded(gui->current), SDL_GetTicks());
+		}
 
 		/* Check timer for power off. */
-		timeoutcounter++;
 		if (!done && (timer > 0)) {
-			if (timeoutcounter > timer) {
+			if (gui_ticks_passed(SDL_GetTicks(), lastinput + timer)) {
 				switch (state) {
 				case GUI_STATE_RUNNING:
 				case GUI_STATE_MAIN_MENU:
@@ -5830,7 +7499,7 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 
 					oldstatusmsg = gui->statusmsg;
 					gui->statusmsg = buf_printf(NULL, "Timeout powering off.");
-					wakeupcount = 3 * DEFAULT_SLEEP;
+					wakeuptime = SDL_GetTicks() + 3 * DEFAULT_SLEEP;
 					break;
 
 				case GUI_STATE_POWER_OFF:
@@ -5847,11 +7516,65 @@ int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, co
 				}
 			}
 		}
+
+		if (gui->bench != NULL) {
+			bench_frame(gui->bench, SDL_GetTicks() - frametime);
+		}
+		gui_update_memory(gui, SDL_GetTicks());
+		if (gui->hud || (gui->metrics != NULL)) {
+			gui_sample_frame(gui, SDL_GetTicks() - frametime, SDL_GetTicks());
+		}
+
+		/* Frame pacing: Only states waiting for user input or for a timer
+		 * are idle. All other states continue immediately.
+		 */
+		switch (state) {
+			case GUI_STATE_RUNNING:
+			case GUI_STATE_MAIN_MENU:
+			case GUI_STATE_WAIT_FOR_CONTINUE:
+			case GUI_STATE_SEARCH_ENTER:
+				idle = 1;
+				break;
+
+			default:
+				idle = gui_ticks_passed(SDL_GetTicks(), wakeuptime) ? 0 : 1;
+				break;
+		}
+		if (!done && idle && !gui->loading && !gui->prefetching) {
+			Uint32 deadline;
+			Uint32 now;
+
+			if (gui->animating || (gui->bench != NULL)) {
+				/* The benchmark script needs to push the next key in time. */
+				deadline = frametime + FRAME_TIME;
+			} else {
+				deadline = frametime + IDLE_FRAME_TIME;
+			}
+			if (!gui_ticks_passed(wakeuptime, deadline) && !gui_ticks_passed(frametime, wakeuptime)) {
+				/* Wake up for the next state transition. */
+				deadline = wakeuptime;
+			}
+			/* After the power off timeout fired, the state's wake up time is used. */
+			if ((timer > 0) && !gui_ticks_passed(lastinput + timer, deadline)
+				&& !gui_ticks_passed(SDL_GetTicks(), lastinput + timer)) {
+				deadline = lastinput + timer;
+			}
+			now = SDL_GetTicks();
+			if (!gui_ticks_passed(now, deadline)) {
+				gui_wait_event(deadline - now);
+			}
+		}
+	}
+	if (tracedstate >= 0) {
+		JT_TRACE_END("state", get_state_text(tracedstate));
 	}
 	if (oldstatusmsg != NULL) {
 		free(oldstatusmsg);
 		oldstatusmsg = NULL;
 	}
 	save_menu_state(gui);
+	gui_save_snapshot(gui);
+	player_free(gui->player);
+	gui->player = NULL;
 	return retval;
 }
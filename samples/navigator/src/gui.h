@@ -1,6 +1,9 @@
 #ifndef _GUI_H_
 #define _GUI_H_
 
+#include "bench.h"
+#include "metrics.h"
+
 struct gui_s;
 
 typedef struct gui_s gui_t;
@@ -11,8 +14,30 @@ typedef struct gui_cat_s gui_cat_t;
  * Allocate GUI.
  * @param videofile Videofile for storing information about selected video.
  */
-gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm);
+gui_t *gui_alloc(const char *sharedir, int fullscreen, const char *searchterm, int resident);
 void gui_free(gui_t *gui);
-int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, const char *channelid, const char *searchterm, const char *playlistid, const char *catpagetoken, const char *videoid, int catnr, int channelnr, const char *videopagetoken, int vidnr, int menunr, int timer);
+
+/** Run benchmark script in gui_loop(), the loop ends with the script. */
+void gui_set_bench(gui_t *gui, bench_t *bench);
+
+/** Get number of HTTP requests and received bytes, API and thumbnails. */
+void gui_get_transfer_stats(gui_t *gui, unsigned long *requests, unsigned long long *bytes);
+
+/**
+ * Get key of a button by name (e.g. "cross", "up").
+ *
+ * @returns SDL key or -1 if unknown.
+ */
+int gui_get_button(const char *name);
+
+/**
+ * Enable performance counters.
+ *
+ * @param hud Set to 1 to show the counters on screen.
+ * @param metrics Output for writing the counters or NULL.
+ */
+void gui_set_metrics(gui_t *gui, int hud, metrics_t *metrics);
+
+int gui_loop(gui_t *gui, int retval, int origgetstate, const char *videofile, const char *channelid, const char *searchterm, const char *playlistid, const char *catpagetoken, const char *videoid, int catnr, int channelnr, const char *videopagetoken, int vidnr, int menunr, int timer, int videoformat);
 
 #endif
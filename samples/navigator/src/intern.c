@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "intern.h"
+
+/** Initial number of slots in the hash table, must be a power of 2. */
+#define INTERN_INITIAL_SIZE 256
+/** Size of the memory chunks for the strings. */
+#define INTERN_ARENA_SIZE 8192
+
+/** Slot in the hash table. */
+typedef struct {
+	/** Hash of str. */
+	unsigned int hash;
+	/** Interned string, NULL if the slot is empty. */
+	const char *str;
+} intern_slot_t;
+
+struct intern_s {
+	/** Memory of the strings. */
+	arena_t *arena;
+	/** Hash table with open addressing. */
+	intern_slot_t *slot;
+	/** Number of slots, a power of 2. */
+	unsigned int size;
+	/** Number of used slots. */
+	unsigned int count;
+	/** Bytes used by the strings. */
+	size_t bytes;
+};
+
+/** FNV-1a hash. */
+static unsigned int intern_hash(const char *str)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*str != 0) {
+		hash ^= (unsigned char) *str;
+		hash *= 16777619u;
+		str++;
+	}
+	return hash;
+}
+
+intern_t *intern_alloc(void)
+{
+	intern_t *intern;
+
+	intern = malloc(sizeof(*intern));
+	if (intern == NULL) {
+		return NULL;
+	}
+	memset(intern, 0, sizeof(*intern));
+	intern->size = INTERN_INITIAL_SIZE;
+	intern->slot = calloc(intern->size, sizeof(intern->slot[0]));
+	intern->arena = arena_alloc(INTERN_ARENA_SIZE);
+	if ((intern->slot == NULL) || (intern->arena == NULL)) {
+		intern_free(intern);
+		return NULL;
+	}
+	return intern;
+}
+
+void intern_free(intern_t *intern)
+{
+	if (intern == NULL) {
+		return;
+	}
+	if (intern->slot != NULL) {
+		free(intern->slot);
+		intern->slot = NULL;
+	}
+	if (intern->arena != NULL) {
+		arena_free(intern->arena);
+		intern->arena = NULL;
+	}
+	free(intern);
+}
+
+/** Double the size of the hash table. */
+static int intern_grow(intern_t *intern)
+{
+	intern_slot_t *slot;
+	unsigned int size;
+	unsigned int i;
+
+	size = 2 * intern->size;
+	slot = calloc(size, sizeof(slot[0]));
+	if (slot == NULL) {
+		return -1;
+	}
+	for (i = 0; i < intern->size; i++) {
+		if (intern->slot[i].str != NULL) {
+			unsigned int pos = intern->slot[i].hash & (size - 1);
+
+			while (slot[pos].str != NULL) {
+				pos = (pos + 1) & (size - 1);
+			}
+			slot[pos] = intern->slot[i];
+		}
+	}
+	free(intern->slot);
+	intern->slot = slot;
+	intern->size = size;
+	return 0;
+}
+
+const char *intern_get(intern_t *intern, const char *str)
+{
+	unsigned int hash;
+	unsigned int pos;
+	char *copy;
+
+	if (str == NULL) {
+		return NULL;
+	}
+	hash = intern_hash(str);
+	pos = hash & (intern->size - 1);
+	while (intern->slot[pos].str != NULL) {
+		if ((intern->slot[pos].hash == hash) && (strcmp(intern->slot[pos].str, str) == 0)) {
+			return intern->slot[pos].str;
+		}
+		pos = (pos + 1) & (intern->size - 1);
+	}
+
+	/* Keep the load factor below 3/4. */
+	if (4 * (intern->count + 1) > 3 * intern->size) {
+		if (intern_grow(intern) != 0) {
+			return NULL;
+		}
+		pos = hash & (intern->size - 1);
+		while (intern->slot[pos].str != NULL) {
+			pos = (pos + 1) & (intern->size - 1);
+		}
+	}
+	copy = arena_strdup(intern->arena, str);
+	if (copy == NULL) {
+		return NULL;
+	}
+	intern->slot[pos].hash = hash;
+	intern->slot[pos].str = copy;
+	intern->count++;
+	intern->bytes += strlen(copy) + 1;
+	return copy;
+}
+
+void intern_get_stats(intern_t *intern, unsigned int *count, size_t *size)
+{
+	*count = intern->count;
+	*size = intern->bytes;
+}
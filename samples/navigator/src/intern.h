@@ -0,0 +1,32 @@
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+struct intern_s;
+
+typedef struct intern_s intern_t;
+
+/**
+ * Allocate a table of interned strings. Each distinct string is stored
+ * only once, so interned strings can be compared by pointer.
+ *
+ * @returns Table or NULL when out of memory.
+ */
+intern_t *intern_alloc(void);
+
+/** Free the table. All interned strings are invalid afterwards. */
+void intern_free(intern_t *intern);
+
+/**
+ * Get the interned copy of a string. The copy stays valid until
+ * intern_free() is called.
+ *
+ * @param str String to look up, NULL is allowed.
+ *
+ * @returns Interned string, NULL if str is NULL or when out of memory.
+ */
+const char *intern_get(intern_t *intern, const char *str);
+
+/** Get the number of interned strings and the bytes used by them. */
+void intern_get_stats(intern_t *intern, unsigned int *count, size_t *size);
+
+#endif
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "log.h"
+#include "metrics.h"
+
+/** Prefix of the target for Unix sockets. */
+#define METRICS_UNIX_PREFIX "unix:"
+
+struct metrics_s {
+	/** Output file, NULL when a socket is used. */
+	FILE *fout;
+	/** Address of the Unix socket. */
+	struct sockaddr_un addr;
+	/** Connected socket, -1 if not connected. */
+	int fd;
+};
+
+/** Try to connect to the listener, called again after it went away. */
+static void metrics_connect(metrics_t *metrics)
+{
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	if (connect(fd, (struct sockaddr *) &metrics->addr, sizeof(metrics->addr)) != 0) {
+		close(fd);
+		return;
+	}
+	metrics->fd = fd;
+}
+
+metrics_t *metrics_alloc(const char *target)
+{
+	metrics_t *metrics;
+
+	metrics = malloc(sizeof(*metrics));
+	if (metrics == NULL) {
+		return NULL;
+	}
+	memset(metrics, 0, sizeof(*metrics));
+	metrics->fd = -1;
+
+	if (strncmp(target, METRICS_UNIX_PREFIX, strlen(METRICS_UNIX_PREFIX)) == 0) {
+		const char *path = target + strlen(METRICS_UNIX_PREFIX);
+
+		if (strlen(path) >= sizeof(metrics->addr.sun_path)) {
+			LOG_ERROR("Socket path too long: %s\n", path);
+			free(metrics);
+			return NULL;
+		}
+		metrics->addr.sun_family = AF_UNIX;
+		strcpy(metrics->addr.sun_path, path);
+		metrics_connect(metrics);
+	} else {
+		metrics->fout = fopen(target, "at");
+		if (metrics->fout == NULL) {
+			LOG_ERROR("Failed to open %s: %s\n", target, strerror(errno));
+			free(metrics);
+			return NULL;
+		}
+	}
+	return metrics;
+}
+
+void metrics_free(metrics_t *metrics)
+{
+	if (metrics == NULL) {
+		return;
+	}
+	if (metrics->fout != NULL) {
+		fclose(metrics->fout);
+		metrics->fout = NULL;
+	}
+	if (metrics->fd >= 0) {
+		close(metrics->fd);
+		metrics->fd = -1;
+	}
+	free(metrics);
+}
+
+void metrics_write(metrics_t *metrics, const metrics_sample_t *sample, Uint32 now)
+{
+	char line[512];
+	int len;
+
+	len = snprintf(line, sizeof(line), "{\"time\":%u,\"frames\":%u,"
+		"\"frame_avg_ms\":%u,\"frame_max_ms\":%u,"
+		"\"paint_avg_ms\":%u,\"paint_max_ms\":%u,"
+		"\"inflight\":%u,\"thumb_queue\":%u,"
+		"\"thumb_hits\":%u,\"thumb_misses\":%u,"
+		"\"text_hits\":%u,\"text_misses\":%u,"
+		"\"surface_bytes\":%lu,\"requests\":%lu,\"bytes\":%llu}\n",
+		now, sample->frames,
+		sample->frameavg, sample->framemax,
+		sample->paintavg, sample->paintmax,
+		sample->inflight, sample->thumbqueue,
+		sample->thumbhits, sample->thumbmisses,
+		sample->texthits, sample->textmisses,
+		sample->surfacebytes, sample->requests, sample->bytes);
+	if ((len < 0) || (len >= (int) sizeof(line))) {
+		return;
+	}
+
+	if (metrics->fout != NULL) {
+		fputs(line, metrics->fout);
+		fflush(metrics->fout);
+		return;
+	}
+	if (metrics->fd < 0) {
+		metrics_connect(metrics);
+		if (metrics->fd < 0) {
+			return;
+		}
+	}
+	if (send(metrics->fd, line, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			/* Listener went away, connect again with the next sample. */
+			close(metrics->fd);
+			metrics->fd = -1;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <SDL/SDL.h>
+
+struct metrics_s;
+
+typedef struct metrics_s metrics_t;
+
+/** Counters collected by the GUI for one interval. */
+typedef struct {
+	/** Number of frames in the interval. */
+	unsigned int frames;
+	/** Average work time of a frame in milliseconds, without sleeping. */
+	Uint32 frameavg;
+	/** Maximum work time of a frame in milliseconds. */
+	Uint32 framemax;
+	/** Average time used by gui_paint() in milliseconds. */
+	Uint32 paintavg;
+	/** Maximum time used by gui_paint() in milliseconds. */
+	Uint32 paintmax;
+	/** Number of stream URLs resolved in the background. */
+	unsigned int inflight;
+	/** Number of thumbnails of visible categories which are not loaded yet. */
+	unsigned int thumbqueue;
+	/** Number of painted thumbnails which were already loaded. */
+	unsigned int thumbhits;
+	/** Number of thumbnails which needed to be loaded while painting. */
+	unsigned int thumbmisses;
+	/** Number of texts found in the text cache. */
+	unsigned int texthits;
+	/** Number of texts which needed rendering. */
+	unsigned int textmisses;
+	/** Memory used by pixels of thumbnails and cached texts in bytes. */
+	unsigned long surfacebytes;
+	/** Number of HTTP requests since start. */
+	unsigned long requests;
+	/** Number of bytes received since start. */
+	unsigned long long bytes;
+} metrics_sample_t;
+
+/**
+ * Open output for metrics. Each sample is written as one line of JSON.
+ *
+ * @param target File name or "unix:<path>" for a listening Unix socket.
+ *
+ * @returns Handle or NULL on error.
+ */
+metrics_t *metrics_alloc(const char *target);
+
+/** Close output. */
+void metrics_free(metrics_t *metrics);
+
+/**
+ * Write sample. Doesn't block, the sample is dropped when the socket is not
+ * ready or nobody is listening.
+ *
+ * @param now Time in milliseconds.
+ */
+void metrics_write(metrics_t *metrics, const metrics_sample_t *sample, Uint32 now);
+
+#endif
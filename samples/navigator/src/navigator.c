@@ -18,12 +18,13 @@
 #include <errno.h>
 #include <stdlib.h>
 
+#include "libjt.h"
 #include "log.h"
 #include "gui.h"
 #include "transfer.h"
 
-/** Timeout for power off is several minutes. */
-#define DEFAULT_TIMEOUT (48 * 300)
+/** Timeout for power off in milliseconds (5 minutes). */
+#define DEFAULT_TIMEOUT (5 * 60 * 1000)
 
 /**
  * Entry point for the application.
@@ -54,10 +55,17 @@ int main(int argc, char *argv[])
 	int menunr = 0;
 	int fullscreen = 0;
 	int timer = DEFAULT_TIMEOUT;
+	int videoformat = 0;
+	int resident = 0;
+	const char *benchscript = NULL;
+	bench_t *bench = NULL;
+	int hud = 0;
+	const char *metricstarget = NULL;
+	metrics_t *metrics = NULL;
 
 	errfd = stderr;
 
-	while((c = getopt (argc, argv, "l:sv:k:i:n:m:t:u:p:r:c:j:o:e:fT:S:")) != -1) {
+	while((c = getopt (argc, argv, "l:sv:k:i:n:m:t:u:p:r:c:j:o:e:fT:S:F:RB:HM:")) != -1) {
 		switch(c) {
 			case 'o':
 				/* Prefix for images. */
@@ -133,6 +141,31 @@ int main(int argc, char *argv[])
 				searchterm = optarg;
 				break;
 
+			case 'F':
+				/* youtube-dl video format for resolving stream URLs. */
+				videoformat = strtol(optarg, NULL, 0);
+				break;
+
+			case 'R':
+				/* Stay running while playing videos, release the display meanwhile. */
+				resident = 1;
+				break;
+
+			case 'B':
+				/* Run benchmark script without display and print results. */
+				benchscript = optarg;
+				break;
+
+			case 'H':
+				/* Show performance counters on screen. */
+				hud = 1;
+				break;
+
+			case 'M':
+				/* Write performance counters to a file or "unix:<socket>". */
+				metricstarget = optarg;
+				break;
+
 			default:
 				return 1;
 				break;
@@ -150,21 +183,63 @@ int main(int argc, char *argv[])
 		errfd = logfd;
 	}
 
+	if (benchscript != NULL) {
+		/* Don't overwrite the video driver when set by the user. */
+		setenv("SDL_VIDEODRIVER", "dummy", 0);
+		timer = 0;
+	}
+
+	if ((getenv("JT_TRACE") != NULL) && (jt_trace_open(getenv("JT_TRACE")) != 0)) {
+		LOG_ERROR("Failed to open trace file %s: %s\n", getenv("JT_TRACE"), strerror(errno));
+	}
+
 	transfer_init();
 
-	gui = gui_alloc(sharedir, fullscreen, searchterm);
+	gui = gui_alloc(sharedir, fullscreen, searchterm, resident);
 	if (gui == NULL) {
 		LOG_ERROR("Failed to intialize GUI.\n");
 		return -2;
 	}
 
+	if (benchscript != NULL) {
+		bench = bench_alloc(benchscript, gui_get_button);
+		if (bench == NULL) {
+			gui_free(gui);
+			gui = NULL;
+			return -3;
+		}
+		gui_set_bench(gui, bench);
+	}
+
+	if (metricstarget != NULL) {
+		metrics = metrics_alloc(metricstarget);
+	}
+	gui_set_metrics(gui, hud, metrics);
+
 	/* Call the GUI main processing loop. */
-	retval = gui_loop(gui, retval, state, videofile, channelid, searchterm, playlistid, catpagetoken, videoid, catnr, channelnr, videopagetoken, vidnr, menunr, timer);
+	retval = gui_loop(gui, retval, state, videofile, channelid, searchterm, playlistid, catpagetoken, videoid, catnr, channelnr, videopagetoken, vidnr, menunr, timer, videoformat);
+
+	if (bench != NULL) {
+		unsigned long requests;
+		unsigned long long bytes;
+
+		gui_get_transfer_stats(gui, &requests, &bytes);
+		bench_report(bench, stdout, requests, bytes);
+		bench_free(bench);
+		bench = NULL;
+	}
 
 	gui_free(gui);
 	gui = NULL;
 
+	if (metrics != NULL) {
+		metrics_free(metrics);
+		metrics = NULL;
+	}
+
 	transfer_cleanup();
 
+	jt_trace_close();
+
 	return retval;
 }
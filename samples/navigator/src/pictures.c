@@ -0,0 +1,185 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "rawpicture.h"
+#include "pictures.h"
+
+#ifndef NORAWPICTURES
+/** Pictures converted by the Makefile, must match PICTURES there. */
+#define PICTURES_LIST \
+	PICTURE(yt_powered) \
+	PICTURE(cross) \
+	PICTURE(circle) \
+	PICTURE(triangle) \
+	PICTURE(square) \
+	PICTURE(cross_small) \
+	PICTURE(circle_small) \
+	PICTURE(triangle_small) \
+	PICTURE(square_small)
+#else
+#define PICTURES_LIST
+#endif
+
+/* Linker symbols created by objcopy. */
+#define PICTURE(name) \
+	extern unsigned char _binary_pictures_##name##_raw_start[]; \
+	extern unsigned char _binary_pictures_##name##_raw_end[];
+PICTURES_LIST
+#undef PICTURE
+
+/** Picture linked into the program. */
+typedef struct {
+	/** Name of the original JPEG file. */
+	const char *file;
+	unsigned char *start;
+	unsigned char *end;
+} pictures_entry_t;
+
+#define PICTURE(name) \
+	{ #name ".jpg", _binary_pictures_##name##_raw_start, _binary_pictures_##name##_raw_end },
+static const pictures_entry_t pictures[] = {
+	PICTURES_LIST
+	{ NULL, NULL, NULL }
+};
+#undef PICTURE
+
+/** Read a little endian value. */
+static Uint32 pictures_get_value(const unsigned char *mem, int bytes)
+{
+	Uint32 value = 0;
+	int i;
+
+	for (i = bytes - 1; i >= 0; i--) {
+		value = (value << 8) | mem[i];
+	}
+	return value;
+}
+
+/** Store a pixel in the native byte order of the surface. */
+static void pictures_put_pixel(unsigned char *dst, Uint32 value, int bytes)
+{
+	if (bytes == 2) {
+		*((Uint16 *) dst) = value;
+	} else {
+		*((Uint32 *) dst) = value;
+	}
+}
+
+/**
+ * Copy the pixels into the surface.
+ *
+ * @returns 0 on success, -1 if the data is truncated.
+ */
+static int pictures_unpack(SDL_Surface *image, const unsigned char *mem, const unsigned char *end, int rle)
+{
+	int bytes = image->format->BytesPerPixel;
+	unsigned char *pixels = image->pixels;
+	unsigned int count = image->w * image->h;
+	unsigned int pos = 0;
+
+	while (pos < count) {
+		unsigned int run;
+		unsigned int i;
+		int repeat;
+
+		if (rle) {
+			Uint32 value;
+
+			if ((end - mem) < 2) {
+				return -1;
+			}
+			value = pictures_get_value(mem, 2);
+			mem += 2;
+			repeat = (value & RAWPICTURE_RLE_REPEAT) != 0;
+			run = (value & RAWPICTURE_RLE_COUNT) + 1;
+		} else {
+			repeat = 0;
+			run = count;
+		}
+		if ((run > (count - pos)) || ((end - mem) < (repeat ? 1 : (long) run) * bytes)) {
+			return -1;
+		}
+		for (i = 0; i < run; i++) {
+			unsigned int x = (pos + i) % image->w;
+			unsigned int y = (pos + i) / image->w;
+
+			pictures_put_pixel(pixels + y * image->pitch + x * bytes, pictures_get_value(mem, bytes), bytes);
+			if (!repeat) {
+				mem += bytes;
+			}
+		}
+		if (repeat) {
+			mem += bytes;
+		}
+		pos += run;
+	}
+	return 0;
+}
+
+/** Create a surface for the raw picture. */
+static SDL_Surface *pictures_load(const pictures_entry_t *entry)
+{
+	const unsigned char *mem = entry->start;
+	SDL_Surface *image;
+	Uint32 flags;
+	int w;
+	int h;
+	int bpp;
+	int bytes;
+
+	if ((entry->end - entry->start) < RAWPICTURE_HEADER_SIZE) {
+		return NULL;
+	}
+	if (pictures_get_value(mem, 4) != RAWPICTURE_MAGIC) {
+		return NULL;
+	}
+	flags = pictures_get_value(mem + 4, 4);
+	w = pictures_get_value(mem + 8, 4);
+	h = pictures_get_value(mem + 12, 4);
+	bpp = pictures_get_value(mem + 16, 4);
+	if ((w <= 0) || (h <= 0) || ((bpp != 16) && (bpp != 32))) {
+		return NULL;
+	}
+	bytes = bpp / 8;
+	mem += RAWPICTURE_HEADER_SIZE;
+
+	/* The pixels are stored little endian, use them directly if that is the
+	 * native format and they are aligned.
+	 */
+	if (!(flags & RAWPICTURE_FLAG_RLE)
+		&& (SDL_BYTEORDER == SDL_LIL_ENDIAN)
+		&& ((((uintptr_t) mem) % bytes) == 0)
+		&& ((entry->end - mem) >= (long) w * h * bytes)) {
+		return SDL_CreateRGBSurfaceFrom((void *) mem, w, h, bpp, w * bytes,
+			pictures_get_value(entry->start + 20, 4),
+			pictures_get_value(entry->start + 24, 4),
+			pictures_get_value(entry->start + 28, 4), 0);
+	}
+
+	image = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, bpp,
+		pictures_get_value(entry->start + 20, 4),
+		pictures_get_value(entry->start + 24, 4),
+		pictures_get_value(entry->start + 28, 4), 0);
+	if (image == NULL) {
+		return NULL;
+	}
+	if (pictures_unpack(image, mem, entry->end, flags & RAWPICTURE_FLAG_RLE) != 0) {
+		LOG_ERROR("Raw picture is truncated.\n");
+		SDL_FreeSurface(image);
+		return NULL;
+	}
+	return image;
+}
+
+SDL_Surface *pictures_get(const char *file)
+{
+	const pictures_entry_t *entry;
+
+	for (entry = pictures; entry->file != NULL; entry++) {
+		if (strcmp(entry->file, file) == 0) {
+			return pictures_load(entry);
+		}
+	}
+	return NULL;
+}
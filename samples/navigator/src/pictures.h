@@ -1,9 +1,17 @@
 #ifndef _PICTURES_H_
 #define _PICTURES_H_
 
-/** Linker symbol to YouTube logo in JPEG format. */
-extern unsigned char _binary_pictures_yt_powered_jpg_start;
-/** Linker symbol to size of YouTube logo in JPEG format. */
-extern unsigned char _binary_pictures_yt_powered_jpg_size;
+#include <SDL/SDL.h>
+
+/**
+ * Get a picture which was converted into raw pixels at build time. The
+ * surface uses the pixels linked into the program when possible, so no
+ * decoding is needed.
+ *
+ * @param file Name of the JPEG file in the pictures directory, e.g. "cross.jpg".
+ *
+ * @returns Surface or NULL when the picture is not linked into the program.
+ */
+SDL_Surface *pictures_get(const char *file);
 
 #endif
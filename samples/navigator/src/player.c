@@ -0,0 +1,922 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+
+#include "log.h"
+#include "player.h"
+
+/** Program used to get the stream URL. */
+#define RESOLVER "youtube-dl"
+/** Program used to download the stream. */
+#define DOWNLOADER "wget"
+/** Program used to play the stream. */
+#define PLAYER "mplayer"
+/** Number of cached stream URLs. */
+#define PLAYER_URL_CACHE 8
+/** Stream URLs expire, don't use them after this time in seconds. */
+#define PLAYER_URL_TTL (30 * 60)
+/** Size of spool for pre-buffering the next video in bytes. */
+#define PLAYER_SPOOL_SIZE (4 * 1024 * 1024)
+/** Size of a block copied by the spool process in bytes. */
+#define PLAYER_SPOOL_BLOCK (16 * 1024)
+/** Time in milliseconds between checks of the running processes while playing. */
+#define PLAYER_POLL_TIME 100
+/** Printed by the player when the video was played to the end. */
+#define PLAYER_END_MESSAGE "(End of file)"
+
+/** Kind of job running in the resolver process. */
+enum player_job {
+	PLAYER_JOB_NONE,
+	PLAYER_JOB_USERAGENT,
+	PLAYER_JOB_URL,
+};
+
+/** Cached stream URL. */
+typedef struct {
+	/** YouTube video ID. */
+	char *videoid;
+	/** Stream URL. */
+	char *url;
+	/** Time when the URL was resolved. */
+	time_t time;
+} player_url_t;
+
+/** Download of a stream through a spool file. */
+typedef struct {
+	/** YouTube video ID, NULL when not used. */
+	char *videoid;
+	/** Process ID of the downloader. */
+	pid_t dlpid;
+	/** Process ID of the spool process. */
+	pid_t pid;
+	/** Pipe for reading the stream from the spool process. */
+	int fd;
+} player_spool_t;
+
+struct player_s {
+	/** youtube-dl video format, 0 for default. */
+	int format;
+	/** Set when the user agent is needed. */
+	int needuseragent;
+	/** User agent of youtube-dl. */
+	char *useragent;
+	/** Cached stream URLs. */
+	player_url_t cache[PLAYER_URL_CACHE];
+	/** Next entry to replace in cache. */
+	int cachepos;
+	/** Process ID of running resolver, 0 if none. */
+	pid_t pid;
+	/** Pipe for reading the output of the resolver. */
+	int fd;
+	/** Job of the running resolver. */
+	enum player_job job;
+	/** Video ID resolved by the running resolver. */
+	char *videoid;
+	/** Output of resolver. */
+	char *output;
+	/** Number of bytes in output. */
+	size_t outputlen;
+	/** Video ID to resolve after the running job. */
+	char *pending;
+	/** Pre-buffered next video. */
+	player_spool_t spool;
+};
+
+/**
+ * Start a program with stdout connected to a pipe.
+ *
+ * @param fd Read end of pipe is returned here.
+ *
+ * @returns Process ID or -1 on error.
+ */
+static pid_t player_spawn(char *const argv[], int *fd)
+{
+	int p[2];
+	pid_t pid;
+
+	if (pipe(p) != 0) {
+		LOG_ERROR("pipe failed: %s\n", strerror(errno));
+		return -1;
+	}
+	pid = fork();
+	if (pid == 0) {
+		int null;
+
+		null = open("/dev/null", O_RDWR);
+		if (null >= 0) {
+			dup2(null, 0);
+			close(null);
+		}
+		dup2(p[1], 1);
+		close(p[0]);
+		close(p[1]);
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+	close(p[1]);
+	if (pid < 0) {
+		LOG_ERROR("fork failed: %s\n", strerror(errno));
+		close(p[0]);
+		return -1;
+	}
+	*fd = p[0];
+	return pid;
+}
+
+/** Get name of the cookie file used by youtube-dl for the video. */
+static char *player_cookie_file(const char *videoid)
+{
+	char *filename = NULL;
+
+	if (asprintf(&filename, "/tmp/ytcookie-%s.txt", videoid) == -1) {
+		return NULL;
+	}
+	return filename;
+}
+
+/** Delete the cookie file of the video, it is only valid together with the URL. */
+static void player_cookie_remove(const char *videoid)
+{
+	char *cookiefile;
+
+	cookiefile = player_cookie_file(videoid);
+	if (cookiefile != NULL) {
+		unlink(cookiefile);
+		free(cookiefile);
+		cookiefile = NULL;
+	}
+}
+
+/** Start resolver for the user agent or the URL of videoid. */
+static int player_start_job(player_t *player, enum player_job job, const char *videoid)
+{
+	char *argv[8];
+	char *cookies = NULL;
+	char *url = NULL;
+	char format[16];
+	int i = 0;
+
+	if (job == PLAYER_JOB_USERAGENT) {
+		argv[i++] = RESOLVER;
+		argv[i++] = "--dump-user-agent";
+	} else {
+		char *cookiefile;
+
+		cookiefile = player_cookie_file(videoid);
+		if (cookiefile == NULL) {
+			return -1;
+		}
+		if (asprintf(&cookies, "--cookies=%s", cookiefile) == -1) {
+			cookies = NULL;
+		}
+		free(cookiefile);
+		cookiefile = NULL;
+		if (asprintf(&url, "https://www.youtube.com/watch?v=%s", videoid) == -1) {
+			url = NULL;
+		}
+		if ((cookies == NULL) || (url == NULL)) {
+			if (cookies != NULL) {
+				free(cookies);
+			}
+			if (url != NULL) {
+				free(url);
+			}
+			return -1;
+		}
+		argv[i++] = RESOLVER;
+		argv[i++] = "-g";
+		if (player->format != 0) {
+			snprintf(format, sizeof(format), "%d", player->format);
+			argv[i++] = "-f";
+			argv[i++] = format;
+		}
+		argv[i++] = cookies;
+		argv[i++] = url;
+	}
+	argv[i] = NULL;
+
+	player->pid = player_spawn(argv, &player->fd);
+	if (cookies != NULL) {
+		free(cookies);
+		cookies = NULL;
+	}
+	if (url != NULL) {
+		free(url);
+		url = NULL;
+	}
+	if (player->pid < 0) {
+		player->pid = 0;
+		return -1;
+	}
+	fcntl(player->fd, F_SETFL, fcntl(player->fd, F_GETFL) | O_NONBLOCK);
+	player->job = job;
+	player->outputlen = 0;
+	if (player->videoid != NULL) {
+		free(player->videoid);
+		player->videoid = NULL;
+	}
+	if (videoid != NULL) {
+		player->videoid = strdup(videoid);
+	}
+	return 0;
+}
+
+/** Add stream URL to cache. */
+static void player_cache_add(player_t *player, const char *videoid, const char *url)
+{
+	player_url_t *entry;
+
+	entry = &player->cache[player->cachepos];
+	player->cachepos = (player->cachepos + 1) % PLAYER_URL_CACHE;
+	if (entry->videoid != NULL) {
+		if (strcmp(entry->videoid, videoid) != 0) {
+			player_cookie_remove(entry->videoid);
+		}
+		free(entry->videoid);
+		entry->videoid = NULL;
+	}
+	if (entry->url != NULL) {
+		free(entry->url);
+		entry->url = NULL;
+	}
+	entry->videoid = strdup(videoid);
+	entry->url = strdup(url);
+	entry->time = time(NULL);
+}
+
+/** Remove stream URL from cache, e.g. when the cookies are deleted. */
+static void player_cache_remove(player_t *player, const char *videoid)
+{
+	int i;
+
+	for (i = 0; i < PLAYER_URL_CACHE; i++) {
+		player_url_t *entry = &player->cache[i];
+
+		if ((entry->videoid != NULL) && (strcmp(entry->videoid, videoid) == 0)) {
+			free(entry->videoid);
+			entry->videoid = NULL;
+			if (entry->url != NULL) {
+				free(entry->url);
+				entry->url = NULL;
+			}
+		}
+	}
+}
+
+/** Handle output of finished resolver and start the pending job. */
+static void player_finish_job(player_t *player, int status)
+{
+	char *line = NULL;
+
+	if (player->output != NULL) {
+		char *end;
+
+		player->output[player->outputlen] = 0;
+		/* Use first line, there is a second one for separate audio streams. */
+		end = strchr(player->output, '\n');
+		if (end != NULL) {
+			*end = 0;
+		}
+		if (player->output[0] != 0) {
+			line = player->output;
+		}
+	}
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0) || (line == NULL)) {
+		LOG_ERROR("%s failed for %s.\n", RESOLVER, (player->videoid != NULL) ? player->videoid : "user agent");
+		if (player->videoid != NULL) {
+			player_cookie_remove(player->videoid);
+		}
+	} else if (player->job == PLAYER_JOB_USERAGENT) {
+		player->useragent = strdup(line);
+	} else if (player->videoid != NULL) {
+		LOG("Resolved stream URL of %s.\n", player->videoid);
+		player_cache_add(player, player->videoid, line);
+	}
+	if (player->fd >= 0) {
+		close(player->fd);
+		player->fd = -1;
+	}
+	player->pid = 0;
+	player->job = PLAYER_JOB_NONE;
+	player->outputlen = 0;
+
+	if (player->pending != NULL) {
+		char *videoid = player->pending;
+
+		player->pending = NULL;
+		if (player_get_url(player, videoid) == NULL) {
+			player_start_job(player, PLAYER_JOB_URL, videoid);
+		}
+		free(videoid);
+	}
+}
+
+/** Read output of resolver. */
+static int player_read(player_t *player)
+{
+	while (1) {
+		ssize_t n;
+		char *mem;
+
+		mem = realloc(player->output, player->outputlen + 256 + 1);
+		if (mem == NULL) {
+			return -1;
+		}
+		player->output = mem;
+		n = read(player->fd, player->output + player->outputlen, 256);
+		if (n > 0) {
+			player->outputlen += n;
+		} else if (n == 0) {
+			/* End of file. */
+			return 1;
+		} else if ((errno == EAGAIN) || (errno == EINTR)) {
+			return 0;
+		} else {
+			return -1;
+		}
+	}
+}
+
+int player_poll(player_t *player)
+{
+	int status = 0;
+	int ret;
+
+	if (player->pid == 0) {
+		return 0;
+	}
+	if (player->fd >= 0) {
+		ret = player_read(player);
+		if (ret == 0) {
+			return 1;
+		}
+		/* Pipe is done, the resolver may still be exiting. */
+		close(player->fd);
+		player->fd = -1;
+	}
+	/* Don't block the GUI, the child is collected on a later poll. */
+	ret = waitpid(player->pid, &status, WNOHANG);
+	if (ret == player->pid) {
+		player_finish_job(player, status);
+	} else if (ret < 0) {
+		player_finish_job(player, -1);
+	}
+	return (player->pid != 0);
+}
+
+/** Wait until the running resolver finished. */
+static void player_wait(player_t *player)
+{
+	while (player->pid != 0) {
+		fd_set rfds;
+
+		if (player->fd >= 0) {
+			FD_ZERO(&rfds);
+			FD_SET(player->fd, &rfds);
+			select(player->fd + 1, &rfds, NULL, NULL, NULL);
+		} else {
+			/* Pipe closed, wait for the resolver to exit. */
+			usleep(10000);
+		}
+		player_poll(player);
+	}
+}
+
+/**
+ * Copy the stream from in to out. Up to PLAYER_SPOOL_SIZE bytes are read
+ * ahead into a ring buffer in the spool file, also when nobody reads out
+ * yet. Runs in a forked process.
+ */
+static void player_spool_run(int in, int out, const char *filename)
+{
+	char buffer[PLAYER_SPOOL_BLOCK];
+	unsigned long long rpos = 0;
+	unsigned long long wpos = 0;
+	int eof = 0;
+	int fd;
+
+	fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		return;
+	}
+	/* The file is removed when the process exits. */
+	unlink(filename);
+	fcntl(out, F_SETFL, fcntl(out, F_GETFL) | O_NONBLOCK);
+
+	while (!eof || (rpos < wpos)) {
+		fd_set rfds;
+		fd_set wfds;
+		int maxfd = -1;
+
+		FD_ZERO(&rfds);
+		FD_ZERO(&wfds);
+		if (!eof && ((wpos - rpos) < PLAYER_SPOOL_SIZE)) {
+			FD_SET(in, &rfds);
+			maxfd = in;
+		}
+		if (rpos < wpos) {
+			FD_SET(out, &wfds);
+			if (out > maxfd) {
+				maxfd = out;
+			}
+		}
+		if (select(maxfd + 1, &rfds, &wfds, NULL, NULL) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (FD_ISSET(in, &rfds)) {
+			size_t len;
+			size_t off;
+			ssize_t n;
+
+			/* Don't read over the end of the ring buffer. */
+			off = wpos % PLAYER_SPOOL_SIZE;
+			len = PLAYER_SPOOL_SIZE - (wpos - rpos);
+			if (len > (PLAYER_SPOOL_SIZE - off)) {
+				len = PLAYER_SPOOL_SIZE - off;
+			}
+			if (len > sizeof(buffer)) {
+				len = sizeof(buffer);
+			}
+			n = read(in, buffer, len);
+			if (n > 0) {
+				if (pwrite(fd, buffer, n, off) != n) {
+					break;
+				}
+				wpos += n;
+			} else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+				eof = 1;
+			}
+		}
+		if (FD_ISSET(out, &wfds)) {
+			size_t len;
+			size_t off;
+			ssize_t n;
+
+			off = rpos % PLAYER_SPOOL_SIZE;
+			len = wpos - rpos;
+			if (len > (PLAYER_SPOOL_SIZE - off)) {
+				len = PLAYER_SPOOL_SIZE - off;
+			}
+			if (len > sizeof(buffer)) {
+				len = sizeof(buffer);
+			}
+			n = pread(fd, buffer, len, off);
+			if (n <= 0) {
+				break;
+			}
+			n = write(out, buffer, n);
+			if (n > 0) {
+				rpos += n;
+			} else if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+				/* Player stopped. */
+				break;
+			}
+		}
+	}
+	close(fd);
+}
+
+/** Stop download and spool process. */
+static void player_spool_stop(player_spool_t *spool)
+{
+	if (spool->dlpid > 0) {
+		kill(spool->dlpid, SIGTERM);
+		waitpid(spool->dlpid, NULL, 0);
+		spool->dlpid = 0;
+	}
+	if (spool->pid > 0) {
+		kill(spool->pid, SIGTERM);
+		waitpid(spool->pid, NULL, 0);
+		spool->pid = 0;
+	}
+	if (spool->fd >= 0) {
+		close(spool->fd);
+		spool->fd = -1;
+	}
+	if (spool->videoid != NULL) {
+		free(spool->videoid);
+		spool->videoid = NULL;
+	}
+}
+
+/**
+ * Start downloading the stream of a resolved video into a spool. The stream
+ * can be read from spool->fd afterwards.
+ */
+static int player_spool_start(player_t *player, player_spool_t *spool, const char *videoid, const char *url)
+{
+	char *cookiefile;
+	char *spoolfile = NULL;
+	char *agent = NULL;
+	char *cookies = NULL;
+	char *dlargv[10];
+	int in[2];
+	int out[2];
+	int i;
+
+	memset(spool, 0, sizeof(*spool));
+	spool->fd = -1;
+
+	cookiefile = player_cookie_file(videoid);
+	if (cookiefile == NULL) {
+		return -1;
+	}
+	if (asprintf(&spoolfile, "/tmp/ytspool-%s", videoid) == -1) {
+		free(cookiefile);
+		return -1;
+	}
+	i = 0;
+	dlargv[i++] = DOWNLOADER;
+	if (player->useragent != NULL) {
+		if (asprintf(&agent, "--user-agent=%s", player->useragent) != -1) {
+			dlargv[i++] = agent;
+		} else {
+			agent = NULL;
+		}
+	}
+	dlargv[i++] = "-o";
+	dlargv[i++] = "/dev/null";
+	dlargv[i++] = "-O";
+	dlargv[i++] = "-";
+	if (asprintf(&cookies, "--load-cookies=%s", cookiefile) != -1) {
+		dlargv[i++] = cookies;
+	} else {
+		cookies = NULL;
+	}
+	dlargv[i++] = (char *) url;
+	dlargv[i] = NULL;
+
+	if (pipe(in) == 0) {
+		if (pipe(out) == 0) {
+			spool->dlpid = fork();
+			if (spool->dlpid == 0) {
+				dup2(in[1], 1);
+				close(in[0]);
+				close(in[1]);
+				close(out[0]);
+				close(out[1]);
+				execvp(dlargv[0], dlargv);
+				_exit(127);
+			}
+			spool->pid = fork();
+			if (spool->pid == 0) {
+				signal(SIGPIPE, SIG_IGN);
+				close(in[1]);
+				close(out[0]);
+				player_spool_run(in[0], out[1], spoolfile);
+				_exit(0);
+			}
+			close(out[1]);
+			spool->fd = out[0];
+		} else {
+			LOG_ERROR("pipe failed: %s\n", strerror(errno));
+		}
+		close(in[0]);
+		close(in[1]);
+	} else {
+		LOG_ERROR("pipe failed: %s\n", strerror(errno));
+	}
+
+	free(cookiefile);
+	cookiefile = NULL;
+	free(spoolfile);
+	spoolfile = NULL;
+	if (agent != NULL) {
+		free(agent);
+		agent = NULL;
+	}
+	if (cookies != NULL) {
+		free(cookies);
+		cookies = NULL;
+	}
+	if ((spool->dlpid <= 0) || (spool->pid <= 0)) {
+		player_spool_stop(spool);
+		return -1;
+	}
+	spool->videoid = strdup(videoid);
+	return 0;
+}
+
+player_t *player_alloc(int format, int useragent)
+{
+	player_t *player;
+
+	player = malloc(sizeof(*player));
+	if (player == NULL) {
+		return NULL;
+	}
+	memset(player, 0, sizeof(*player));
+	player->format = format;
+	player->needuseragent = useragent;
+	player->fd = -1;
+	player->spool.fd = -1;
+
+	return player;
+}
+
+void player_free(player_t *player)
+{
+	int i;
+
+	if (player == NULL) {
+		return;
+	}
+	if (player->pid != 0) {
+		kill(player->pid, SIGTERM);
+		waitpid(player->pid, NULL, 0);
+		player->pid = 0;
+		if ((player->job == PLAYER_JOB_URL) && (player->videoid != NULL)) {
+			player_cookie_remove(player->videoid);
+		}
+	}
+	if (player->fd >= 0) {
+		close(player->fd);
+		player->fd = -1;
+	}
+	if (player->spool.videoid != NULL) {
+		player_cookie_remove(player->spool.videoid);
+	}
+	player_spool_stop(&player->spool);
+	for (i = 0; i < PLAYER_URL_CACHE; i++) {
+		if (player->cache[i].videoid != NULL) {
+			player_cookie_remove(player->cache[i].videoid);
+			free(player->cache[i].videoid);
+			player->cache[i].videoid = NULL;
+		}
+		if (player->cache[i].url != NULL) {
+			free(player->cache[i].url);
+			player->cache[i].url = NULL;
+		}
+	}
+	if (player->useragent != NULL) {
+		free(player->useragent);
+		player->useragent = NULL;
+	}
+	if (player->videoid != NULL) {
+		free(player->videoid);
+		player->videoid = NULL;
+	}
+	if (player->pending != NULL) {
+		free(player->pending);
+		player->pending = NULL;
+	}
+	if (player->output != NULL) {
+		free(player->output);
+		player->output = NULL;
+	}
+	free(player);
+}
+
+const char *player_get_url(player_t *player, const char *videoid)
+{
+	time_t now;
+	int i;
+
+	now = time(NULL);
+	for (i = 0; i < PLAYER_URL_CACHE; i++) {
+		player_url_t *entry = &player->cache[i];
+
+		if ((entry->videoid != NULL) && (strcmp(entry->videoid, videoid) == 0)
+			&& ((now - entry->time) < PLAYER_URL_TTL)) {
+			return entry->url;
+		}
+	}
+	return NULL;
+}
+
+void player_prefetch(player_t *player, const char *videoid)
+{
+	if (videoid == NULL) {
+		return;
+	}
+	if (player_get_url(player, videoid) != NULL) {
+		/* Already resolved. */
+		return;
+	}
+	if ((player->videoid != NULL) && (player->job == PLAYER_JOB_URL) && (strcmp(player->videoid, videoid) == 0)) {
+		/* Already resolving. */
+		return;
+	}
+	if (player->pending != NULL) {
+		free(player->pending);
+		player->pending = NULL;
+	}
+	if (player->pid != 0) {
+		player->pending = strdup(videoid);
+	} else if (player->needuseragent && (player->useragent == NULL)) {
+		player->pending = strdup(videoid);
+		player_start_job(player, PLAYER_JOB_USERAGENT, NULL);
+	} else {
+		player_start_job(player, PLAYER_JOB_URL, videoid);
+	}
+}
+
+void player_handover(player_t *player, const char *videoid)
+{
+	/* Forget the URL without deleting the cookies. */
+	player_cache_remove(player, videoid);
+}
+
+int player_pending(player_t *player)
+{
+	return ((player->pid != 0) ? 1 : 0) + ((player->pending != NULL) ? 1 : 0);
+}
+
+int player_ready(player_t *player, const char *videoid)
+{
+	return (player->spool.videoid != NULL) && (strcmp(player->spool.videoid, videoid) == 0);
+}
+
+/**
+ * Read the output of the player and look for the message that the video
+ * was played to the end.
+ *
+ * @param tail End of the output of the last call, the message can be split
+ *             between two reads.
+ *
+ * @returns 1 when the message was found.
+ */
+static int player_check_end(int fd, char *tail, size_t tailsize)
+{
+	char buffer[1024];
+	size_t len;
+	ssize_t rv;
+	int found = 0;
+
+	len = strlen(tail);
+	memcpy(buffer, tail, len);
+	while ((rv = read(fd, buffer + len, sizeof(buffer) - len - 1)) > 0) {
+		len += rv;
+		buffer[len] = 0;
+		if (strstr(buffer, PLAYER_END_MESSAGE) != NULL) {
+			found = 1;
+		}
+		/* Keep the end, which can be the start of the message. */
+		if (len >= tailsize) {
+			memmove(buffer, buffer + len - (tailsize - 1), tailsize - 1);
+			len = tailsize - 1;
+		}
+	}
+	buffer[len] = 0;
+	memcpy(tail, buffer, len + 1);
+	return found;
+}
+
+int player_play(player_t *player, const char *videoid, int buffersize, int fullscreen, const char *nextvideoid)
+{
+	char tail[sizeof(PLAYER_END_MESSAGE)];
+	int out[2];
+	player_spool_t current;
+	const char *url;
+	char cache[16];
+	char *playargv[8];
+	pid_t playpid;
+	int status = 0;
+	int dlstatus = 0;
+	int failed = 0;
+	int ended = 0;
+	int i;
+
+	if (player_ready(player, videoid)) {
+		/* Already buffering since the previous video was played. */
+		current = player->spool;
+		memset(&player->spool, 0, sizeof(player->spool));
+		player->spool.fd = -1;
+	} else {
+		/* Pre-buffered video is not needed anymore. */
+		player_spool_stop(&player->spool);
+
+		/* Resolve what is still missing. */
+		if (player_get_url(player, videoid) == NULL) {
+			player_prefetch(player, videoid);
+		}
+		player_wait(player);
+		if (player->needuseragent && (player->useragent == NULL)) {
+			player_start_job(player, PLAYER_JOB_USERAGENT, NULL);
+			player_wait(player);
+		}
+		url = player_get_url(player, videoid);
+		if (url == NULL) {
+			player_start_job(player, PLAYER_JOB_URL, videoid);
+			player_wait(player);
+			url = player_get_url(player, videoid);
+		}
+		if (url == NULL) {
+			LOG_ERROR("Failed to get stream URL of %s.\n", videoid);
+			return 1;
+		}
+		if (player_spool_start(player, &current, videoid, url) != 0) {
+			return 1;
+		}
+	}
+
+	snprintf(cache, sizeof(cache), "%d", buffersize);
+	i = 0;
+	playargv[i++] = PLAYER;
+	playargv[i++] = "-quiet";
+	playargv[i++] = "-cache";
+	playargv[i++] = cache;
+	if (fullscreen) {
+		playargv[i++] = "-fs";
+	}
+	playargv[i++] = "-";
+	playargv[i] = NULL;
+
+	/* The output tells whether the video was played to the end or stopped by the user. */
+	if (pipe(out) != 0) {
+		LOG_ERROR("pipe failed: %s\n", strerror(errno));
+		player_spool_stop(&current);
+		return 1;
+	}
+	fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+	tail[0] = 0;
+
+	LOG("Playing %s\n", videoid);
+	playpid = fork();
+	if (playpid == 0) {
+		dup2(current.fd, 0);
+		close(current.fd);
+		dup2(out[1], 1);
+		close(out[0]);
+		close(out[1]);
+		execvp(playargv[0], playargv);
+		_exit(127);
+	}
+	close(out[1]);
+	close(current.fd);
+	current.fd = -1;
+
+	if (nextvideoid != NULL) {
+		/* Resolve the next video of the playlist while this one is playing. */
+		player_prefetch(player, nextvideoid);
+	}
+	while (playpid > 0) {
+		struct timeval tv;
+
+		/* Also drains the pipe, so that the player doesn't block. */
+		if (player_check_end(out[0], tail, sizeof(tail))) {
+			ended = 1;
+		}
+		if (waitpid(playpid, &status, WNOHANG) != 0) {
+			playpid = 0;
+			break;
+		}
+		if ((current.dlpid > 0) && (waitpid(current.dlpid, &dlstatus, WNOHANG) != 0)) {
+			current.dlpid = 0;
+			if (!WIFEXITED(dlstatus) || (WEXITSTATUS(dlstatus) != 0)) {
+				/* The player reaches the end of a broken download early. */
+				LOG_ERROR("Download of %s failed.\n", videoid);
+				failed = 1;
+			}
+		}
+		if ((current.pid > 0) && (waitpid(current.pid, NULL, WNOHANG) != 0)) {
+			/* Whole stream was passed to the player, it can still be stopped. */
+			current.pid = 0;
+		}
+		player_poll(player);
+		if ((nextvideoid != NULL) && (player->spool.videoid == NULL)) {
+			url = player_get_url(player, nextvideoid);
+			if (url != NULL) {
+				LOG("Pre-buffering %s\n", nextvideoid);
+				player_spool_start(player, &player->spool, nextvideoid, url);
+				/* Start only once, also when it failed. */
+				nextvideoid = NULL;
+			}
+		}
+		tv.tv_sec = 0;
+		tv.tv_usec = PLAYER_POLL_TIME * 1000;
+		select(0, NULL, NULL, NULL, &tv);
+	}
+	if (player_check_end(out[0], tail, sizeof(tail))) {
+		ended = 1;
+	}
+	close(out[0]);
+	if (failed || ((playpid == 0) && (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)))) {
+		ended = 0;
+	}
+	/* Player may have stopped before the download finished. */
+	player_spool_stop(&current);
+
+	player_cookie_remove(videoid);
+	player_cache_remove(player, videoid);
+
+	if (playpid < 0) {
+		LOG_ERROR("fork failed: %s\n", strerror(errno));
+		return 1;
+	}
+	return ended ? 0 : 2;
+}
@@ -0,0 +1,73 @@
+#ifndef _PLAYER_H_
+#define _PLAYER_H_
+
+struct player_s;
+
+typedef struct player_s player_t;
+
+/**
+ * Allocate playback handle.
+ *
+ * @param format youtube-dl video format, 0 for default.
+ * @param useragent Set to 1 when the user agent of youtube-dl is needed for
+ *                  playing. It is resolved together with the first URL.
+ */
+player_t *player_alloc(int format, int useragent);
+
+/** Free handle and stop a running resolver. */
+void player_free(player_t *player);
+
+/**
+ * Resolve the stream URL of a video in the background. Only one resolver is
+ * running, a newer request replaces a pending one.
+ */
+void player_prefetch(player_t *player, const char *videoid);
+
+/**
+ * Check for finished resolvers. Needs to be called regularly, doesn't block.
+ *
+ * @returns 1 while a resolver is running.
+ */
+int player_poll(player_t *player);
+
+/**
+ * Get cached stream URL of a video.
+ *
+ * @returns URL or NULL if not resolved yet.
+ */
+const char *player_get_url(player_t *player, const char *videoid);
+
+/**
+ * Hand the stream URL of videoid over to another program. The cookie file
+ * of the video is then kept by player_free(), because the URL is not usable
+ * without it.
+ */
+void player_handover(player_t *player, const char *videoid);
+
+/**
+ * Get number of background jobs for resolving stream URLs, running and
+ * waiting.
+ */
+int player_pending(player_t *player);
+
+/**
+ * Check whether the start of the video is already pre-buffered.
+ */
+int player_ready(player_t *player, const char *videoid);
+
+/**
+ * Play video. The stream URL is taken from the cache or resolved now. The
+ * function returns when the player exited.
+ *
+ * @param buffersize Cache size of the player in KByte.
+ * @param fullscreen Set to 1 to start the player in fullscreen mode.
+ * @param nextvideoid Video which is played afterwards or NULL. Its URL is
+ *                    resolved and the start of the stream is pre-buffered
+ *                    while the current video is playing.
+ *
+ * @returns 0 when the video was played to the end, 2 when the player was
+ *          stopped before and 1 on error.
+ */
+int player_play(player_t *player, const char *videoid, int buffersize, int fullscreen, const char *nextvideoid);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "quality.h"
+
+/** Link speed in bytes per second assumed before the first measurement, gives the sizes used before. */
+#define QUALITY_INITIAL_THROUGHPUT (100 * 1024)
+/** Smaller transfers are dominated by latency and not used for measuring. */
+#define QUALITY_MIN_SAMPLE 1024
+/** Weight of a new measurement is 1 / QUALITY_SMOOTHING. */
+#define QUALITY_SMOOTHING 4
+
+/** Properties of the thumbnail sizes. */
+static const struct {
+	int w;
+	int h;
+	/** Typical file size in bytes. */
+	unsigned int bytes;
+} quality_sizes[] = {
+	[QUALITY_DEFAULT] = { 120, 90, 4 * 1024 },
+	[QUALITY_MEDIUM] = { 320, 180, 12 * 1024 },
+	[QUALITY_HIGH] = { 480, 360, 28 * 1024 },
+};
+
+struct quality_s {
+	/** Estimated link speed in bytes per second. */
+	unsigned long throughput;
+	/** Memory budget for thumbnails. */
+	size_t budget;
+	/** Memory used by thumbnails. */
+	size_t memory;
+};
+
+quality_t *quality_alloc(size_t budget)
+{
+	quality_t *quality;
+
+	quality = malloc(sizeof(*quality));
+	if (quality == NULL) {
+		return NULL;
+	}
+	memset(quality, 0, sizeof(*quality));
+	quality->throughput = QUALITY_INITIAL_THROUGHPUT;
+	quality->budget = budget;
+	return quality;
+}
+
+void quality_free(quality_t *quality)
+{
+	if (quality != NULL) {
+		free(quality);
+	}
+}
+
+void quality_add_sample(quality_t *quality, size_t bytes, unsigned int ms)
+{
+	unsigned long throughput;
+
+	if (bytes < QUALITY_MIN_SAMPLE) {
+		return;
+	}
+	if (ms == 0) {
+		ms = 1;
+	}
+	throughput = (unsigned long long) bytes * 1000 / ms;
+	/* Exponential moving average, a single slow request doesn't change much. */
+	quality->throughput = (quality->throughput * (QUALITY_SMOOTHING - 1) + throughput) / QUALITY_SMOOTHING;
+}
+
+void quality_set_memory(quality_t *quality, size_t bytes)
+{
+	quality->memory = bytes;
+}
+
+enum quality_size quality_select(quality_t *quality, int w, int h, int count, unsigned int maxtime)
+{
+	enum quality_size max;
+	enum quality_size size;
+
+	/* The images are trimmed to the slot, so the first size covering it is enough. */
+	max = QUALITY_HIGH;
+	for (size = QUALITY_DEFAULT; size < QUALITY_HIGH; size++) {
+		if ((quality_sizes[size].w >= w) && (quality_sizes[size].h >= h)) {
+			max = size;
+			break;
+		}
+	}
+
+	if (quality->memory >= quality->budget) {
+		return QUALITY_DEFAULT;
+	}
+	if ((quality->memory >= quality->budget / 4 * 3) && (max > QUALITY_MEDIUM)) {
+		max = QUALITY_MEDIUM;
+	}
+
+	/* Largest size which can be loaded in time. */
+	for (size = max; size > QUALITY_DEFAULT; size--) {
+		unsigned long long ms;
+
+		ms = (unsigned long long) quality_sizes[size].bytes * count * 1000 / quality->throughput;
+		if (ms <= maxtime) {
+			break;
+		}
+	}
+	return size;
+}
+
+unsigned long quality_get_throughput(quality_t *quality)
+{
+	return quality->throughput;
+}
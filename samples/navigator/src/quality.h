@@ -0,0 +1,56 @@
+#ifndef _QUALITY_H_
+#define _QUALITY_H_
+
+#include <stddef.h>
+
+/** Thumbnail sizes provided by the YouTube API. */
+enum quality_size {
+	/** 120 x 90 */
+	QUALITY_DEFAULT,
+	/** 320 x 180 */
+	QUALITY_MEDIUM,
+	/** 480 x 360 */
+	QUALITY_HIGH
+};
+
+struct quality_s;
+
+typedef struct quality_s quality_t;
+
+/**
+ * Allocate policy for selecting thumbnail sizes.
+ *
+ * @param budget Memory in bytes which the thumbnails should use at most.
+ */
+quality_t *quality_alloc(size_t budget);
+
+void quality_free(quality_t *quality);
+
+/**
+ * Add a measurement of the link speed.
+ *
+ * @param bytes Bytes received.
+ * @param ms Time in milliseconds needed for receiving them.
+ */
+void quality_add_sample(quality_t *quality, size_t bytes, unsigned int ms);
+
+/** Set the memory currently used by thumbnails. */
+void quality_set_memory(quality_t *quality, size_t bytes);
+
+/**
+ * Select the thumbnail size for a slot on the screen. Larger sizes are only
+ * selected when they show more of the image in the slot, when they can be
+ * loaded within maxtime with the measured link speed and when the memory
+ * budget is not exceeded.
+ *
+ * @param w Width of the slot.
+ * @param h Height of the slot.
+ * @param count Number of thumbnails loaded together.
+ * @param maxtime Time in milliseconds which loading may take.
+ */
+enum quality_size quality_select(quality_t *quality, int w, int h, int count, unsigned int maxtime);
+
+/** Get the estimated link speed in bytes per second. */
+unsigned long quality_get_throughput(quality_t *quality);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _RAWPICTURE_H_
+#define _RAWPICTURE_H_
+
+/*
+ * Format of pictures converted at build time by tools/rawpicture.c. All
+ * values are stored little endian.
+ *
+ * Header, RAWPICTURE_HEADER_SIZE bytes:
+ *   magic, flags, width, height, bits per pixel, red mask, green mask, blue mask
+ *
+ * The pixels follow the header without padding at the end of a line. With
+ * RAWPICTURE_FLAG_RLE they are packed in runs, each starting with a 16 bit
+ * value: if RAWPICTURE_RLE_REPEAT is set one pixel follows which is
+ * repeated (value & RAWPICTURE_RLE_COUNT) + 1 times, otherwise
+ * (value + 1) different pixels follow.
+ */
+
+/** Identifies a raw picture ("JTPX"). */
+#define RAWPICTURE_MAGIC 0x5850544A
+/** Size of the header, keeps the pixels aligned. */
+#define RAWPICTURE_HEADER_SIZE 32
+/** Pixels are run length encoded. */
+#define RAWPICTURE_FLAG_RLE 1
+/** Run of a repeated pixel. */
+#define RAWPICTURE_RLE_REPEAT 0x8000
+/** Mask for the pixel count of a run. */
+#define RAWPICTURE_RLE_COUNT 0x7FFF
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "log.h"
+#include "snapshot.h"
+
+/** Identifies a snapshot file ("JTSN"). */
+#define SNAPSHOT_MAGIC 0x4E53544A
+/** Alignment of values in the file. */
+#define SNAPSHOT_ALIGN 4
+
+struct snapshot_s {
+	/** File being written, NULL when reading. */
+	FILE *fout;
+	/** Name of the snapshot file when writing. */
+	char *filename;
+	/** Name of the temporary file when writing. */
+	char *tmpname;
+	/** Number of bytes written. */
+	size_t written;
+	/** Mapped file when reading. */
+	unsigned char *mem;
+	/** Size of the mapped file. */
+	size_t size;
+	/** Read position in mem. */
+	size_t pos;
+	/** Set when an error happened. */
+	int error;
+};
+
+snapshot_t *snapshot_create(const char *filename, int version)
+{
+	snapshot_t *snap;
+
+	snap = malloc(sizeof(*snap));
+	if (snap == NULL) {
+		return NULL;
+	}
+	memset(snap, 0, sizeof(*snap));
+	snap->filename = strdup(filename);
+	if ((snap->filename == NULL) || (asprintf(&snap->tmpname, "%s.tmp", filename) == -1)) {
+		snap->tmpname = NULL;
+		snapshot_close(snap);
+		return NULL;
+	}
+	snap->fout = fopen(snap->tmpname, "wb");
+	if (snap->fout == NULL) {
+		LOG_ERROR("Failed to create %s: %s\n", snap->tmpname, strerror(errno));
+		snapshot_close(snap);
+		return NULL;
+	}
+	snapshot_put_int(snap, SNAPSHOT_MAGIC);
+	snapshot_put_int(snap, version);
+
+	return snap;
+}
+
+snapshot_t *snapshot_open(const char *filename, int version)
+{
+	snapshot_t *snap;
+	struct stat st;
+	void *mem;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if ((fstat(fd, &st) != 0) || (st.st_size < 2 * SNAPSHOT_ALIGN)) {
+		close(fd);
+		return NULL;
+	}
+	/* Private mapping, the thumbnails are used as pixel data of surfaces. */
+	mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		LOG_ERROR("Failed to map %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+
+	snap = malloc(sizeof(*snap));
+	if (snap == NULL) {
+		munmap(mem, st.st_size);
+		return NULL;
+	}
+	memset(snap, 0, sizeof(*snap));
+	snap->mem = mem;
+	snap->size = st.st_size;
+
+	if ((snapshot_get_int(snap) != SNAPSHOT_MAGIC) || (snapshot_get_int(snap) != version)) {
+		LOG("Ignoring snapshot %s with different format.\n", filename);
+		snapshot_close(snap);
+		return NULL;
+	}
+	return snap;
+}
+
+int snapshot_close(snapshot_t *snap)
+{
+	int rv;
+
+	if (snap == NULL) {
+		return -1;
+	}
+	if (snap->fout != NULL) {
+		if (fclose(snap->fout) != 0) {
+			snap->error = 1;
+		}
+		snap->fout = NULL;
+		if (!snap->error) {
+			if (rename(snap->tmpname, snap->filename) != 0) {
+				LOG_ERROR("Failed to rename %s: %s\n", snap->tmpname, strerror(errno));
+				snap->error = 1;
+			}
+		}
+		if (snap->error) {
+			unlink(snap->tmpname);
+		}
+	}
+	if (snap->mem != NULL) {
+		munmap(snap->mem, snap->size);
+		snap->mem = NULL;
+	}
+	if (snap->filename != NULL) {
+		free(snap->filename);
+		snap->filename = NULL;
+	}
+	if (snap->tmpname != NULL) {
+		free(snap->tmpname);
+		snap->tmpname = NULL;
+	}
+	rv = snap->error ? -1 : 0;
+	free(snap);
+	return rv;
+}
+
+/** Write bytes and pad them to the alignment. */
+static void snapshot_write(snapshot_t *snap, const void *data, size_t len)
+{
+	static const char pad[SNAPSHOT_ALIGN];
+	size_t padlen;
+
+	if ((snap->fout == NULL) || snap->error) {
+		return;
+	}
+	padlen = (SNAPSHOT_ALIGN - (len % SNAPSHOT_ALIGN)) % SNAPSHOT_ALIGN;
+	if ((len > 0) && (fwrite(data, len, 1, snap->fout) != 1)) {
+		snap->error = 1;
+	}
+	if ((padlen > 0) && (fwrite(pad, padlen, 1, snap->fout) != 1)) {
+		snap->error = 1;
+	}
+	if (snap->error) {
+		LOG_ERROR("Failed to write snapshot: %s\n", strerror(errno));
+	}
+	snap->written += len + padlen;
+}
+
+/** Get pointer to the next len bytes and skip them including the padding. */
+static void *snapshot_read(snapshot_t *snap, size_t len)
+{
+	void *data;
+	size_t padlen;
+
+	if ((snap->mem == NULL) || snap->error) {
+		return NULL;
+	}
+	padlen = (SNAPSHOT_ALIGN - (len % SNAPSHOT_ALIGN)) % SNAPSHOT_ALIGN;
+	if ((len + padlen) > (snap->size - snap->pos)) {
+		LOG_ERROR("Snapshot is truncated.\n");
+		snap->error = 1;
+		return NULL;
+	}
+	data = snap->mem + snap->pos;
+	snap->pos += len + padlen;
+	return data;
+}
+
+void snapshot_put_int(snapshot_t *snap, int value)
+{
+	snapshot_write(snap, &value, sizeof(value));
+}
+
+void snapshot_put_string(snapshot_t *snap, const char *str)
+{
+	if (str == NULL) {
+		snapshot_put_int(snap, -1);
+	} else {
+		size_t len = strlen(str);
+
+		snapshot_put_int(snap, len);
+		/* Including terminating zero, so that it can be used from the mapping. */
+		snapshot_write(snap, str, len + 1);
+	}
+}
+
+void snapshot_put_data(snapshot_t *snap, const void *data, size_t len)
+{
+	snapshot_put_int(snap, len);
+	snapshot_write(snap, data, len);
+}
+
+int snapshot_get_int(snapshot_t *snap)
+{
+	int value = 0;
+	void *data;
+
+	data = snapshot_read(snap, sizeof(value));
+	if (data != NULL) {
+		memcpy(&value, data, sizeof(value));
+	}
+	return value;
+}
+
+const char *snapshot_get_string(snapshot_t *snap)
+{
+	const char *str;
+	int len;
+
+	len = snapshot_get_int(snap);
+	if (len < 0) {
+		return NULL;
+	}
+	str = snapshot_read(snap, len + 1);
+	if ((str != NULL) && (str[len] != 0)) {
+		LOG_ERROR("Snapshot contains invalid string.\n");
+		snap->error = 1;
+		return NULL;
+	}
+	return str;
+}
+
+void *snapshot_get_data(snapshot_t *snap, size_t *len)
+{
+	int size;
+
+	*len = 0;
+	size = snapshot_get_int(snap);
+	if (size <= 0) {
+		return NULL;
+	}
+	*len = size;
+	return snapshot_read(snap, size);
+}
+
+int snapshot_error(snapshot_t *snap)
+{
+	return snap->error;
+}
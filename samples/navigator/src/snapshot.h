@@ -0,0 +1,65 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stddef.h>
+
+struct snapshot_s;
+
+typedef struct snapshot_s snapshot_t;
+
+/**
+ * Create a snapshot file. The data is written to a temporary file which
+ * replaces filename in snapshot_close(), so a mapped old snapshot stays
+ * valid.
+ *
+ * @param version Format version, checked by snapshot_open().
+ *
+ * @returns Handle for writing or NULL on error.
+ */
+snapshot_t *snapshot_create(const char *filename, int version);
+
+/**
+ * Map an existing snapshot file into memory.
+ *
+ * @returns Handle for reading or NULL when the file doesn't exist or has
+ *          another version.
+ */
+snapshot_t *snapshot_open(const char *filename, int version);
+
+/**
+ * Finish writing or unmap the snapshot. Data returned by
+ * snapshot_get_string() and snapshot_get_data() is invalid afterwards.
+ *
+ * @returns 0 on success, -1 if an error happened while writing or reading.
+ */
+int snapshot_close(snapshot_t *snap);
+
+/** Write an integer. */
+void snapshot_put_int(snapshot_t *snap, int value);
+
+/** Write a string, NULL is allowed. */
+void snapshot_put_string(snapshot_t *snap, const char *str);
+
+/** Write binary data, aligned to 4 bytes in the file. */
+void snapshot_put_data(snapshot_t *snap, const void *data, size_t len);
+
+/** Read an integer, 0 on error. */
+int snapshot_get_int(snapshot_t *snap);
+
+/** Read a string. The string is stored in the mapped file. */
+const char *snapshot_get_string(snapshot_t *snap);
+
+/**
+ * Read binary data. The data is stored in the mapped file and can be
+ * modified, changes are not written back.
+ *
+ * @param len Size of data is returned here.
+ *
+ * @returns Pointer to data aligned to 4 bytes or NULL if empty.
+ */
+void *snapshot_get_data(snapshot_t *snap, size_t *len);
+
+/** Check whether reading failed, e.g. because the file is truncated. */
+int snapshot_error(snapshot_t *snap);
+
+#endif
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "textcache.h"
+
+/** Number of hash buckets, must be a power of 2. */
+#define TEXTCACHE_BUCKETS 256
+
+typedef struct textcache_entry_s textcache_entry_t;
+
+/** Cached image of a text. */
+struct textcache_entry_s {
+	/** Hash value of the key. */
+	Uint32 hash;
+	/** Font used to render the text. */
+	TTF_Font *font;
+	/** Foreground color packed as 0xRRGGBB. */
+	Uint32 color;
+	/** The rendered text. */
+	SDL_Surface *sText;
+	/** Memory accounted for this entry. */
+	size_t size;
+	/** Next entry in the same hash bucket. */
+	textcache_entry_t *chain;
+	/** More recently used entry. */
+	textcache_entry_t *newer;
+	/** Less recently used entry. */
+	textcache_entry_t *older;
+	/** UTF-8 text, allocated together with the entry. */
+	char text[];
+};
+
+struct textcache_s {
+	/** Hash table. */
+	textcache_entry_t *bucket[TEXTCACHE_BUCKETS];
+	/** Most recently used entry. */
+	textcache_entry_t *newest;
+	/** Least recently used entry, removed first. */
+	textcache_entry_t *oldest;
+	/** Maximum memory used by the cache. */
+	size_t budget;
+	/** Memory currently used by the cache. */
+	size_t size;
+	/** Number of cached entries. */
+	unsigned int entries;
+	/** Number of lookups found in the cache. */
+	unsigned int hits;
+	/** Number of lookups which needed rendering. */
+	unsigned int misses;
+	/** Number of entries removed to stay in the budget. */
+	unsigned int evictions;
+};
+
+/** FNV-1a hash over the text, font and color. */
+static Uint32 textcache_hash(TTF_Font *font, Uint32 color, const char *text)
+{
+	Uint32 hash = 2166136261u;
+	const unsigned char *t;
+
+	for (t = (const unsigned char *) text; *t != 0; t++) {
+		hash = (hash ^ *t) * 16777619u;
+	}
+	hash = (hash ^ color) * 16777619u;
+	hash = (hash ^ ((Uint32) (unsigned long) font)) * 16777619u;
+
+	return hash;
+}
+
+textcache_t *textcache_alloc(size_t budget)
+{
+	textcache_t *cache;
+
+	cache = malloc(sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+	memset(cache, 0, sizeof(*cache));
+	cache->budget = budget;
+
+	return cache;
+}
+
+/** Remove entry from LRU list. */
+static void textcache_unlink(textcache_t *cache, textcache_entry_t *entry)
+{
+	if (entry->newer != NULL) {
+		entry->newer->older = entry->older;
+	} else {
+		cache->newest = entry->older;
+	}
+	if (entry->older != NULL) {
+		entry->older->newer = entry->newer;
+	} else {
+		cache->oldest = entry->newer;
+	}
+	entry->newer = NULL;
+	entry->older = NULL;
+}
+
+/** Insert entry as most recently used. */
+static void textcache_link(textcache_t *cache, textcache_entry_t *entry)
+{
+	entry->newer = NULL;
+	entry->older = cache->newest;
+	if (cache->newest != NULL) {
+		cache->newest->newer = entry;
+	}
+	cache->newest = entry;
+	if (cache->oldest == NULL) {
+		cache->oldest = entry;
+	}
+}
+
+/** Remove entry from cache and free it. */
+static void textcache_remove(textcache_t *cache, textcache_entry_t *entry)
+{
+	textcache_entry_t **prev;
+
+	prev = &cache->bucket[entry->hash & (TEXTCACHE_BUCKETS - 1)];
+	while (*prev != NULL) {
+		if (*prev == entry) {
+			*prev = entry->chain;
+			break;
+		}
+		prev = &(*prev)->chain;
+	}
+	textcache_unlink(cache, entry);
+
+	cache->size -= entry->size;
+	cache->entries--;
+	if (entry->sText != NULL) {
+		SDL_FreeSurface(entry->sText);
+		entry->sText = NULL;
+	}
+	free(entry);
+}
+
+void textcache_free(textcache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+	LOG("Text cache: %u hits, %u misses, %u evictions, %u entries, %lu bytes.\n",
+		cache->hits, cache->misses, cache->evictions, cache->entries,
+		(unsigned long) cache->size);
+	while (cache->oldest != NULL) {
+		textcache_remove(cache, cache->oldest);
+	}
+	free(cache);
+}
+
+SDL_Surface *textcache_get(textcache_t *cache, TTF_Font *font, SDL_Color color, const char *text)
+{
+	textcache_entry_t *entry;
+	SDL_Surface *sText;
+	Uint32 rgb;
+	Uint32 hash;
+	size_t len;
+
+	rgb = (color.r << 16) | (color.g << 8) | color.b;
+	hash = textcache_hash(font, rgb, text);
+	for (entry = cache->bucket[hash & (TEXTCACHE_BUCKETS - 1)]; entry != NULL; entry = entry->chain) {
+		if ((entry->hash == hash) && (entry->font == font) && (entry->color == rgb)
+			&& (strcmp(entry->text, text) == 0)) {
+			cache->hits++;
+			if (cache->newest != entry) {
+				textcache_unlink(cache, entry);
+				textcache_link(cache, entry);
+			}
+			entry->sText->refcount++;
+			return entry->sText;
+		}
+	}
+	cache->misses++;
+
+	sText = TTF_RenderUTF8_Solid(font, text, color);
+	if (sText == NULL) {
+		return NULL;
+	}
+
+	len = strlen(text);
+	entry = malloc(sizeof(*entry) + len + 1);
+	if (entry == NULL) {
+		/* Can still be used without caching. */
+		return sText;
+	}
+	memset(entry, 0, sizeof(*entry));
+	memcpy(entry->text, text, len + 1);
+	entry->hash = hash;
+	entry->font = font;
+	entry->color = rgb;
+	entry->sText = sText;
+	entry->size = sizeof(*entry) + len + 1 + sizeof(*sText) + sText->pitch * sText->h;
+
+	/* Remove least recently used entries to stay in the budget. */
+	while ((cache->oldest != NULL) && ((cache->size + entry->size) > cache->budget)) {
+		textcache_remove(cache, cache->oldest);
+		cache->evictions++;
+	}
+
+	entry->chain = cache->bucket[hash & (TEXTCACHE_BUCKETS - 1)];
+	cache->bucket[hash & (TEXTCACHE_BUCKETS - 1)] = entry;
+	textcache_link(cache, entry);
+	cache->size += entry->size;
+	cache->entries++;
+
+	/* One reference for the cache and one for the caller. */
+	sText->refcount++;
+	return sText;
+}
+
+void textcache_get_stats(textcache_t *cache, unsigned int *hits, unsigned int *misses, size_t *size)
+{
+	*hits = cache->hits;
+	*misses = cache->misses;
+	*size = cache->size;
+}
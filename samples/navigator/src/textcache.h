@@ -0,0 +1,36 @@
+#ifndef _TEXTCACHE_H_
+#define _TEXTCACHE_H_
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+struct textcache_s;
+
+typedef struct textcache_s textcache_t;
+
+/**
+ * Allocate cache for rendered text.
+ *
+ * @param budget Maximum memory in bytes used by the cached images.
+ */
+textcache_t *textcache_alloc(size_t budget);
+
+/** Free cache and all cached images. Statistics are logged. */
+void textcache_free(textcache_t *cache);
+
+/**
+ * Get the image of a text. The text is only rendered when it is not in the
+ * cache.
+ *
+ * @param font Font used for rendering.
+ * @param color Foreground color of the text.
+ * @param text UTF-8 text.
+ *
+ * @returns Image of the text with an additional reference. The caller needs
+ *          to release it with SDL_FreeSurface(). NULL on error.
+ */
+SDL_Surface *textcache_get(textcache_t *cache, TTF_Font *font, SDL_Color color, const char *text);
+
+void textcache_get_stats(textcache_t *cache, unsigned int *hits, unsigned int *misses, size_t *size);
+
+#endif
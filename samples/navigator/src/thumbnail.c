@@ -0,0 +1,505 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <SDL/SDL_image.h>
+
+#include "log.h"
+#include "thumbnail.h"
+
+/** Largest scale denominator supported by libjpeg. */
+#define MAX_SCALE_DENOM 8
+
+/** libjpeg error handler which returns to thumbnail_decode_jpeg(). */
+typedef struct {
+	struct jpeg_error_mgr pub;
+	jmp_buf setjmp_buffer;
+} thumbnail_error_t;
+
+static void thumbnail_error_exit(j_common_ptr cinfo)
+{
+	thumbnail_error_t *err = (thumbnail_error_t *) cinfo->err;
+	char msg[JMSG_LENGTH_MAX];
+
+	(*cinfo->err->format_message)(cinfo, msg);
+	LOG_ERROR("Failed to decode JPEG: %s\n", msg);
+	longjmp(err->setjmp_buffer, 1);
+}
+
+static void thumbnail_output_message(j_common_ptr cinfo)
+{
+	/* Ignore warnings about corrupt data, the image is still shown. */
+	(void) cinfo;
+}
+
+/* Source manager for reading the JPEG from memory. jpeg_mem_src() is not
+ * available in old libjpeg versions.
+ */
+static void thumbnail_init_source(j_decompress_ptr cinfo)
+{
+	(void) cinfo;
+}
+
+static boolean thumbnail_fill_input_buffer(j_decompress_ptr cinfo)
+{
+	static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+
+	/* Truncated image, insert end of image marker. */
+	cinfo->src->next_input_byte = eoi;
+	cinfo->src->bytes_in_buffer = sizeof(eoi);
+
+	return TRUE;
+}
+
+static void thumbnail_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
+{
+	struct jpeg_source_mgr *src = cinfo->src;
+
+	if (num_bytes <= 0) {
+		return;
+	}
+	if ((size_t) num_bytes > src->bytes_in_buffer) {
+		src->next_input_byte += src->bytes_in_buffer;
+		src->bytes_in_buffer = 0;
+		thumbnail_fill_input_buffer(cinfo);
+	} else {
+		src->next_input_byte += num_bytes;
+		src->bytes_in_buffer -= num_bytes;
+	}
+}
+
+static void thumbnail_term_source(j_decompress_ptr cinfo)
+{
+	(void) cinfo;
+}
+
+/** Check whether size divided by denom (rounded up) is at least max. */
+static int thumbnail_fits(JDIMENSION size, int denom, int max)
+{
+	if (max <= 0) {
+		return 1;
+	}
+	return ((int) ((size + denom - 1) / denom)) >= max;
+}
+
+/**
+ * Set output format and scaling after the header was read.
+ *
+ * @returns 0 on success, -1 if the color space is not supported.
+ */
+static int thumbnail_setup_output(j_decompress_ptr cinfo, int maxw, int maxh)
+{
+	int denom;
+
+	switch (cinfo->jpeg_color_space) {
+		case JCS_GRAYSCALE:
+			cinfo->out_color_space = JCS_GRAYSCALE;
+			break;
+
+		case JCS_YCbCr:
+		case JCS_RGB:
+			cinfo->out_color_space = JCS_RGB;
+			break;
+
+		default:
+			return -1;
+	}
+
+	/* Use the smallest scale which still covers the displayed size. */
+	denom = 1;
+	if ((maxw > 0) || (maxh > 0)) {
+		while ((denom < MAX_SCALE_DENOM)
+			&& thumbnail_fits(cinfo->image_width, 2 * denom, maxw)
+			&& thumbnail_fits(cinfo->image_height, 2 * denom, maxh)) {
+			denom *= 2;
+		}
+	}
+	cinfo->scale_num = 1;
+	cinfo->scale_denom = denom;
+	cinfo->dct_method = JDCT_IFAST;
+	return 0;
+}
+
+/** Displayed part of the decoded image. */
+typedef struct {
+	int x0;
+	int y0;
+	int w;
+	int h;
+} thumbnail_area_t;
+
+/**
+ * Allocate the surface for the output after jpeg_start_decompress(). The
+ * image is trimmed to the displayed size.
+ */
+static SDL_Surface *thumbnail_create_image(j_decompress_ptr cinfo, int maxw, int maxh, thumbnail_area_t *area)
+{
+	area->w = cinfo->output_width;
+	area->h = cinfo->output_height;
+	area->x0 = 0;
+	area->y0 = 0;
+	if ((maxw > 0) && (area->w > maxw)) {
+		area->x0 = (area->w - maxw) / 2;
+		area->w = maxw;
+	}
+	if ((maxh > 0) && (area->h > maxh)) {
+		area->y0 = (area->h - maxh) / 2;
+		area->h = maxh;
+	}
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	return SDL_CreateRGBSurface(SDL_SWSURFACE, area->w, area->h, 24, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+#else
+	return SDL_CreateRGBSurface(SDL_SWSURFACE, area->w, area->h, 24, 0x0000FF, 0x00FF00, 0xFF0000, 0);
+#endif
+}
+
+/** Copy a decoded line into the image, if it is in the displayed area. */
+static void thumbnail_copy_line(j_decompress_ptr cinfo, SDL_Surface *image, const thumbnail_area_t *area, int line, JSAMPROW row)
+{
+	Uint8 *dst;
+
+	if ((line < area->y0) || (line >= (area->y0 + area->h))) {
+		return;
+	}
+	dst = ((Uint8 *) image->pixels) + (line - area->y0) * image->pitch;
+	if (cinfo->output_components == 3) {
+		memcpy(dst, row + 3 * area->x0, 3 * area->w);
+	} else {
+		int x;
+
+		for (x = 0; x < area->w; x++) {
+			dst[3 * x + 0] = row[area->x0 + x];
+			dst[3 * x + 1] = row[area->x0 + x];
+			dst[3 * x + 2] = row[area->x0 + x];
+		}
+	}
+}
+
+/** Decode JPEG with libjpeg, using the DCT scaling to reduce the work. */
+static SDL_Surface *thumbnail_decode_jpeg(const void *mem, size_t size, int maxw, int maxh)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_source_mgr src;
+	thumbnail_error_t jerr;
+	SDL_Surface *volatile image = NULL;
+	thumbnail_area_t area;
+	JSAMPARRAY buffer;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = thumbnail_error_exit;
+	jerr.pub.output_message = thumbnail_output_message;
+	if (setjmp(jerr.setjmp_buffer)) {
+		jpeg_destroy_decompress(&cinfo);
+		if (image != NULL) {
+			SDL_FreeSurface(image);
+			image = NULL;
+		}
+		return NULL;
+	}
+	jpeg_create_decompress(&cinfo);
+
+	memset(&src, 0, sizeof(src));
+	src.init_source = thumbnail_init_source;
+	src.fill_input_buffer = thumbnail_fill_input_buffer;
+	src.skip_input_data = thumbnail_skip_input_data;
+	src.resync_to_restart = jpeg_resync_to_restart;
+	src.term_source = thumbnail_term_source;
+	src.next_input_byte = mem;
+	src.bytes_in_buffer = size;
+	cinfo.src = &src;
+
+	jpeg_read_header(&cinfo, TRUE);
+
+	if (thumbnail_setup_output(&cinfo, maxw, maxh) != 0) {
+		/* Let SDL_image handle it. */
+		jpeg_destroy_decompress(&cinfo);
+		return NULL;
+	}
+
+	jpeg_start_decompress(&cinfo);
+
+	image = thumbnail_create_image(&cinfo, maxw, maxh, &area);
+	if (image == NULL) {
+		jpeg_destroy_decompress(&cinfo);
+		return NULL;
+	}
+
+	buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE,
+		cinfo.output_width * cinfo.output_components, 1);
+
+	while (cinfo.output_scanline < cinfo.output_height) {
+		int line;
+
+		line = cinfo.output_scanline;
+		if (line >= (area.y0 + area.h)) {
+			/* The rest is not shown. */
+			break;
+		}
+		jpeg_read_scanlines(&cinfo, buffer, 1);
+		thumbnail_copy_line(&cinfo, image, &area, line, buffer[0]);
+	}
+	/* Also aborts when not all lines were read. */
+	jpeg_destroy_decompress(&cinfo);
+
+	return image;
+}
+
+/** Convert image to the screen format, blitting is faster then. */
+static SDL_Surface *thumbnail_display_format(SDL_Surface *image)
+{
+	SDL_Surface *converted;
+
+	converted = SDL_DisplayFormat(image);
+	if (converted != NULL) {
+		SDL_FreeSurface(image);
+		image = converted;
+	}
+	return image;
+}
+
+SDL_Surface *thumbnail_decode(const void *mem, size_t size, int maxw, int maxh)
+{
+	const unsigned char *data = mem;
+	SDL_Surface *image = NULL;
+
+	if ((size > 2) && (data[0] == 0xFF) && (data[1] == 0xD8)) {
+		image = thumbnail_decode_jpeg(mem, size, maxw, maxh);
+	}
+	if (image == NULL) {
+		SDL_RWops *rw = SDL_RWFromMem((void *) mem, size);
+
+		image = IMG_Load_RW(rw, 1);
+		rw = NULL;
+	}
+	if (image == NULL) {
+		return NULL;
+	}
+	return thumbnail_display_format(image);
+}
+
+/** Progress of decoding a stream. */
+enum thumbnail_stream_state {
+	/** Waiting for the JPEG header. */
+	THUMBNAIL_STREAM_HEADER,
+	/** Waiting for jpeg_start_decompress(). */
+	THUMBNAIL_STREAM_START,
+	/** Reading the lines of the image. */
+	THUMBNAIL_STREAM_LINES,
+	/** The image is complete. */
+	THUMBNAIL_STREAM_DONE,
+	/** Not a supported JPEG or an error happened. */
+	THUMBNAIL_STREAM_FAILED
+};
+
+struct thumbnail_stream_s {
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_source_mgr src;
+	thumbnail_error_t jerr;
+	enum thumbnail_stream_state state;
+	/** Start of the data given to the last thumbnail_stream_feed(). */
+	const JOCTET *base;
+	/** Bytes which need to be skipped when more data arrives. */
+	size_t skip;
+	/** Set when all data is available. */
+	int complete;
+	int maxw;
+	int maxh;
+	thumbnail_area_t area;
+	JSAMPARRAY buffer;
+	/** Image being decoded. */
+	SDL_Surface *image;
+};
+
+/* Suspending source manager, the data is given by thumbnail_stream_feed(). */
+static boolean thumbnail_stream_fill_input_buffer(j_decompress_ptr cinfo)
+{
+	thumbnail_stream_t *stream = cinfo->client_data;
+
+	if (!stream->complete) {
+		/* Suspend until more data arrives. */
+		return FALSE;
+	}
+	return thumbnail_fill_input_buffer(cinfo);
+}
+
+static void thumbnail_stream_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
+{
+	thumbnail_stream_t *stream = cinfo->client_data;
+	struct jpeg_source_mgr *src = cinfo->src;
+
+	if (num_bytes <= 0) {
+		return;
+	}
+	if ((size_t) num_bytes > src->bytes_in_buffer) {
+		/* Skip the rest when it arrives. */
+		stream->skip = num_bytes - src->bytes_in_buffer;
+		src->next_input_byte += src->bytes_in_buffer;
+		src->bytes_in_buffer = 0;
+	} else {
+		src->next_input_byte += num_bytes;
+		src->bytes_in_buffer -= num_bytes;
+	}
+}
+
+thumbnail_stream_t *thumbnail_stream_alloc(int maxw, int maxh)
+{
+	thumbnail_stream_t *stream;
+
+	stream = malloc(sizeof(*stream));
+	if (stream == NULL) {
+		return NULL;
+	}
+	memset(stream, 0, sizeof(*stream));
+	stream->maxw = maxw;
+	stream->maxh = maxh;
+
+	stream->cinfo.err = jpeg_std_error(&stream->jerr.pub);
+	stream->jerr.pub.error_exit = thumbnail_error_exit;
+	stream->jerr.pub.output_message = thumbnail_output_message;
+	jpeg_create_decompress(&stream->cinfo);
+	stream->cinfo.client_data = stream;
+
+	stream->src.init_source = thumbnail_init_source;
+	stream->src.fill_input_buffer = thumbnail_stream_fill_input_buffer;
+	stream->src.skip_input_data = thumbnail_stream_skip_input_data;
+	stream->src.resync_to_restart = jpeg_resync_to_restart;
+	stream->src.term_source = thumbnail_term_source;
+	stream->cinfo.src = &stream->src;
+
+	return stream;
+}
+
+void thumbnail_stream_free(thumbnail_stream_t *stream)
+{
+	if (stream == NULL) {
+		return;
+	}
+	jpeg_destroy_decompress(&stream->cinfo);
+	if (stream->image != NULL) {
+		SDL_FreeSurface(stream->image);
+		stream->image = NULL;
+	}
+	free(stream);
+}
+
+/** Read the available lines, returns 0 when suspended. */
+static int thumbnail_stream_read_lines(thumbnail_stream_t *stream)
+{
+	j_decompress_ptr cinfo = &stream->cinfo;
+
+	while (cinfo->output_scanline < cinfo->output_height) {
+		int line;
+
+		line = cinfo->output_scanline;
+		if (line >= (stream->area.y0 + stream->area.h)) {
+			/* The rest is not shown. */
+			break;
+		}
+		if (jpeg_read_scanlines(cinfo, stream->buffer, 1) != 1) {
+			return 0;
+		}
+		thumbnail_copy_line(cinfo, stream->image, &stream->area, line, stream->buffer[0]);
+	}
+	return 1;
+}
+
+/** Continue decoding with the available data. */
+static void thumbnail_stream_decode(thumbnail_stream_t *stream)
+{
+	j_decompress_ptr cinfo = &stream->cinfo;
+
+	for (;;) {
+		switch (stream->state) {
+			case THUMBNAIL_STREAM_HEADER:
+				if (jpeg_read_header(cinfo, TRUE) == JPEG_SUSPENDED) {
+					return;
+				}
+				if (thumbnail_setup_output(cinfo, stream->maxw, stream->maxh) != 0) {
+					stream->state = THUMBNAIL_STREAM_FAILED;
+					return;
+				}
+				stream->state = THUMBNAIL_STREAM_START;
+				break;
+
+			case THUMBNAIL_STREAM_START:
+				/* Progressive images suspend here until all scans are received. */
+				if (!jpeg_start_decompress(cinfo)) {
+					return;
+				}
+				stream->image = thumbnail_create_image(cinfo, stream->maxw, stream->maxh, &stream->area);
+				if (stream->image == NULL) {
+					stream->state = THUMBNAIL_STREAM_FAILED;
+					return;
+				}
+				stream->buffer = (*cinfo->mem->alloc_sarray)((j_common_ptr) cinfo, JPOOL_IMAGE,
+					cinfo->output_width * cinfo->output_components, 1);
+				stream->state = THUMBNAIL_STREAM_LINES;
+				break;
+
+			case THUMBNAIL_STREAM_LINES:
+				if (!thumbnail_stream_read_lines(stream)) {
+					return;
+				}
+				stream->state = THUMBNAIL_STREAM_DONE;
+				break;
+
+			case THUMBNAIL_STREAM_DONE:
+			case THUMBNAIL_STREAM_FAILED:
+				return;
+		}
+	}
+}
+
+int thumbnail_stream_feed(thumbnail_stream_t *stream, const void *mem, size_t size, int complete)
+{
+	const JOCTET *data = mem;
+	size_t pos;
+
+	if ((stream->state == THUMBNAIL_STREAM_DONE) || (stream->state == THUMBNAIL_STREAM_FAILED)) {
+		return (stream->state == THUMBNAIL_STREAM_DONE) ? 0 : -1;
+	}
+	if ((stream->base == NULL) && (size >= 2) && ((data[0] != 0xFF) || (data[1] != 0xD8))) {
+		/* Not a JPEG. */
+		stream->state = THUMBNAIL_STREAM_FAILED;
+		return -1;
+	}
+
+	/* The buffer can be moved when it grows, keep the read position. */
+	pos = (stream->base != NULL) ? (size_t) (stream->src.next_input_byte - stream->base) : 0;
+	pos += stream->skip;
+	if (pos > size) {
+		stream->skip = pos - size;
+		pos = size;
+	} else {
+		stream->skip = 0;
+	}
+	stream->base = data;
+	stream->src.next_input_byte = data + pos;
+	stream->src.bytes_in_buffer = size - pos;
+	stream->complete = complete;
+
+	if (setjmp(stream->jerr.setjmp_buffer)) {
+		stream->state = THUMBNAIL_STREAM_FAILED;
+		return -1;
+	}
+	thumbnail_stream_decode(stream);
+
+	if (stream->state == THUMBNAIL_STREAM_FAILED) {
+		return -1;
+	}
+	return (stream->state == THUMBNAIL_STREAM_DONE) ? 0 : 1;
+}
+
+SDL_Surface *thumbnail_stream_get_image(thumbnail_stream_t *stream)
+{
+	SDL_Surface *image;
+
+	if (stream->state != THUMBNAIL_STREAM_DONE) {
+		return NULL;
+	}
+	image = stream->image;
+	stream->image = NULL;
+	return thumbnail_display_format(image);
+}
@@ -0,0 +1,55 @@
+#ifndef _THUMBNAIL_H_
+#define _THUMBNAIL_H_
+
+#include <SDL/SDL.h>
+
+/**
+ * Decode a thumbnail image in memory and convert it to the screen format.
+ * JPEG images are decoded at a reduced scale when the image is at least
+ * twice as large as needed. Afterwards the image is trimmed to maxw x maxh
+ * (centered). Other image formats are decoded by SDL_image.
+ *
+ * @param mem Image file content.
+ * @param size Size of mem in bytes.
+ * @param maxw Maximum width shown on screen, 0 for no limit.
+ * @param maxh Maximum height shown on screen, 0 for no limit.
+ *
+ * @returns Decoded image or NULL on error.
+ */
+SDL_Surface *thumbnail_decode(const void *mem, size_t size, int maxw, int maxh);
+
+struct thumbnail_stream_s;
+
+typedef struct thumbnail_stream_s thumbnail_stream_t;
+
+/**
+ * Allocate a decoder which decodes a JPEG while it is received. The image
+ * is scaled and trimmed like in thumbnail_decode().
+ */
+thumbnail_stream_t *thumbnail_stream_alloc(int maxw, int maxh);
+
+/** Free decoder and all images not taken. */
+void thumbnail_stream_free(thumbnail_stream_t *stream);
+
+/**
+ * Continue decoding with more data. The data is not copied, so the
+ * complete content received so far must be passed each time. The buffer
+ * may move between calls.
+ *
+ * @param mem All data received so far.
+ * @param size Size of mem in bytes.
+ * @param complete Set when no more data follows.
+ *
+ * @returns 1 when more data is needed, 0 when the image is complete, -1 if
+ *          the data is no supported JPEG or can't be decoded.
+ */
+int thumbnail_stream_feed(thumbnail_stream_t *stream, const void *mem, size_t size, int complete);
+
+/**
+ * Take the decoded image.
+ *
+ * @returns Image in screen format or NULL if it is not complete.
+ */
+SDL_Surface *thumbnail_stream_get_image(thumbnail_stream_t *stream);
+
+#endif
@@ -1,3 +1,7 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -6,19 +10,96 @@
 #include "log.h"
 #include "transfer.h"
 
+/** Environment variable with a directory for recording and replaying transfers. */
+#define TRANSFER_REPLAY_ENV "NAVIGATOR_REPLAY_DIR"
+/** Maximum time in milliseconds to wait for activity of a batch. */
+#define TRANSFER_WAIT_TIME 100
+/** Largest Content-Length used for allocating the buffer in advance. */
+#define TRANSFER_MAX_PRESIZE (4 * 1024 * 1024)
+/** Receive buffers up to this size are kept for the next transfer. */
+#define TRANSFER_KEEP_SIZE (256 * 1024)
+/** A request passed over this often by more urgent ones is started next. */
+#define TRANSFER_STARVE_LIMIT 8
 
-struct transfer_s {
-	CURL *curl;
+/** Maximum number of concurrent transfers of each priority class. */
+static const int transfer_limit[TRANSFER_PRIORITY_COUNT] = {
+	TRANSFER_BATCH_MAX,
+	6,
+	2
 };
 
 /** Needed to load web content to memory. */
 struct transfer_chunk_s {
 	char *memory;
 	size_t size;
+	/** Allocated size of memory. */
+	size_t alloc;
+	/** Handle used to get the Content-Length. */
+	CURL *curl;
 };
 
 typedef struct transfer_chunk_s transfer_chunk_t;
 
+/** Transfer running in a batch. */
+typedef struct {
+	/** Handle, kept for the next batch. */
+	CURL *curl;
+	/** Received data, the buffer is reused by the next transfer. */
+	transfer_chunk_t chunk;
+	/** Number of bytes already passed to the data callback. */
+	size_t reported;
+	/** Request being processed, NULL if unused. */
+	const transfer_request_t *req;
+	/** File for recording the content, NULL if not used. */
+	char *replayfile;
+} transfer_slot_t;
+
+struct transfer_s {
+	CURL *curl;
+	/** Directory with recorded transfers, NULL if not used. */
+	const char *replaydir;
+	/** Handle for concurrent transfers, created by the first batch. */
+	CURLM *multi;
+	/** Transfers of a batch. */
+	transfer_slot_t slot[TRANSFER_BATCH_MAX];
+	/** Checks whether queued requests should be dropped, NULL if not used. */
+	int (*preempt)(void *ctx);
+	void *preemptctx;
+	/** DNS cache, TLS sessions and connections shared by all handles. */
+	CURLSH *share;
+	/** Handles connecting in advance. */
+	CURL *warmup[TRANSFER_WARMUP_MAX];
+	/** Number of handles in warmup. */
+	int warmups;
+};
+
+/** Number of transfers (also replayed ones). */
+static unsigned long transfer_requests;
+/** Number of bytes received (also replayed ones). */
+static unsigned long long transfer_bytes;
+
+/** Get the Content-Length of the transfer, 0 if unknown. */
+static size_t transfer_content_length(CURL *curl)
+{
+#if LIBCURL_VERSION_NUM >= 0x073700
+	curl_off_t length = -1;
+
+	if (curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) != CURLE_OK) {
+		return 0;
+	}
+#else
+	double length = -1;
+
+	if (curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &length) != CURLE_OK) {
+		return 0;
+	}
+#endif
+	if ((length <= 0) || (length > TRANSFER_MAX_PRESIZE)) {
+		return 0;
+	}
+	return length;
+}
+
 /** Callback for loading web content via CURL to memory. */
 static size_t mem_callback(void *contents, size_t size, size_t nmemb,
 	void *userp)
@@ -26,10 +107,29 @@ static size_t mem_callback(void *contents, size_t size, size_t nmemb,
 	size_t realsize = size * nmemb;
 	transfer_chunk_t *mem = userp;
 
-	mem->memory = realloc(mem->memory, mem->size + realsize + 1);
-	if(mem->memory == NULL) {
-		LOG_ERROR("Not enough memory (realloc returned NULL).\n");
-		return 0;
+	if ((mem->size + realsize + 1) > mem->alloc) {
+		size_t alloc;
+		char *memory;
+
+		/* Grow geometrically, but allocate the whole content at once if known. */
+		alloc = 2 * mem->alloc;
+		if ((mem->size == 0) && (mem->curl != NULL)) {
+			size_t length = transfer_content_length(mem->curl);
+
+			if (alloc < (length + 1)) {
+				alloc = length + 1;
+			}
+		}
+		if (alloc < (mem->size + realsize + 1)) {
+			alloc = mem->size + realsize + 1;
+		}
+		memory = realloc(mem->memory, alloc);
+		if (memory == NULL) {
+			LOG_ERROR("Not enough memory (realloc returned NULL).\n");
+			return 0;
+		}
+		mem->memory = memory;
+		mem->alloc = alloc;
 	}
 	memcpy(&(mem->memory[mem->size]), contents, realsize);
 	mem->size += realsize;
@@ -38,6 +138,15 @@ static size_t mem_callback(void *contents, size_t size, size_t nmemb,
 	return realsize;
 }
 
+/** Callback dropping data of connections made in advance. */
+static size_t discard_callback(void *contents, size_t size, size_t nmemb,
+	void *userp)
+{
+	(void) contents;
+	(void) userp;
+	return size * nmemb;
+}
+
 void transfer_init(void)
 {
 	/* Initialize CURL. This used to transfer the web content. */
@@ -49,11 +158,34 @@ void transfer_cleanup(void)
 	curl_global_cleanup();
 }
 
+/** Set options used for all transfers. */
+static void transfer_setup(transfer_t *transfer, CURL *curl)
+{
+	const char *capath;
+
+	if (transfer->share != NULL) {
+		curl_easy_setopt(curl, CURLOPT_SHARE, transfer->share);
+	}
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mem_callback);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+#ifdef NOVERIFYCERT
+	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+#endif
+
+	capath = getenv("SSL_CERT_PATH");
+	if (capath != NULL) {
+		curl_easy_setopt(curl, CURLOPT_CAPATH, capath);
+	}
+	capath = getenv("SSL_CERT_FILE");
+	if (capath != NULL) {
+		curl_easy_setopt(curl, CURLOPT_CAINFO, capath);
+	}
+}
+
 /** Get CURL object for transfering web content. */
 transfer_t *transfer_alloc(void)
 {
 	transfer_t *transfer;
-	const char *capath;
 
 	transfer = malloc(sizeof(*transfer));
 	if (transfer == NULL) {
@@ -61,25 +193,26 @@ transfer_t *transfer_alloc(void)
 	}
 	memset(transfer, 0, sizeof(*transfer));
 
+	transfer->share = curl_share_init();
+	if (transfer->share != NULL) {
+		curl_share_setopt(transfer->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(transfer->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+		curl_share_setopt(transfer->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+	}
+
 	transfer->curl = curl_easy_init();
 	if (transfer->curl == NULL) {
 		LOG_ERROR("Failed to get CURL object. Out of memory?\n");
+		transfer_free(transfer);
+		transfer = NULL;
 		return NULL;
 	}
-	curl_easy_setopt(transfer->curl, CURLOPT_WRITEFUNCTION, mem_callback);
-	curl_easy_setopt(transfer->curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-#ifdef NOVERIFYCERT
-	curl_easy_setopt(transfer->curl, CURLOPT_SSL_VERIFYPEER, 0L);
-#endif
+	transfer_setup(transfer, transfer->curl);
 
-	capath = getenv("SSL_CERT_PATH");
-	if (capath != NULL) {
-		curl_easy_setopt(transfer->curl, CURLOPT_CAPATH, capath);
-	}
-	capath = getenv("SSL_CERT_FILE");
-	if (capath != NULL) {
-		curl_easy_setopt(transfer->curl, CURLOPT_CAINFO, capath);
-	}
+	/* Benchmarks can replay recorded content instead of using the network. */
+	transfer->replaydir = getenv(TRANSFER_REPLAY_ENV);
 
 	return transfer;
 }
@@ -88,23 +221,132 @@ transfer_t *transfer_alloc(void)
 void transfer_free(transfer_t *transfer)
 {
 	if (transfer != NULL) {
+		int i;
+
 		if (transfer->curl != NULL) {
 			curl_easy_cleanup(transfer->curl);
 			transfer->curl = NULL;
 		}
+		for (i = 0; i < TRANSFER_BATCH_MAX; i++) {
+			if (transfer->slot[i].curl != NULL) {
+				curl_easy_cleanup(transfer->slot[i].curl);
+				transfer->slot[i].curl = NULL;
+			}
+			if (transfer->slot[i].chunk.memory != NULL) {
+				free(transfer->slot[i].chunk.memory);
+				transfer->slot[i].chunk.memory = NULL;
+			}
+		}
+		for (i = 0; i < transfer->warmups; i++) {
+			curl_multi_remove_handle(transfer->multi, transfer->warmup[i]);
+			curl_easy_cleanup(transfer->warmup[i]);
+			transfer->warmup[i] = NULL;
+		}
+		transfer->warmups = 0;
+		if (transfer->multi != NULL) {
+			curl_multi_cleanup(transfer->multi);
+			transfer->multi = NULL;
+		}
+		/* All handles using it are freed. */
+		if (transfer->share != NULL) {
+			curl_share_cleanup(transfer->share);
+			transfer->share = NULL;
+		}
 		free(transfer);
 		transfer = NULL;
 	}
 }
 
+/** Get file name in the replay directory for an URL. */
+static char *transfer_replay_file(transfer_t *transfer, const char *url)
+{
+	unsigned int hash = 2166136261u;
+	const unsigned char *u;
+	char *filename = NULL;
+
+	for (u = (const unsigned char *) url; *u != 0; u++) {
+		hash = (hash ^ *u) * 16777619u;
+	}
+	if (asprintf(&filename, "%s/%08x", transfer->replaydir, hash) == -1) {
+		return NULL;
+	}
+	return filename;
+}
+
+/** Load recorded content. */
+static size_t transfer_replay_load(const char *filename, void **mem)
+{
+	FILE *fin;
+	char *buffer;
+	long size;
+
+	fin = fopen(filename, "rb");
+	if (fin == NULL) {
+		return 0;
+	}
+	if ((fseek(fin, 0, SEEK_END) != 0) || ((size = ftell(fin)) <= 0) || (fseek(fin, 0, SEEK_SET) != 0)) {
+		fclose(fin);
+		return 0;
+	}
+	buffer = malloc(size + 1);
+	if (buffer == NULL) {
+		fclose(fin);
+		return 0;
+	}
+	if (fread(buffer, size, 1, fin) != 1) {
+		free(buffer);
+		fclose(fin);
+		return 0;
+	}
+	fclose(fin);
+	buffer[size] = 0;
+	*mem = buffer;
+	return size;
+}
+
+/** Record content for replaying it later. */
+static void transfer_replay_save(const char *filename, const void *mem, size_t size)
+{
+	FILE *fout;
+
+	fout = fopen(filename, "wb");
+	if (fout == NULL) {
+		LOG_ERROR("Failed to record %s.\n", filename);
+		return;
+	}
+	if (fwrite(mem, size, 1, fout) != 1) {
+		LOG_ERROR("Failed to record %s.\n", filename);
+	}
+	fclose(fout);
+}
+
 /** Load binary data via URL from the internet. */
 size_t transfer_binary(transfer_t *transfer, const char *url, void **mem)
 {
 	CURLcode res;
 	transfer_chunk_t chunk;
+	char *replayfile = NULL;
 
 	chunk.memory = NULL;
 	chunk.size = 0;
+	chunk.alloc = 0;
+	chunk.curl = transfer->curl;
+
+	if (transfer->replaydir != NULL) {
+		size_t size;
+
+		replayfile = transfer_replay_file(transfer, url);
+		if (replayfile != NULL) {
+			size = transfer_replay_load(replayfile, mem);
+			if (size > 0) {
+				transfer_requests++;
+				transfer_bytes += size;
+				free(replayfile);
+				replayfile = NULL;
+				return size;
+			}
+		}
+	}
 
 	curl_easy_setopt(transfer->curl, CURLOPT_URL, url);
 	curl_easy_setopt(transfer->curl, CURLOPT_WRITEDATA, (void *)&chunk);
@@ -116,15 +358,411 @@ size_t transfer_binary(transfer_t *transfer, const char *url, void **mem)
 		chunk.size = 0;
 	}
 
+	transfer_requests++;
+	transfer_bytes += chunk.size;
+
 	if (chunk.size <= 0) {
 		if (chunk.memory != NULL) {
 			free(chunk.memory);
 			chunk.memory = NULL;
 		}
 	} else {
+		if (replayfile != NULL) {
+			/* Not recorded yet. */
+			transfer_replay_save(replayfile, chunk.memory, chunk.size);
+		}
 		*mem = chunk.memory;
 	}
+	if (replayfile != NULL) {
+		free(replayfile);
+		replayfile = NULL;
+	}
 
 	return chunk.size;
 }
 
+/**
+ * Start a transfer of a batch in a free slot. Recorded content is
+ * delivered immediately.
+ *
+ * @returns 1 if the transfer is running, 0 if it is already finished.
+ */
+static int transfer_batch_start(transfer_t *transfer, const transfer_request_t *req, transfer_done_t done)
+{
+	transfer_slot_t *slot = NULL;
+	char *replayfile = NULL;
+	int i;
+
+	if (transfer->replaydir != NULL) {
+		void *mem = NULL;
+		size_t size;
+
+		replayfile = transfer_replay_file(transfer, req->url);
+		if (replayfile != NULL) {
+			size = transfer_replay_load(replayfile, &mem);
+			if (size > 0) {
+				transfer_requests++;
+				transfer_bytes += size;
+				free(replayfile);
+				replayfile = NULL;
+				done(req->ctx, mem, size);
+				free(mem);
+				mem = NULL;
+				return 0;
+			}
+		}
+	}
+
+	for (i = 0; i < TRANSFER_BATCH_MAX; i++) {
+		if (transfer->slot[i].req == NULL) {
+			slot = &transfer->slot[i];
+			break;
+		}
+	}
+	if ((slot != NULL) && (slot->curl == NULL)) {
+		slot->curl = curl_easy_init();
+		if (slot->curl != NULL) {
+			transfer_setup(transfer, slot->curl);
+			curl_easy_setopt(slot->curl, CURLOPT_PRIVATE, slot);
+#if LIBCURL_VERSION_NUM >= 0x072f00
+			/* Thumbnails come from the same host, use HTTP/2 when possible. */
+			curl_easy_setopt(slot->curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00
+			/* Wait for a connection which can be multiplexed instead of opening new ones. */
+			curl_easy_setopt(slot->curl, CURLOPT_PIPEWAIT, 1L);
+#endif
+		}
+	}
+	if ((slot == NULL) || (slot->curl == NULL)) {
+		if (replayfile != NULL) {
+			free(replayfile);
+			replayfile = NULL;
+		}
+		done(req->ctx, NULL, 0);
+		return 0;
+	}
+
+	slot->req = req;
+	slot->replayfile = replayfile;
+	slot->reported = 0;
+	/* The buffer of the last transfer is reused. */
+	slot->chunk.size = 0;
+	slot->chunk.curl = slot->curl;
+	curl_easy_setopt(slot->curl, CURLOPT_URL, req->url);
+	curl_easy_setopt(slot->curl, CURLOPT_WRITEDATA, (void *)&slot->chunk);
+	curl_multi_add_handle(transfer->multi, slot->curl);
+	return 1;
+}
+
+/** Deliver the result of a finished transfer and release the slot. */
+static void transfer_batch_finish(transfer_t *transfer, transfer_slot_t *slot, CURLcode res, transfer_done_t done)
+{
+	const transfer_request_t *req = slot->req;
+
+	curl_multi_remove_handle(transfer->multi, slot->curl);
+	if (res != CURLE_OK) {
+		LOG_ERROR("Transfer failed: %d %s url %s\n",
+			res, curl_easy_strerror(res), req->url);
+		slot->chunk.size = 0;
+	}
+
+	transfer_requests++;
+	transfer_bytes += slot->chunk.size;
+
+	if ((slot->chunk.size > 0) && (slot->replayfile != NULL)) {
+		/* Not recorded yet. */
+		transfer_replay_save(slot->replayfile, slot->chunk.memory, slot->chunk.size);
+	}
+	if (slot->replayfile != NULL) {
+		free(slot->replayfile);
+		slot->replayfile = NULL;
+	}
+	slot->req = NULL;
+
+	/* No copy, the callback uses the receive buffer. */
+	done(req->ctx, (slot->chunk.size > 0) ? slot->chunk.memory : NULL, slot->chunk.size);
+	slot->chunk.size = 0;
+	if (slot->chunk.alloc > TRANSFER_KEEP_SIZE) {
+		free(slot->chunk.memory);
+		slot->chunk.memory = NULL;
+		slot->chunk.alloc = 0;
+	}
+}
+
+/**
+ * Create the handle for concurrent transfers when it is needed first.
+ *
+ * @returns 0 on success.
+ */
+static int transfer_multi(transfer_t *transfer)
+{
+	if (transfer->multi != NULL) {
+		return 0;
+	}
+	transfer->multi = curl_multi_init();
+	if (transfer->multi == NULL) {
+		LOG_ERROR("Failed to get CURL multi object. Out of memory?\n");
+		return -1;
+	}
+#ifdef CURLPIPE_MULTIPLEX
+	curl_multi_setopt(transfer->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+	return 0;
+}
+
+/** Release the handle of a finished connection made in advance. The connection stays cached. */
+static void transfer_warmup_finish(transfer_t *transfer, CURL *curl, CURLcode res)
+{
+	char *url = NULL;
+	int i;
+
+	for (i = 0; i < transfer->warmups; i++) {
+		if (transfer->warmup[i] == curl) {
+			curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+			if (res != CURLE_OK) {
+				LOG_ERROR("Failed to connect in advance: %d %s url %s\n",
+					res, curl_easy_strerror(res), (url != NULL) ? url : "");
+			} else {
+				LOG("Connected in advance to %s\n", (url != NULL) ? url : "");
+			}
+			curl_multi_remove_handle(transfer->multi, curl);
+			curl_easy_cleanup(curl);
+			transfer->warmups--;
+			transfer->warmup[i] = transfer->warmup[transfer->warmups];
+			transfer->warmup[transfer->warmups] = NULL;
+			return;
+		}
+	}
+}
+
+void transfer_warmup(transfer_t *transfer, const char *const *urls, int count)
+{
+	int i;
+
+	if (transfer->replaydir != NULL) {
+		/* Replay doesn't use the network. */
+		return;
+	}
+	if (transfer_multi(transfer) != 0) {
+		return;
+	}
+	for (i = 0; (i < count) && (transfer->warmups < TRANSFER_WARMUP_MAX); i++) {
+		CURL *curl;
+
+		curl = curl_easy_init();
+		if (curl == NULL) {
+			break;
+		}
+		transfer_setup(transfer, curl);
+		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_callback);
+		curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+		curl_easy_setopt(curl, CURLOPT_URL, urls[i]);
+		curl_multi_add_handle(transfer->multi, curl);
+		transfer->warmup[transfer->warmups] = curl;
+		transfer->warmups++;
+	}
+	transfer_poll(transfer);
+}
+
+void transfer_poll(transfer_t *transfer)
+{
+	CURLMsg *msg;
+	int running;
+	int left;
+
+	if (transfer->warmups == 0) {
+		return;
+	}
+	curl_multi_perform(transfer->multi, &running);
+	while ((msg = curl_multi_info_read(transfer->multi, &left)) != NULL) {
+		if (msg->msg == CURLMSG_DONE) {
+			/* msg is invalid after removing the handle. */
+			transfer_warmup_finish(transfer, msg->easy_handle, msg->data.result);
+		}
+	}
+}
+
+CURLSH *transfer_get_share(transfer_t *transfer)
+{
+	return transfer->share;
+}
+
+void transfer_set_preempt(transfer_t *transfer, int (*preempt)(void *ctx), void *ctx)
+{
+	transfer->preempt = preempt;
+	transfer->preemptctx = ctx;
+}
+
+/** Get the priority class of a request, unknown values are background work. */
+static enum transfer_priority transfer_priority(const transfer_request_t *req)
+{
+	if ((req->priority < 0) || (req->priority >= TRANSFER_PRIORITY_COUNT)) {
+		return TRANSFER_PRIORITY_BACKGROUND;
+	}
+	return req->priority;
+}
+
+/**
+ * Select the queued request which is started next.
+ *
+ * @param passed Number of times each request was passed over, -1 when it
+ *               isn't queued anymore.
+ *
+ * @returns Index of the request or -1 if no class has a free slot.
+ */
+static int transfer_batch_next(transfer_t *transfer, const transfer_request_t *req, int count, int *passed)
+{
+	int running[TRANSFER_PRIORITY_COUNT];
+	int best = -1;
+	int i;
+
+	memset(running, 0, sizeof(running));
+	for (i = 0; i < TRANSFER_BATCH_MAX; i++) {
+		if (transfer->slot[i].req != NULL) {
+			running[transfer_priority(transfer->slot[i].req)]++;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		enum transfer_priority prio;
+
+		if (passed[i] < 0) {
+			continue;
+		}
+		prio = transfer_priority(&req[i]);
+		if (running[prio] >= transfer_limit[prio]) {
+			continue;
+		}
+		if (passed[i] >= TRANSFER_STARVE_LIMIT) {
+			best = i;
+			break;
+		}
+		if ((best < 0) || (prio < transfer_priority(&req[best]))) {
+			best = i;
+		}
+	}
+	if (best < 0) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		if ((passed[i] >= 0) && (transfer_priority(&req[i]) > transfer_priority(&req[best]))) {
+			passed[i]++;
+		}
+	}
+	passed[best] = -1;
+	return best;
+}
+
+/**
+ * Drop the queued requests which are not visible.
+ *
+ * @returns Number of dropped requests.
+ */
+static int transfer_batch_preempt(const transfer_request_t *req, int count, int *passed)
+{
+	int dropped = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if ((passed[i] >= 0) && (transfer_priority(&req[i]) != TRANSFER_PRIORITY_VISIBLE)) {
+			passed[i] = -1;
+			dropped++;
+		}
+	}
+	return dropped;
+}
+
+/** Load several URLs concurrently. */
+int transfer_batch(transfer_t *transfer, const transfer_request_t *req, int count, transfer_done_t done)
+{
+	int *passed;
+	int active = 0;
+	int queued = count;
+	int dropped = 0;
+	int next;
+
+	if (count <= 0) {
+		return 0;
+	}
+	if (transfer_multi(transfer) != 0) {
+		for (next = 0; next < count; next++) {
+			done(req[next].ctx, NULL, 0);
+		}
+		return 0;
+	}
+	passed = calloc(count, sizeof(*passed));
+	if (passed == NULL) {
+		LOG_ERROR("Not enough memory for %d requests.\n", count);
+		for (next = 0; next < count; next++) {
+			done(req[next].ctx, NULL, 0);
+		}
+		return 0;
+	}
+
+	while ((queued > 0) || (active > 0)) {
+		CURLMsg *msg;
+		int running;
+		int left;
+		int i;
+
+		if ((queued > 0) && (transfer->preempt != NULL) && transfer->preempt(transfer->preemptctx)) {
+			i = transfer_batch_preempt(req, count, passed);
+			queued -= i;
+			dropped += i;
+		}
+		while ((queued > 0) && (active < TRANSFER_BATCH_MAX)) {
+			next = transfer_batch_next(transfer, req, count, passed);
+			if (next < 0) {
+				/* All classes with queued requests are at their limit. */
+				break;
+			}
+			queued--;
+			active += transfer_batch_start(transfer, &req[next], done);
+		}
+		if (active == 0) {
+			continue;
+		}
+
+		curl_multi_perform(transfer->multi, &running);
+		for (i = 0; i < TRANSFER_BATCH_MAX; i++) {
+			transfer_slot_t *slot = &transfer->slot[i];
+
+			if ((slot->req != NULL) && (slot->req->data != NULL) && (slot->chunk.size > slot->reported)) {
+				/* Allow processing while the rest is received. */
+				slot->reported = slot->chunk.size;
+				slot->req->data(slot->req->ctx, slot->chunk.memory, slot->chunk.size);
+			}
+		}
+		while ((msg = curl_multi_info_read(transfer->multi, &left)) != NULL) {
+			if (msg->msg == CURLMSG_DONE) {
+				transfer_slot_t *slot = NULL;
+
+				curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &slot);
+				if (slot != NULL) {
+					/* msg is invalid after removing the handle. */
+					transfer_batch_finish(transfer, slot, msg->data.result, done);
+					active--;
+				} else {
+					transfer_warmup_finish(transfer, msg->easy_handle, msg->data.result);
+				}
+			}
+		}
+		if (active > 0) {
+			curl_multi_wait(transfer->multi, NULL, 0, TRANSFER_WAIT_TIME, NULL);
+		}
+	}
+	free(passed);
+	passed = NULL;
+	if (dropped > 0) {
+		LOG("%d queued requests were preempted.\n", dropped);
+	}
+	return dropped;
+}
+
+/** Get number of requests and received bytes of all transfers. */
+void transfer_get_stats(unsigned long *requests, unsigned long long *bytes)
+{
+	*requests = transfer_requests;
+	*bytes = transfer_bytes;
+}
+
@@ -1,14 +1,116 @@
 #ifndef _TRANSFER_H_
 #define _TRANSFER_H_
 
+#include <stddef.h>
+#include <curl/curl.h>
+
+/** Maximum number of concurrent transfers of a batch. */
+#define TRANSFER_BATCH_MAX 16
+/** Maximum number of hosts connected in advance. */
+#define TRANSFER_WARMUP_MAX 4
+
+/** Priority classes of requests, from the most to the least urgent. */
+enum transfer_priority {
+	/** Content which is shown on screen now. */
+	TRANSFER_PRIORITY_VISIBLE,
+	/** Content loaded in advance in navigation direction. */
+	TRANSFER_PRIORITY_PREFETCH,
+	/** Content which only improves what is already shown. */
+	TRANSFER_PRIORITY_BACKGROUND,
+	TRANSFER_PRIORITY_COUNT
+};
+
 struct transfer_s;
 
 typedef struct transfer_s transfer_t;
 
+/**
+ * Called for each finished transfer of a batch.
+ *
+ * @param ctx Context of the request.
+ * @param mem Received data, NULL on error. The buffer is reused for the
+ *            next transfer, so it is only valid during the call.
+ * @param size Size of mem in bytes.
+ */
+typedef void (*transfer_done_t)(void *ctx, const void *mem, size_t size);
+
+/**
+ * Called when more data of a transfer was received.
+ *
+ * @param mem All data received so far. The buffer can move when it grows.
+ * @param size Size of mem in bytes.
+ */
+typedef void (*transfer_data_t)(void *ctx, const void *mem, size_t size);
+
+/** URL requested in a batch. */
+typedef struct {
+	/** URL to load. */
+	const char *url;
+	/** Passed to the callbacks. */
+	void *ctx;
+	/** Optional callback for partially received data, NULL if not used. */
+	transfer_data_t data;
+	/** Priority class of the request. */
+	enum transfer_priority priority;
+} transfer_request_t;
+
 void transfer_init(void);
 void transfer_cleanup(void);
 transfer_t *transfer_alloc(void);
 void transfer_free(transfer_t *transfer);
 size_t transfer_binary(transfer_t *transfer, const char *url, void **mem);
 
+/**
+ * Set a function which is called while a batch is running. When it returns
+ * non-zero, queued requests which are not visible are dropped, so that the
+ * caller can handle e.g. user input first. Running transfers are finished.
+ *
+ * @param preempt Function, NULL disables preemption.
+ * @param ctx Passed to preempt.
+ */
+void transfer_set_preempt(transfer_t *transfer, int (*preempt)(void *ctx), void *ctx);
+
+/**
+ * Load several URLs concurrently. Connections are reused between batches
+ * and requests to the same host are multiplexed over HTTP/2 when the
+ * server and libcurl support it. The function returns when all transfers
+ * are finished, done() is called for each as soon as it completes. The
+ * receive buffers are allocated from the Content-Length and are kept for
+ * the next batch.
+ *
+ * Requests are started by priority class, each class has its own limit of
+ * concurrent transfers. A request which was passed over by more urgent
+ * requests several times is started next, so it doesn't starve.
+ *
+ * @param req Requested URLs, must stay valid until the function returns.
+ * @param count Number of requests.
+ *
+ * @returns Number of requests dropped by preemption. done() isn't called
+ *          for them.
+ */
+int transfer_batch(transfer_t *transfer, const transfer_request_t *req, int count, transfer_done_t done);
+void transfer_get_stats(unsigned long *requests, unsigned long long *bytes);
+
+/**
+ * Connect to hosts in advance, so that the first requests don't wait for
+ * DNS and TLS handshakes. The connections are made in parallel while
+ * transfer_poll() or transfer_batch() is called.
+ * Does nothing when recorded content is replayed.
+ *
+ * @param urls URLs on the hosts, only headers are requested.
+ * @param count Number of URLs.
+ */
+void transfer_warmup(transfer_t *transfer, const char *const *urls, int count);
+
+/** Continue connecting in advance, doesn't block. */
+void transfer_poll(transfer_t *transfer);
+
+/**
+ * Get the share handle with the DNS cache, TLS sessions and connections of
+ * the transfers, so that other CURL handles can use them.
+ *
+ * @returns Share handle, NULL if not available.
+ */
+CURLSH *transfer_get_share(transfer_t *transfer);
+
 #endif
@@ -0,0 +1,271 @@
+/*
+ * rawpicture
+ *
+ * Converts a JPEG picture at build time into raw pixels of the display
+ * format, so that the navigator doesn't need to decode it at startup.
+ *
+ * BSD License
+ *
+ * Copyright Juergen Urban
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <jpeglib.h>
+
+#include "rawpicture.h"
+
+/** Display format of the pixels. */
+typedef struct {
+	int bpp;
+	unsigned long rmask;
+	unsigned long gmask;
+	unsigned long bmask;
+} rawpicture_format_t;
+
+static const rawpicture_format_t rawpicture_formats[] = {
+	{ 16, 0xF800, 0x07E0, 0x001F },
+	{ 32, 0xFF0000, 0x00FF00, 0x0000FF },
+};
+
+/** Converted picture. */
+typedef struct {
+	unsigned char *data;
+	size_t size;
+	size_t alloc;
+} rawpicture_buffer_t;
+
+static int rawpicture_put(rawpicture_buffer_t *buf, unsigned long value, int bytes)
+{
+	int i;
+
+	if ((buf->size + bytes) > buf->alloc) {
+		unsigned char *data;
+		size_t alloc;
+
+		alloc = (buf->alloc == 0) ? 4096 : 2 * buf->alloc;
+		data = realloc(buf->data, alloc);
+		if (data == NULL) {
+			return -1;
+		}
+		buf->data = data;
+		buf->alloc = alloc;
+	}
+	for (i = 0; i < bytes; i++) {
+		buf->data[buf->size++] = (value >> (8 * i)) & 0xFF;
+	}
+	return 0;
+}
+
+/** Convert a color to the pixel value of the format. */
+static unsigned long rawpicture_pixel(const rawpicture_format_t *fmt, const JSAMPLE *rgb)
+{
+	if (fmt->bpp == 16) {
+		return ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+	} else {
+		return (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+	}
+}
+
+/** Write pixels packed in runs. */
+static int rawpicture_put_rle(rawpicture_buffer_t *buf, const unsigned long *pixels, size_t count, int bytes)
+{
+	size_t pos = 0;
+
+	while (pos < count) {
+		size_t run = 1;
+
+		while (((pos + run) < count) && (run <= RAWPICTURE_RLE_COUNT) && (pixels[pos + run] == pixels[pos])) {
+			run++;
+		}
+		if (run > 1) {
+			if ((rawpicture_put(buf, RAWPICTURE_RLE_REPEAT | (run - 1), 2) != 0)
+				|| (rawpicture_put(buf, pixels[pos], bytes) != 0)) {
+				return -1;
+			}
+		} else {
+			size_t i;
+
+			/* Literal pixels until the next repetition. */
+			while (((pos + run) < count) && (run <= RAWPICTURE_RLE_COUNT)
+				&& (((pos + run + 1) >= count) || (pixels[pos + run] != pixels[pos + run + 1]))) {
+				run++;
+			}
+			if (rawpicture_put(buf, run - 1, 2) != 0) {
+				return -1;
+			}
+			for (i = 0; i < run; i++) {
+				if (rawpicture_put(buf, pixels[pos + i], bytes) != 0) {
+					return -1;
+				}
+			}
+		}
+		pos += run;
+	}
+	return 0;
+}
+
+/** Decode the JPEG file into pixel values of the format. */
+static unsigned long *rawpicture_decode(FILE *fin, const rawpicture_format_t *fmt, int *w, int *h)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	unsigned long *pixels;
+	JSAMPLE *line;
+	int x;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&cinfo);
+	jpeg_stdio_src(&cinfo, fin);
+	jpeg_read_header(&cinfo, TRUE);
+	cinfo.out_color_space = JCS_RGB;
+	jpeg_start_decompress(&cinfo);
+
+	*w = cinfo.output_width;
+	*h = cinfo.output_height;
+	pixels = malloc(sizeof(*pixels) * cinfo.output_width * cinfo.output_height);
+	line = malloc(3 * cinfo.output_width);
+	if ((pixels == NULL) || (line == NULL)) {
+		free(pixels);
+		free(line);
+		jpeg_destroy_decompress(&cinfo);
+		return NULL;
+	}
+	while (cinfo.output_scanline < cinfo.output_height) {
+		unsigned long *dst = pixels + cinfo.output_scanline * cinfo.output_width;
+
+		jpeg_read_scanlines(&cinfo, &line, 1);
+		for (x = 0; x < *w; x++) {
+			dst[x] = rawpicture_pixel(fmt, line + 3 * x);
+		}
+	}
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	free(line);
+	return pixels;
+}
+
+static void rawpicture_usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-b 16|32] [-r] input.jpg output.raw\n", prog);
+	fprintf(stderr, "-b Bits per pixel of the display format.\n");
+	fprintf(stderr, "-r Use run length encoding if the picture gets smaller.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const rawpicture_format_t *fmt = &rawpicture_formats[0];
+	rawpicture_buffer_t header;
+	rawpicture_buffer_t raw;
+	rawpicture_buffer_t rle;
+	rawpicture_buffer_t *out;
+	unsigned long *pixels;
+	size_t count;
+	size_t i;
+	FILE *fin;
+	FILE *fout;
+	int rlerequested = 0;
+	int bytes;
+	int w;
+	int h;
+	int c;
+
+	while ((c = getopt(argc, argv, "b:r")) != -1) {
+		switch (c) {
+			case 'b':
+				fmt = NULL;
+				for (i = 0; i < sizeof(rawpicture_formats) / sizeof(rawpicture_formats[0]); i++) {
+					if (rawpicture_formats[i].bpp == atoi(optarg)) {
+						fmt = &rawpicture_formats[i];
+					}
+				}
+				if (fmt == NULL) {
+					fprintf(stderr, "Unsupported bits per pixel %s.\n", optarg);
+					return 1;
+				}
+				break;
+
+			case 'r':
+				rlerequested = 1;
+				break;
+
+			default:
+				rawpicture_usage(argv[0]);
+				return 1;
+		}
+	}
+	if ((argc - optind) != 2) {
+		rawpicture_usage(argv[0]);
+		return 1;
+	}
+
+	fin = fopen(argv[optind], "rb");
+	if (fin == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	pixels = rawpicture_decode(fin, fmt, &w, &h);
+	fclose(fin);
+	if (pixels == NULL) {
+		fprintf(stderr, "Failed to decode %s.\n", argv[optind]);
+		return 1;
+	}
+	count = (size_t) w * h;
+	bytes = fmt->bpp / 8;
+
+	memset(&raw, 0, sizeof(raw));
+	memset(&rle, 0, sizeof(rle));
+	for (i = 0; i < count; i++) {
+		if (rawpicture_put(&raw, pixels[i], bytes) != 0) {
+			fprintf(stderr, "Out of memory.\n");
+			return 1;
+		}
+	}
+	out = &raw;
+	if (rlerequested) {
+		if (rawpicture_put_rle(&rle, pixels, count, bytes) != 0) {
+			fprintf(stderr, "Out of memory.\n");
+			return 1;
+		}
+		if (rle.size < raw.size) {
+			out = &rle;
+		}
+	}
+
+	fout = fopen(argv[optind + 1], "wb");
+	if (fout == NULL) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+	memset(&header, 0, sizeof(header));
+	if ((rawpicture_put(&header, RAWPICTURE_MAGIC, 4) != 0)
+		|| (rawpicture_put(&header, (out == &rle) ? RAWPICTURE_FLAG_RLE : 0, 4) != 0)
+		|| (rawpicture_put(&header, w, 4) != 0)
+		|| (rawpicture_put(&header, h, 4) != 0)
+		|| (rawpicture_put(&header, fmt->bpp, 4) != 0)
+		|| (rawpicture_put(&header, fmt->rmask, 4) != 0)
+		|| (rawpicture_put(&header, fmt->gmask, 4) != 0)
+		|| (rawpicture_put(&header, fmt->bmask, 4) != 0)) {
+		fprintf(stderr, "Out of memory.\n");
+		fclose(fout);
+		return 1;
+	}
+	if ((fwrite(header.data, header.size, 1, fout) != 1)
+		|| (fwrite(out->data, out->size, 1, fout) != 1)) {
+		perror(argv[optind + 1]);
+		fclose(fout);
+		return 1;
+	}
+	if (fclose(fout) != 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	free(pixels);
+	free(header.data);
+	free(raw.data);
+	free(rle.data);
+	return 0;
+}
@@ -6,6 +6,9 @@ SHAREDIR="$2"
 DEFAULTVIDEOFORMAT=5
 VIDEOFORMAT=18
 YOUTUBEDL="youtube-dl"
+# Set RESIDENT=1 in juhutube-cfg.txt to let the navigator play the videos
+# with mplayer itself instead of restarting it for each video.
+RESIDENT=0
 if [ -z "$SHAREDIR" ]; then
 	SHAREDIR="$DEFAULTSHAREDIR"
 fi
@@ -35,6 +38,10 @@ WGET=wget
 which $WGET >/dev/null
 USE_WGET=$?
 USE_URL=0
+if [ $USE_URL -eq 0 ]; then
+	# The navigator resolves the URL of the selected video with youtube-dl ahead.
+	export NAVIGATOR_STREAMURL=1
+fi
 which valgrind >/dev/null
 USE_DBGPRG=$?
 #USE_DBGPRG=1
@@ -92,7 +99,31 @@ if [ "$AGENT" = "" ]; then
 	AGENT="$($YOUTUBEDL --dump-user-agent)"
 fi
 
-if [ -x "$PROGRAM" ]; then
+if [ -x "$PROGRAM" -a "$RESIDENT" = "1" ]; then
+	while [ true ]; do
+		echo "      Starting navigator"
+		$DBGPRG "$PROGRAM" "$FULLSCREEN" -o "$SHAREDIR" -R -F "$VIDEOFORMAT" $LOGOUTPUT
+		RETVAL="$?"
+		if [ "$LOGFILE" != "" ]; then
+			cat "$LOGFILE"
+		fi
+
+		if [ "$RETVAL" = "4" ]; then
+			if [ "$(whoami)" = "root" ]; then
+				halt
+			else
+				sudo halt
+			fi
+			break
+		elif [ "$RETVAL" = "5" ]; then
+			echo "      Updating $YOUTUBEDL"
+			$YOUTUBEDL -U
+		else
+			echo "      Stopped with $RETVAL"
+			break
+		fi
+	done
+elif [ -x "$PROGRAM" ]; then
 	RETVAL=""
 	while [ true ]; do
 		CFG="$(mktemp -t ytplayXXXXXXXXX)"
@@ -100,10 +131,10 @@ if [ -x "$PROGRAM" ]; then
 		# Use navigator, so that the user can tell which video to play:
 		echo "      Starting navigator"
 		if [ "$RETVAL" != "" ]; then
-			$DBGPRG "$PROGRAM" "$FULLSCREEN" -o "$SHAREDIR" -v "$CFG" -p "$PLAYLISTID" -k "$CATPAGETOKEN" -i "$VIDEOID" -n "$CATNR" -j "$CHANNELSTART" -m "$STATE" -t "$VIDPAGETOKEN" -u "$VIDNR" -r "$RETVAL" -c "$CHANNELID" -e "$SELECTEDMENU" -S "$SEARCHTERM" $LOGOUTPUT
+			$DBGPRG "$PROGRAM" "$FULLSCREEN" -o "$SHAREDIR" -v "$CFG" -p "$PLAYLISTID" -k "$CATPAGETOKEN" -i "$VIDEOID" -n "$CATNR" -j "$CHANNELSTART" -m "$STATE" -t "$VIDPAGETOKEN" -u "$VIDNR" -r "$RETVAL" -c "$CHANNELID" -e "$SELECTEDMENU" -S "$SEARCHTERM" -F "$VIDEOFORMAT" $LOGOUTPUT
 			RETVAL="$?"
 		else
-			$DBGPRG "$PROGRAM" "$FULLSCREEN" -o "$SHAREDIR" -v "$CFG" $LOGOUTPUT
+			$DBGPRG "$PROGRAM" "$FULLSCREEN" -o "$SHAREDIR" -v "$CFG" -F "$VIDEOFORMAT" $LOGOUTPUT
 			RETVAL="$?"
 		fi
 		if [ "$LOGFILE" != "" ]; then
@@ -123,6 +154,7 @@ if [ -x "$PROGRAM" ]; then
 			# The user selected a video which should be played, so
 			# get the information about it and play it:
 			VIDPAGETOKEN=""
+			STREAMURL=""
 			source "$CFG"
 			echo "      Selected video:"
 			echo
@@ -136,7 +168,12 @@ if [ -x "$PROGRAM" ]; then
 			fi
 			URLFILE="/tmp/url.$$"
 			rm -f "$URLFILE"
-			if [ $USE_URL -eq 0 -a -e "/proc/ps2pad" ]; then
+			CHECKPID=""
+			if [ $USE_URL -eq 0 -a "$STREAMURL" != "" ]; then
+				# Navigator already resolved the URL while the video was selected.
+				URL="$STREAMURL"
+				RET=0
+			elif [ $USE_URL -eq 0 -a -e "/proc/ps2pad" ]; then
 				$YOUTUBEDL -g -f $VIDEOFORMAT --cookies=/tmp/ytcookie-$VIDEOID.txt https://www.youtube.com/watch?v=$VIDEOID >"$URLFILE" &
 				YDLPID=$!
 				checkforcross $YDLPID &
@@ -176,9 +213,9 @@ if [ -x "$PROGRAM" ]; then
 				fi
 			fi
 			rm -f "$URLFILE"
-			if [ -e "/proc/ps2pad" ]; then
+			if [ "$CHECKPID" != "" ]; then
 				kill $CHECKPID 2>/dev/null
-			else
+			elif [ ! -e "/proc/ps2pad" ]; then
 				echo
 			fi
 			if [ $RET -eq 0 -a "$URL" != "" ]; then